@@ -151,6 +151,54 @@ extern "C" {
 
 [[gnu::used]] extern void __remill_atomic_end(RuntimeManager *);
 
+// Atomic memory access of elfconv. `order` is one of __ATOMIC_RELAXED, ..., __ATOMIC_SEQ_CST,
+// and the read-modify-write intrinsics return the value before the access.
+[[gnu::used]] extern uint8_t __remill_atomic_load_memory_8(RuntimeManager *, addr_t, int order);
+
+[[gnu::used]] extern uint16_t __remill_atomic_load_memory_16(RuntimeManager *, addr_t, int order);
+
+[[gnu::used]] extern uint32_t __remill_atomic_load_memory_32(RuntimeManager *, addr_t, int order);
+
+[[gnu::used]] extern uint64_t __remill_atomic_load_memory_64(RuntimeManager *, addr_t, int order);
+
+[[gnu::used]] extern void __remill_atomic_store_memory_8(RuntimeManager *, addr_t, uint8_t,
+                                                         int order);
+
+[[gnu::used]] extern void __remill_atomic_store_memory_16(RuntimeManager *, addr_t, uint16_t,
+                                                          int order);
+
+[[gnu::used]] extern void __remill_atomic_store_memory_32(RuntimeManager *, addr_t, uint32_t,
+                                                          int order);
+
+[[gnu::used]] extern void __remill_atomic_store_memory_64(RuntimeManager *, addr_t, uint64_t,
+                                                          int order);
+
+[[gnu::used]] extern uint32_t __remill_atomic_swap_memory_32(RuntimeManager *, addr_t, uint32_t,
+                                                             int order);
+
+[[gnu::used]] extern uint64_t __remill_atomic_swap_memory_64(RuntimeManager *, addr_t, uint64_t,
+                                                             int order);
+
+[[gnu::used]] extern uint32_t __remill_atomic_add_memory_32(RuntimeManager *, addr_t, uint32_t,
+                                                            int order);
+
+[[gnu::used]] extern uint64_t __remill_atomic_add_memory_64(RuntimeManager *, addr_t, uint64_t,
+                                                            int order);
+
+[[gnu::used]] extern uint32_t __remill_atomic_or_memory_32(RuntimeManager *, addr_t, uint32_t,
+                                                           int order);
+
+[[gnu::used]] extern uint64_t __remill_atomic_or_memory_64(RuntimeManager *, addr_t, uint64_t,
+                                                           int order);
+
+[[gnu::used]] extern uint32_t __remill_atomic_cmpxchg_memory_32(RuntimeManager *, addr_t,
+                                                                uint32_t expected,
+                                                                uint32_t desired, int order);
+
+[[gnu::used]] extern uint64_t __remill_atomic_cmpxchg_memory_64(RuntimeManager *, addr_t,
+                                                                uint64_t expected,
+                                                                uint64_t desired, int order);
+
 // Used to signal the begin/ending of an instruction executed within a delay
 // slot.
 [[gnu::used, gnu::const]] extern Memory *__remill_delay_slot_begin(Memory *);
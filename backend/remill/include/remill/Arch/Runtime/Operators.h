@@ -733,6 +733,66 @@ MAKE_ATOMIC(XorFetch, xor_and_fetch, ^)
 #define UAndFetch(op1, op2) _UAndFetch(runtime_manager, op1, op2)
 #define UXorFetch(op1, op2) _UXorFetch(runtime_manager, op1, op2)
 
+// Atomic memory access with the ordering `order` (__ATOMIC_RELAXED, ..., __ATOMIC_SEQ_CST).
+// Every read-modify-write returns the value before the access.
+#define MAKE_ATOMIC_MEMORY_ACCESS(size) \
+  ALWAYS_INLINE static uint##size##_t _AtomicLoad(RuntimeManager *&runtime_manager, \
+                                                  Mn<uint##size##_t> op, int order) { \
+    return __remill_atomic_load_memory_##size(runtime_manager, op.addr, order); \
+  } \
+\
+  ALWAYS_INLINE static void _AtomicStore(RuntimeManager *&runtime_manager, \
+                                         MnW<uint##size##_t> op, uint##size##_t val, int order) { \
+    __remill_atomic_store_memory_##size(runtime_manager, op.addr, val, order); \
+  }
+
+MAKE_ATOMIC_MEMORY_ACCESS(8)
+MAKE_ATOMIC_MEMORY_ACCESS(16)
+MAKE_ATOMIC_MEMORY_ACCESS(32)
+MAKE_ATOMIC_MEMORY_ACCESS(64)
+
+#undef MAKE_ATOMIC_MEMORY_ACCESS
+
+#define MAKE_ATOMIC_RMW(size) \
+  ALWAYS_INLINE static uint##size##_t _AtomicSwap(RuntimeManager *&runtime_manager, \
+                                                  MnW<uint##size##_t> op, uint##size##_t val, \
+                                                  int order) { \
+    return __remill_atomic_swap_memory_##size(runtime_manager, op.addr, val, order); \
+  } \
+\
+  ALWAYS_INLINE static uint##size##_t _AtomicAdd(RuntimeManager *&runtime_manager, \
+                                                 MnW<uint##size##_t> op, uint##size##_t val, \
+                                                 int order) { \
+    return __remill_atomic_add_memory_##size(runtime_manager, op.addr, val, order); \
+  } \
+\
+  ALWAYS_INLINE static uint##size##_t _AtomicOr(RuntimeManager *&runtime_manager, \
+                                                MnW<uint##size##_t> op, uint##size##_t val, \
+                                                int order) { \
+    return __remill_atomic_or_memory_##size(runtime_manager, op.addr, val, order); \
+  } \
+\
+  ALWAYS_INLINE static uint##size##_t _AtomicCmpXchg(RuntimeManager *&runtime_manager, \
+                                                     MnW<uint##size##_t> op, \
+                                                     uint##size##_t expected, \
+                                                     uint##size##_t desired, int order) { \
+    return __remill_atomic_cmpxchg_memory_##size(runtime_manager, op.addr, expected, desired, \
+                                                 order); \
+  }
+
+MAKE_ATOMIC_RMW(32)
+MAKE_ATOMIC_RMW(64)
+
+#undef MAKE_ATOMIC_RMW
+
+#define AtomicLoad(op, order) _AtomicLoad(runtime_manager, op, order)
+#define AtomicStore(op, val, order) _AtomicStore(runtime_manager, op, val, order)
+#define AtomicSwap(op, val, order) _AtomicSwap(runtime_manager, op, val, order)
+#define AtomicAdd(op, val, order) _AtomicAdd(runtime_manager, op, val, order)
+#define AtomicOr(op, val, order) _AtomicOr(runtime_manager, op, val, order)
+#define AtomicCmpXchg(op, expected, desired, order) \
+  _AtomicCmpXchg(runtime_manager, op, expected, desired, order)
+
 // For the sake of esthetics and hiding the small-step semantics of memory
 // operands, we use this macros to implicitly pass in the `memory` operand,
 // which we know will be defined in semantics functions.
@@ -42,7 +42,7 @@ class Type;
 
 namespace remill {
 
-extern std::unordered_map<llvm::Value *, uint64_t> Sema_func_vma_map;
+extern thread_local std::unordered_map<llvm::Value *, uint64_t> Sema_func_vma_map;
 
 class Arch;
 class Instruction;
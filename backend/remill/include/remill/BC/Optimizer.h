@@ -160,6 +160,11 @@ inline static void OptimizeModule(const remill::Arch *arch, llvm::Module *module
 // intrinsics functions like `__remill_jump`, etc.
 void OptimizeBareModule(llvm::Module *module, OptimizationGuide guide = {});
 
+// Optimize the whole lifted module with the default pipeline of the new pass
+// manager (`opt_level` is 1, 2 or 3). The semantics functions should be
+// internal so that they are inlined and removed.
+void OptimizeLiftedModule(llvm::Module *module, unsigned opt_level);
+
 inline static void OptimizeBareModule(const std::unique_ptr<llvm::Module> &module,
                                       OptimizationGuide guide = {}) {
   std::vector<llvm::Function *> funcs;
@@ -19,13 +19,14 @@
 #include "remill/Arch/Arch.h"
 #include "remill/BC/Lifter.h"
 
+#include <chrono>
 #include <functional>
 #include <queue>
 #include <unordered_map>
 
 namespace remill {
 
-extern std::ostringstream ECV_DEBUG_STREAM;
+extern thread_local std::ostringstream ECV_DEBUG_STREAM;
 
 using TraceMap = std::unordered_map<uint64_t, llvm::Function *>;
 using DecoderWorkList = std::set<uint64_t>;  // For ordering.
@@ -90,21 +91,70 @@ class TraceManager {
   // pointed to by `byte` with the read value.
   virtual bool TryReadExecutableByte(uint64_t addr, uint8_t *byte) = 0;
 
+  // Try to read `size` executable bytes at once. The default implementation
+  // calls `TryReadExecutableByte` for every byte.
+  virtual bool TryReadExecutableBytes(uint64_t addr, uint8_t *bytes, size_t size);
+
   /* judge whether the addr is end vma of function or not. */
   virtual bool isWithinFunction(uint64_t trace_addr, uint64_t inst_addr) = 0;
 
   /* get vma end address of the target function */
   virtual uint64_t GetFuncVMA_E(uint64_t vma_s) = 0;
 
-  /* global array of block address various data */
-  std::vector<llvm::Constant *> g_block_address_ptrs_array;
-  std::vector<llvm::Constant *> g_block_address_vmas_array;
-  std::vector<llvm::Constant *> g_block_address_size_array;
-  std::vector<llvm::Constant *> g_block_address_fn_vma_array;
+  /* get every target of the BR instruction at br_addr if it is known statically (e.g. jump table). */
+  virtual bool TryGetIndirectJumpTargets(uint64_t trace_addr, uint64_t br_addr,
+                                         std::vector<uint64_t> &targets) {
+    return false;
+  }
+
+  /* judge whether the `svc` at addr is clone (`mov x8, #220; svc #0`). */
+  virtual bool isCloneSyscall(uint64_t svc_addr) {
+    return false;
+  }
+
+  /* judge whether the trace at addr is lifted by this lifter or only declared. */
+  virtual bool isLiftTarget(uint64_t addr) {
+    return true;
+  }
 
   uint64_t _io_file_xsputn_vma = 0;
 };
 
+// Guest profile of the previous run for the profile-guided lifting (--profile).
+struct LiftProfile {
+  // function vma -> the number of the calls
+  std::unordered_map<uint64_t, uint64_t> fn_counts;
+  // guest basic block vma -> the number of the executions
+  std::unordered_map<uint64_t, uint64_t> block_counts;
+  // conditional branch vma -> (taken, not taken)
+  std::unordered_map<uint64_t, std::pair<uint64_t, uint64_t>> branch_counts;
+};
+
+// Lift-time statistics of one lifted function (--stats_json).
+struct LiftFuncStats {
+  uint64_t inst_num = 0;  // decoded guest instructions
+  uint64_t block_num = 0;  // guest basic blocks
+  uint64_t ir_inst_num = 0;  // LLVM IR instructions of the output
+  uint64_t indirect_jump_num = 0;  // BR
+  uint64_t indirect_call_num = 0;  // BLR
+  double opt_ms = 0;  // Opt Pass 1 and 2
+  uint64_t promoted_frame_bytes = 0;  // guest frame moved to the alloca (--stack_slots)
+};
+
+// Lift-time statistics (--stats_json).
+struct LiftStats {
+  struct Phase {
+    std::string name;
+    double wall_ms;
+    long peak_rss_kb;  // peak RSS of the process at the end of the phase
+  };
+  std::vector<Phase> phases;
+  std::unordered_map<uint64_t, LiftFuncStats> funcs;
+
+  // Add the phase which started at `start` and ends now.
+  void AddPhase(std::string name, std::chrono::steady_clock::time_point start);
+};
+
 class PhiRegsBBBagNode {
  public:
   PhiRegsBBBagNode(EcvRegMap<ERC> __own_ld_reg_map, EcvRegMap<ERC> __succeeding_load_reg_map,
@@ -116,30 +166,11 @@ class PhiRegsBBBagNode {
         converted_bag(nullptr) {}
 
   PhiRegsBBBagNode() {}
-  static void Reset() {
-    bb_regs_bag_map.clear();
-    bag_num = 0;
-    debug_bag_map.clear();
-  }
-
-  static void GetPrecedingVirtualRegsBags(llvm::BasicBlock *root_bb);
-  static void GetSucceedingVirtualRegsBags(llvm::BasicBlock *root_bb);
-  static void RemoveLoop(llvm::BasicBlock *bb);
-  static void
-  GetPhiRegsBags(llvm::BasicBlock *root_bb,
-                 std::unordered_map<llvm::BasicBlock *, BBRegInfoNode *> &bb_info_node_map);
-
-  static inline std::unordered_map<llvm::BasicBlock *, PhiRegsBBBagNode *> bb_regs_bag_map = {};
-  static inline std::size_t bag_num = 0;
-  static inline std::unordered_map<PhiRegsBBBagNode *, uint32_t> debug_bag_map = {};
-  // The register set which should be passed from caller function.
 
   PhiRegsBBBagNode *GetTrueBag();
   void MergeOwnRegs(PhiRegsBBBagNode *moved_bag);
   void MergeFamilyBags(PhiRegsBBBagNode *merged_bag);
 
-  static void DebugGraphStruct(PhiRegsBBBagNode *target_bag);
-
   // The register set which is loaded in the own bag.
   EcvRegMap<ERC> own_ld_rmp;
   // The register set which is stored in the own bag.
@@ -171,6 +202,23 @@ class PhiRegsBBBagNode {
   bool is_loop;
 };
 
+// The graph of PhiRegsBBBagNode of one function.
+// Every function has its own graph, so the functions can be analyzed independently.
+class PhiRegsBBBagGraph {
+ public:
+  void GetPrecedingVirtualRegsBags(llvm::BasicBlock *root_bb);
+  void GetSucceedingVirtualRegsBags(llvm::BasicBlock *root_bb);
+  void RemoveLoop(llvm::BasicBlock *bb);
+  void GetPhiRegsBags(llvm::BasicBlock *root_bb,
+                      std::unordered_map<llvm::BasicBlock *, BBRegInfoNode *> &bb_info_node_map);
+
+  void DebugGraphStruct(PhiRegsBBBagNode *target_bag);
+
+  std::unordered_map<llvm::BasicBlock *, PhiRegsBBBagNode *> bb_regs_bag_map;
+  std::size_t bag_num = 0;
+  std::unordered_map<PhiRegsBBBagNode *, uint32_t> debug_bag_map;
+};
+
 // Implements a recursive decoder that lifts a trace of instructions to bitcode.
 class TraceLifter {
  public:
@@ -222,8 +270,9 @@ class VirtualRegsOpt {
 
   void OptimizeVirtualRegsUsage();
 
-  static inline std::unordered_map<llvm::Function *, VirtualRegsOpt *> func_v_r_opt_map = {};
-  static inline std::unordered_map<llvm::Function *, std::vector<llvm::Function *>>
+  static inline thread_local std::unordered_map<llvm::Function *, VirtualRegsOpt *>
+      func_v_r_opt_map = {};
+  static inline thread_local std::unordered_map<llvm::Function *, std::vector<llvm::Function *>>
       b_jump_callees_map = {};
 
   llvm::Function *func;
@@ -280,6 +329,8 @@ class TraceLifter::Impl {
         runtime_manager_name("RuntimeManager"),
         indirectbr_block_name("L_indirectbr"),
         g_get_indirectbr_block_address_func_name("__g_get_indirectbr_block_address"),
+        g_profile_block_func_name("__g_profile_block"),
+        g_profile_branch_func_name("__g_profile_branch"),
         debug_memory_value_change_name("debug_memory_value_change"),
         debug_insn_name("debug_insn"),
         debug_call_stack_push_name("debug_call_stack_push"),
@@ -387,6 +438,8 @@ class TraceLifter::Impl {
 
   std::string indirectbr_block_name;
   std::string g_get_indirectbr_block_address_func_name;
+  std::string g_profile_block_func_name;
+  std::string g_profile_branch_func_name;
   std::string debug_memory_value_change_name;
   std::string debug_insn_name;
   std::string debug_call_stack_push_name;
@@ -395,6 +448,15 @@ class TraceLifter::Impl {
   const llvm::DataLayout data_layout;
 
   bool tmp_patch_fn_check = false;
+
+  /* mark every guest basic block with the call of __g_profile_block (--guest_profile=block) */
+  bool profile_block = false;
+  /* count the taken of every conditional branch with __g_profile_branch (--instrument) */
+  bool profile_branch = false;
+  /* attach the branch weights of the previous run (--profile) */
+  const LiftProfile *profile = nullptr;
+  /* record the statistics of every function (--stats_json) */
+  LiftStats *stats = nullptr;
 };
 
 }  // namespace remill
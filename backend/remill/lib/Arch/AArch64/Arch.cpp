@@ -3925,6 +3925,8 @@ bool TryDecodeFNEG_D_FLOATDP1(const InstData &data, Instruction &inst) {
 bool TryDecodeSVC_EX_EXCEPTION(const InstData &data, Instruction &inst) {
   inst.sema_func_arg_type = SemaFuncArgType::StateRuntime;
   AddImmOperand(inst, data.imm16.uimm, kUnsigned, 32);
+  // PC of `svc` (clone starts the child thread at the next instruction).
+  AddImmOperand(inst, inst.pc, kUnsigned, 64);
   return true;
 }
 
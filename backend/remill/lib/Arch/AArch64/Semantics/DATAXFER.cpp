@@ -162,8 +162,7 @@ DEF_SEM_VOID_RUN(StoreDoubleToOffset, RF64 src, MVI64 base, ADDR offset) {
 
 template <typename S, typename D>  // StoreRelease<R32, M32W>
 DEF_SEM_VOID_RUN(StoreRelease, S src, D dst) {
-  MWriteTrunc(dst, Read(src));
-  __remill_barrier_store_store(runtime_manager);
+  AtomicStore(dst, Read(src), __ATOMIC_RELEASE);
 }
 
 #if defined(__x86_64)
@@ -177,25 +176,20 @@ DEF_SEM_VOID_RUN(STR_Q_UPDATE_ADDR, R128 src, MVI128 dst) {
 }
 #endif
 
-template <typename S, typename D>  // e.g. SWP_MEMOP<R32, M32W>
+/* A: acquire, L: release, AL: acquire and release */
+template <typename S, typename D, int kOrder>  // e.g. SWP_MEMOP<R32, M32W, __ATOMIC_RELAXED>
 DEF_SEM_T_RUN(SWP_MEMOP, S src1, D dst_src_mem) {
-  auto mem_val = ReadMem(dst_src_mem);
-  MWriteTrunc(dst_src_mem, Read(src1));
-  return mem_val;
+  return AtomicSwap(dst_src_mem, Read(src1), kOrder);
 }
 
-template <typename S, typename D>  // e.g. LDADD_MEMOP<R32, M32>
+template <typename S, typename D, int kOrder>  // e.g. LDADD_MEMOP<R32, M32W, __ATOMIC_RELAXED>
 DEF_SEM_T_RUN(LDADD_MEMOP, S src, D dst_src_mem) {
-  auto mem_val = ReadMem(dst_src_mem);
-  MWriteTrunc(dst_src_mem, UAdd(mem_val, Read(src)));
-  return mem_val;
+  return AtomicAdd(dst_src_mem, Read(src), kOrder);
 }
 
-template <typename S, typename D>  // e.g. LDSET_MEMOP<R32, M32W>
+template <typename S, typename D, int kOrder>  // e.g. LDSET_MEMOP<R32, M32W, __ATOMIC_RELAXED>
 DEF_SEM_T_RUN(LDSET_MEMOP, S src, D dst_src_mem) {
-  auto mem_val = ReadMem(dst_src_mem);
-  MWriteTrunc(dst_src_mem, UOr(mem_val, Read(src)));
-  return mem_val;
+  return AtomicOr(dst_src_mem, Read(src), kOrder);
 }
 
 }  // namespace
@@ -247,38 +241,54 @@ DEF_ISEL(STR_S_LDST_REGOFF) =
 DEF_ISEL(STR_D_LDST_REGOFF) =
     StoreDoubleToOffset;  // STR  <Dt>, [<Xn|SP>, (<Wm>|<Xm>){, <extend> {<amount>}}]
 
-DEF_ISEL(SWP_32_MEMOP) = SWP_MEMOP<R32, M32W>;  // SWP  <Ws>, <Wt>, [<Xn|SP>]
-DEF_ISEL(SWP_64_MEMOP) = SWP_MEMOP<R64, M64W>;  // SWP  <Xs>, <Xt>, [<Xn|SP>]
+DEF_ISEL(SWP_32_MEMOP) = SWP_MEMOP<R32, M32W, __ATOMIC_RELAXED>;  // SWP  <Ws>, <Wt>, [<Xn|SP>]
+DEF_ISEL(SWP_64_MEMOP) = SWP_MEMOP<R64, M64W, __ATOMIC_RELAXED>;  // SWP  <Xs>, <Xt>, [<Xn|SP>]
 
-DEF_ISEL(SWPA_32_MEMOP) = SWP_MEMOP<R32, M32W>;  // SWPA  <Ws>, <Wt>, [<Xn|SP>]
-DEF_ISEL(SWPA_64_MEMOP) = SWP_MEMOP<R64, M64W>;  // SWPA  <Xs>, <Xt>, [<Xn|SP>]
+DEF_ISEL(SWPA_32_MEMOP) = SWP_MEMOP<R32, M32W, __ATOMIC_ACQUIRE>;  // SWPA  <Ws>, <Wt>, [<Xn|SP>]
+DEF_ISEL(SWPA_64_MEMOP) = SWP_MEMOP<R64, M64W, __ATOMIC_ACQUIRE>;  // SWPA  <Xs>, <Xt>, [<Xn|SP>]
 
-DEF_ISEL(SWPL_32_MEMOP) = SWP_MEMOP<R32, M32W>;  // SWPL  <Ws>, <Wt>, [<Xn|SP>]
-DEF_ISEL(SWPL_64_MEMOP) = SWP_MEMOP<R64, M64W>;  // SWPL  <Xs>, <Xt>, [<Xn|SP>]
+DEF_ISEL(SWPL_32_MEMOP) = SWP_MEMOP<R32, M32W, __ATOMIC_RELEASE>;  // SWPL  <Ws>, <Wt>, [<Xn|SP>]
+DEF_ISEL(SWPL_64_MEMOP) = SWP_MEMOP<R64, M64W, __ATOMIC_RELEASE>;  // SWPL  <Xs>, <Xt>, [<Xn|SP>]
 
-DEF_ISEL(LDADD_32_MEMOP) = LDADD_MEMOP<R32, M32W>;  // LDADD  <Ws>, <Wt>, [<Xn|SP>]
-DEF_ISEL(LDADD_64_MEMOP) = LDADD_MEMOP<R64, M64W>;  // LDADD  <Xs>, <Xt>, [<Xn|SP>]
+DEF_ISEL(LDADD_32_MEMOP) =
+    LDADD_MEMOP<R32, M32W, __ATOMIC_RELAXED>;  // LDADD  <Ws>, <Wt>, [<Xn|SP>]
+DEF_ISEL(LDADD_64_MEMOP) =
+    LDADD_MEMOP<R64, M64W, __ATOMIC_RELAXED>;  // LDADD  <Xs>, <Xt>, [<Xn|SP>]
 
-DEF_ISEL(LDADDA_32_MEMOP) = LDADD_MEMOP<R32, M32W>;  // LDADDA  <Ws>, <Wt>, [<Xn|SP>]
-DEF_ISEL(LDADDA_64_MEMOP) = LDADD_MEMOP<R64, M64W>;  // LDADDA  <Xs>, <Xt>, [<Xn|SP>]
+DEF_ISEL(LDADDA_32_MEMOP) =
+    LDADD_MEMOP<R32, M32W, __ATOMIC_ACQUIRE>;  // LDADDA  <Ws>, <Wt>, [<Xn|SP>]
+DEF_ISEL(LDADDA_64_MEMOP) =
+    LDADD_MEMOP<R64, M64W, __ATOMIC_ACQUIRE>;  // LDADDA  <Xs>, <Xt>, [<Xn|SP>]
 
-DEF_ISEL(LDADDL_32_MEMOP) = LDADD_MEMOP<R32, M32W>;  // LDADDL  <Ws>, <Wt>, [<Xn|SP>]
-DEF_ISEL(LDADDL_64_MEMOP) = LDADD_MEMOP<R64, M64W>;  // LDADDL  <Xs>, <Xt>, [<Xn|SP>]
+DEF_ISEL(LDADDL_32_MEMOP) =
+    LDADD_MEMOP<R32, M32W, __ATOMIC_RELEASE>;  // LDADDL  <Ws>, <Wt>, [<Xn|SP>]
+DEF_ISEL(LDADDL_64_MEMOP) =
+    LDADD_MEMOP<R64, M64W, __ATOMIC_RELEASE>;  // LDADDL  <Xs>, <Xt>, [<Xn|SP>]
 
-DEF_ISEL(LDADDAL_32_MEMOP) = LDADD_MEMOP<R32, M32W>;  // LDADDAL  <Ws>, <Wt>, [<Xn|SP>]
-DEF_ISEL(LDADDAL_64_MEMOP) = LDADD_MEMOP<R64, M64W>;  // LDADDAL  <Xs>, <Xt>, [<Xn|SP>]
+DEF_ISEL(LDADDAL_32_MEMOP) =
+    LDADD_MEMOP<R32, M32W, __ATOMIC_ACQ_REL>;  // LDADDAL  <Ws>, <Wt>, [<Xn|SP>]
+DEF_ISEL(LDADDAL_64_MEMOP) =
+    LDADD_MEMOP<R64, M64W, __ATOMIC_ACQ_REL>;  // LDADDAL  <Xs>, <Xt>, [<Xn|SP>]
 
-DEF_ISEL(LDSET_32_MEMOP) = LDSET_MEMOP<R32, M32W>;  // LDSET  <Ws>, <Wt>, [<Xn|SP>]
-DEF_ISEL(LDSET_64_MEMOP) = LDSET_MEMOP<R64, M64W>;  // LDSET  <Xs>, <Xt>, [<Xn|SP>]
+DEF_ISEL(LDSET_32_MEMOP) =
+    LDSET_MEMOP<R32, M32W, __ATOMIC_RELAXED>;  // LDSET  <Ws>, <Wt>, [<Xn|SP>]
+DEF_ISEL(LDSET_64_MEMOP) =
+    LDSET_MEMOP<R64, M64W, __ATOMIC_RELAXED>;  // LDSET  <Xs>, <Xt>, [<Xn|SP>]
 
-DEF_ISEL(LDSETA_32_MEMOP) = LDSET_MEMOP<R32, M32W>;  // LDSETA  <Ws>, <Wt>, [<Xn|SP>]
-DEF_ISEL(LDSETA_64_MEMOP) = LDSET_MEMOP<R64, M64W>;  // LDSETA  <Xs>, <Xt>, [<Xn|SP>]
+DEF_ISEL(LDSETA_32_MEMOP) =
+    LDSET_MEMOP<R32, M32W, __ATOMIC_ACQUIRE>;  // LDSETA  <Ws>, <Wt>, [<Xn|SP>]
+DEF_ISEL(LDSETA_64_MEMOP) =
+    LDSET_MEMOP<R64, M64W, __ATOMIC_ACQUIRE>;  // LDSETA  <Xs>, <Xt>, [<Xn|SP>]
 
-DEF_ISEL(LDSETL_32_MEMOP) = LDSET_MEMOP<R32, M32W>;  // LDSETL  <Ws>, <Wt>, [<Xn|SP>]
-DEF_ISEL(LDSETL_64_MEMOP) = LDSET_MEMOP<R64, M64W>;  // LDSETL  <Xs>, <Xt>, [<Xn|SP>]
+DEF_ISEL(LDSETL_32_MEMOP) =
+    LDSET_MEMOP<R32, M32W, __ATOMIC_RELEASE>;  // LDSETL  <Ws>, <Wt>, [<Xn|SP>]
+DEF_ISEL(LDSETL_64_MEMOP) =
+    LDSET_MEMOP<R64, M64W, __ATOMIC_RELEASE>;  // LDSETL  <Xs>, <Xt>, [<Xn|SP>]
 
-DEF_ISEL(LDSETAL_32_MEMOP) = LDSET_MEMOP<R32, M32W>;  // LDSETAL  <Ws>, <Wt>, [<Xn|SP>]
-DEF_ISEL(LDSETAL_64_MEMOP) = LDSET_MEMOP<R64, M64W>;  // LDSETAL  <Xs>, <Xt>, [<Xn|SP>]
+DEF_ISEL(LDSETAL_32_MEMOP) =
+    LDSET_MEMOP<R32, M32W, __ATOMIC_ACQ_REL>;  // LDSETAL  <Ws>, <Wt>, [<Xn|SP>]
+DEF_ISEL(LDSETAL_64_MEMOP) =
+    LDSET_MEMOP<R64, M64W, __ATOMIC_ACQ_REL>;  // LDSETAL  <Xs>, <Xt>, [<Xn|SP>]
 
 namespace {
 
@@ -419,68 +429,45 @@ DEF_ISEL(MOVZ_64_MOVEWIDE) = Load<I64>;  // MOVZ  <Xd>, #<imm>{, LSL #<shift>}
 
 namespace {
 
-template <typename S>  // e.g. LDXR<R32, M32>
+/*
+  LL/SC pair as a CAS loop: the load exclusive keeps the loaded value in MONITOR, and the store
+  exclusive succeeds only if `cmpxchg` finds the value unchanged (the guest retries on failure).
+  The address and the ABA change of the value aren't checked unlike the exclusive monitor.
+*/
+template <typename S, int kOrder>  // e.g. LDXR_32<M32, __ATOMIC_RELAXED>
 DEF_SEM_U32U64_RUN(LDXR_32, S src_mem) {
-  return {ReadMem(src_mem), AddressOf(src_mem)};
+  auto val = AtomicLoad(src_mem, kOrder);
+  return {val, ZExtTo<uint64_t>(val)};
 }
 
-template <typename S>  // e.g. LDXR<R32, M32>
+template <typename S, int kOrder>  // e.g. LDXR_64<M64, __ATOMIC_RELAXED>
 DEF_SEM_U64U64_RUN(LDXR_64, S src_mem) {
-  return {ReadMem(src_mem), AddressOf(src_mem)};
-}
-
-template <typename S>  // e.g. LDAXR<R32, M32>
-DEF_SEM_U32U64_RUN(LDAXR_32, S src_mem) {
-  __remill_barrier_load_store(runtime_manager);
-  return {ReadMem(src_mem), AddressOf(src_mem)};
-}
-
-template <typename S>  // e.g. LDAXR<R32, M32>
-DEF_SEM_U64U64_RUN(LDAXR_64, S src_mem) {
-  __remill_barrier_load_store(runtime_manager);
-  return {ReadMem(src_mem), AddressOf(src_mem)};
+  auto val = AtomicLoad(src_mem, kOrder);
+  return {val, val};
 }
 
-template <typename S, typename D>  // e.g. STLXR<R32, M32W>
-DEF_SEM_U32U64_RUN(STLXR, S src1, D dst, R64 monitor) {
-  auto old_addr = Read(monitor);
-  uint32_t check;
-  if (old_addr == AddressOf(dst)) {
-    MWriteZExt(dst, Read(src1));
-    check = 0;  // Store succeeded.
-  } else {
-    check = 1;  // Store failed.
-  }
-  __remill_barrier_store_store(runtime_manager);
-  return {check, 0_u64};
-}
-
-template <typename S, typename D>  // e.g. STXR<R32, M32W>
+template <typename S, typename D, int kOrder>  // e.g. STXR<R32, M32W, __ATOMIC_RELAXED>
 DEF_SEM_U32U64_RUN(STXR, S src1, D dst, R64 monitor) {
-  auto old_addr = Read(monitor);
-  uint32_t check;
-  if (old_addr == AddressOf(dst)) {
-    MWriteZExt(dst, Read(src1));
-    check = 0;  // Store succeeded.
-  } else {
-    check = 1;  // Store failed.
-  }
-  __remill_barrier_store_store(runtime_manager);
+  auto expected = static_cast<decltype(Read(src1))>(Read(monitor));
+  auto old_val = AtomicCmpXchg(dst, expected, Read(src1), kOrder);
+  uint32_t check = old_val == expected ? 0 : 1;  // 0: store succeeded, 1: store failed.
   return {check, 0_u64};
 }
 
 }  // namespace
 
-DEF_ISEL(LDXR_LR32_LDSTEXCL) =
-    LDXR_32<M32>;  // LDAXR  <Wt>, [<Xn|SP>{,#0}] // LDXR  <Wt>, [<Xn|SP>{,#0}]
-DEF_ISEL(LDXR_LR64_LDSTEXCL) =
-    LDXR_64<M64>;  // LDAXR  <Xt>, [<Xn|SP>{,#0}]  // LDXR  <Xt>, [<Xn|SP>{,#0}]
-DEF_ISEL(LDAXR_LR32_LDSTEXCL) = LDAXR_32<M32>;  // LDAXR  <Wt>, [<Xn|SP>{,#0}]
-DEF_ISEL(LDAXR_LR64_LDSTEXCL) = LDAXR_64<M64>;  // LDAXR  <Xt>, [<Xn|SP>{,#0}]
-DEF_ISEL(STLXR_SR32_LDSTEXCL) = STLXR<R32, M32W>;  // STLXR  <Ws>, <Wt>, [<Xn|SP>{,#0}]
-DEF_ISEL(STLXR_SR64_LDSTEXCL) = STLXR<R64, M64W>;  // STLXR  <Ws>, <Xt>, [<Xn|SP>{,#0}]
-DEF_ISEL(STXR_SR32_LDSTEXCL) = STXR<R32, M32W>;  // STXR  <Ws>, <Wt>, [<Xn|SP>{,#0}]
-DEF_ISEL(STXR_SR64_LDSTEXCL) = STXR<R64, M64W>;  // STXR  <Ws>, <Xt>, [<Xn|SP>{,#0}]
+DEF_ISEL(LDXR_LR32_LDSTEXCL) = LDXR_32<M32, __ATOMIC_RELAXED>;  // LDXR  <Wt>, [<Xn|SP>{,#0}]
+DEF_ISEL(LDXR_LR64_LDSTEXCL) = LDXR_64<M64, __ATOMIC_RELAXED>;  // LDXR  <Xt>, [<Xn|SP>{,#0}]
+DEF_ISEL(LDAXR_LR32_LDSTEXCL) = LDXR_32<M32, __ATOMIC_ACQUIRE>;  // LDAXR  <Wt>, [<Xn|SP>{,#0}]
+DEF_ISEL(LDAXR_LR64_LDSTEXCL) = LDXR_64<M64, __ATOMIC_ACQUIRE>;  // LDAXR  <Xt>, [<Xn|SP>{,#0}]
+DEF_ISEL(STLXR_SR32_LDSTEXCL) =
+    STXR<R32, M32W, __ATOMIC_RELEASE>;  // STLXR  <Ws>, <Wt>, [<Xn|SP>{,#0}]
+DEF_ISEL(STLXR_SR64_LDSTEXCL) =
+    STXR<R64, M64W, __ATOMIC_RELEASE>;  // STLXR  <Ws>, <Xt>, [<Xn|SP>{,#0}]
+DEF_ISEL(STXR_SR32_LDSTEXCL) =
+    STXR<R32, M32W, __ATOMIC_RELAXED>;  // STXR  <Ws>, <Wt>, [<Xn|SP>{,#0}]
+DEF_ISEL(STXR_SR64_LDSTEXCL) =
+    STXR<R64, M64W, __ATOMIC_RELAXED>;  // STXR  <Ws>, <Xt>, [<Xn|SP>{,#0}]
 
 namespace {
 
@@ -892,8 +879,7 @@ namespace {
 
 template <typename S>
 DEF_SEM_T_RUN(LoadAcquire, S src) {
-  __remill_barrier_load_store(runtime_manager);
-  return ReadMem(src);
+  return AtomicLoad(src, __ATOMIC_ACQUIRE);
 }
 
 }  // namespace
@@ -1795,31 +1781,32 @@ DEF_ISEL(BIC_ASIMDIMM_L_HL_8H) = BIC_L_HL<VIu16v8>;  // BIC  <Vd>.<T>, #<imm8>{,
 DEF_ISEL(BIC_ASIMDIMM_L_SL_2S) = BIC_L_SL<VIu32v2>;  // BIC  <Vd>.<T>, #<imm8>{, LSL #<amount>}
 DEF_ISEL(BIC_ASIMDIMM_L_SL_4S) = BIC_L_SL<VIu32v4>;  // BIC  <Vd>.<T>, #<imm8>{, LSL #<amount>}
 
-/* casa instruction semantics (FIXME: no atomic) */
+/* casa instruction semantics */
 namespace {
 
-template <typename T, typename D>
+template <typename T, typename D, int kOrder>
 DEF_SEM_T_RUN(CAS, T dst_src1, T src2, D dst_mem) {
-  T org_val = ReadMem(dst_mem);
-  T cmp_val = Read(dst_src1);
-  auto cond_eq = UCmpEq(org_val, cmp_val);
-  auto new_val = Select<T>(cond_eq, Read(src2), org_val);
-  MWriteTrunc(dst_mem, new_val);
-  return org_val;
+  return AtomicCmpXchg(dst_mem, Read(dst_src1), Read(src2), kOrder);
 }
 }  // namespace
 
-DEF_ISEL(CAS_C32_LDSTEXCL) = CAS<R32, M32W>;  // CAS  <Ws>, <Wt>, [<Xn|SP>{,#0}]
-DEF_ISEL(CAS_C64_LDSTEXCL) = CAS<R64, M64W>;  // CAS  <Xs>, <Xt>, [<Xn|SP>{,#0}]
+DEF_ISEL(CAS_C32_LDSTEXCL) = CAS<R32, M32W, __ATOMIC_RELAXED>;  // CAS  <Ws>, <Wt>, [<Xn|SP>{,#0}]
+DEF_ISEL(CAS_C64_LDSTEXCL) = CAS<R64, M64W, __ATOMIC_RELAXED>;  // CAS  <Xs>, <Xt>, [<Xn|SP>{,#0}]
 
-DEF_ISEL(CASA_C32_LDSTEXCL) = CAS<R32, M32W>;  // CAS  <Ws>, <Wt>, [<Xn|SP>{,#0}]
-DEF_ISEL(CASA_C64_LDSTEXCL) = CAS<R64, M64W>;  // CAS  <Xs>, <Xt>, [<Xn|SP>{,#0}]
+DEF_ISEL(CASA_C32_LDSTEXCL) =
+    CAS<R32, M32W, __ATOMIC_ACQUIRE>;  // CASA  <Ws>, <Wt>, [<Xn|SP>{,#0}]
+DEF_ISEL(CASA_C64_LDSTEXCL) =
+    CAS<R64, M64W, __ATOMIC_ACQUIRE>;  // CASA  <Xs>, <Xt>, [<Xn|SP>{,#0}]
 
-DEF_ISEL(CASAL_C32_LDSTEXCL) = CAS<R32, M32W>;  // CAS  <Ws>, <Wt>, [<Xn|SP>{,#0}]
-DEF_ISEL(CASAL_C64_LDSTEXCL) = CAS<R64, M64W>;  // CAS  <Xs>, <Xt>, [<Xn|SP>{,#0}]
+DEF_ISEL(CASAL_C32_LDSTEXCL) =
+    CAS<R32, M32W, __ATOMIC_ACQ_REL>;  // CASAL  <Ws>, <Wt>, [<Xn|SP>{,#0}]
+DEF_ISEL(CASAL_C64_LDSTEXCL) =
+    CAS<R64, M64W, __ATOMIC_ACQ_REL>;  // CASAL  <Xs>, <Xt>, [<Xn|SP>{,#0}]
 
-DEF_ISEL(CASL_C32_LDSTEXCL) = CAS<R32, M32W>;  // CAS  <Ws>, <Wt>, [<Xn|SP>{,#0}]
-DEF_ISEL(CASL_C64_LDSTEXCL) = CAS<R64, M64W>;  // CAS  <Xs>, <Xt>, [<Xn|SP>{,#0}]
+DEF_ISEL(CASL_C32_LDSTEXCL) =
+    CAS<R32, M32W, __ATOMIC_RELEASE>;  // CASL  <Ws>, <Wt>, [<Xn|SP>{,#0}]
+DEF_ISEL(CASL_C64_LDSTEXCL) =
+    CAS<R64, M64W, __ATOMIC_RELEASE>;  // CASL  <Xs>, <Xt>, [<Xn|SP>{,#0}]
 
 namespace {
 
@@ -120,10 +120,8 @@ namespace {
   DEF_SEM_T(DUP_##size, R64 src) { \
     auto val = TruncTo<uint##size##_t>(Read(src)); \
     V vec = {}; \
-    _Pragma("unroll") for (size_t i = 0; i < GetVectorElemsNum(vec); ++i) { \
-      vec[i] = val; \
-    } \
-    return vec; \
+    /* the scalar operand is splatted to every lane */ \
+    return vec + val; \
   }  // namespace
 
 MAKE_DUP(8) MAKE_DUP(16) MAKE_DUP(32) MAKE_DUP(64)
@@ -150,10 +148,7 @@ namespace {
     V src_vec = UReadVI##size(src); \
     auto val = TruncTo<uint##size##_t>(UExtractVI##size(src_vec, index)); \
     V vec = {}; \
-    _Pragma("unroll") for (size_t i = 0; i < GetVectorElemsNum(vec); i++) { \
-      vec[i] = val; \
-    } \
-    return vec; \
+    return vec + val; \
   }
 
 MAKE_DUP(8);
@@ -188,16 +183,73 @@ ALWAYS_INLINE static T UMax(T lhs, T rhs) {
 #define SMin UMin
 #define SMax UMax
 
+/* Whole-vector operators on the `vector_size` types. These are lowered to one LLVM
+   vector instruction (e.g. `add <16 x i8>`, `icmp ult <8 x i16>`, `fmul <4 x float>`)
+   instead of the per-lane extractelement/insertelement chain, so that the wasm backend
+   can select the SIMD128 instructions. The signedness comes from the element type.
+   `rhs` can also be a scalar, which is splatted to every lane. */
+template <typename V, typename T>
+ALWAYS_INLINE static V VecAdd(V lhs, T rhs) {
+  return lhs + rhs;
+}
+
+template <typename V, typename T>
+ALWAYS_INLINE static V VecSub(V lhs, T rhs) {
+  return lhs - rhs;
+}
+
+template <typename V, typename T>
+ALWAYS_INLINE static V VecMul(V lhs, T rhs) {
+  return lhs * rhs;
+}
+
+template <typename V>
+ALWAYS_INLINE static V VecMin(V lhs, V rhs) {
+  return __builtin_elementwise_min(lhs, rhs);
+}
+
+template <typename V>
+ALWAYS_INLINE static V VecMax(V lhs, V rhs) {
+  return __builtin_elementwise_max(lhs, rhs);
+}
+
+/* the vector compares yield all ones (true) or zero (false) in every lane */
+template <typename V, typename T>
+ALWAYS_INLINE static auto VecCmpEq(V lhs, T rhs) {
+  return lhs == rhs;
+}
+
+template <typename V, typename T>
+ALWAYS_INLINE static auto VecCmpLt(V lhs, T rhs) {
+  return lhs < rhs;
+}
+
+template <typename V, typename T>
+ALWAYS_INLINE static auto VecCmpLte(V lhs, T rhs) {
+  return lhs <= rhs;
+}
+
+template <typename V, typename T>
+ALWAYS_INLINE static auto VecCmpGt(V lhs, T rhs) {
+  return lhs > rhs;
+}
+
+template <typename V, typename T>
+ALWAYS_INLINE static auto VecCmpGte(V lhs, T rhs) {
+  return lhs >= rhs;
+}
+
+template <typename V, typename T>
+ALWAYS_INLINE static auto VecCmpTst(V lhs, T rhs) {
+  return (lhs & rhs) != 0;
+}
+
 #define MAKE_BROADCAST(op, prefix, binop, size) \
   template <typename V> \
   DEF_SEM_T(op##_##size, V src1, V src2) { \
     auto vec1 = prefix##ReadVI##size(src1); \
     auto vec2 = prefix##ReadVI##size(src2); \
-    V sum = {}; \
-    _Pragma("unroll") for (size_t i = 0, max_i = GetVectorElemsNum(sum); i < max_i; ++i) { \
-      sum[i] = prefix##binop(prefix##ExtractVI##size(vec1, i), prefix##ExtractVI##size(vec2, i)); \
-    } \
-    return sum; \
+    return Vec##binop(vec1, vec2); \
   }
 
 MAKE_BROADCAST(ADD, U, Add, 8)
@@ -280,15 +332,8 @@ namespace {
   template <typename SV, typename V> \
   DEF_SEM_T(op##_##size, SV src1, I##size imm) { \
     auto vec1 = prefix##ReadVI##size(src1); \
-    auto ucmp_val = Read(imm); \
-    auto cmp_val = Signed(ucmp_val); \
-    decltype(ucmp_val) zeros = 0; \
-    decltype(ucmp_val) ones = ~zeros; \
-    V res = {}; \
-    _Pragma("unroll") for (size_t i = 0, max_i = GetVectorElemsNum(res); i < max_i; ++i) { \
-      res[i] = Select(prefix##binop(prefix##ExtractVI##size(vec1, i), cmp_val), ones, zeros); \
-    } \
-    return res; \
+    auto cmp_val = Signed(Read(imm)); \
+    return (V) Vec##binop(vec1, cmp_val); \
   }
 
 MAKE_CMP_BROADCAST(CMPEQ_IMM, S, CmpEq, 8)
@@ -392,22 +437,9 @@ namespace {
   DEF_SEM_T(op##_##size, SV src1, SV src2) { \
     auto vec1 = prefix##ReadVI##size(src1); \
     auto vec2 = prefix##ReadVI##size(src2); \
-    uint##size##_t zeros = 0; \
-    uint##size##_t ones = ~zeros; \
-    V res = {}; \
-    _Pragma("unroll") for (size_t i = 0, max_i = GetVectorElemsNum(res); i < max_i; ++i) { \
-      res[i] = Select( \
-          prefix##binop(prefix##ExtractVI##size(vec1, i), prefix##ExtractVI##size(vec2, i)), ones, \
-          zeros); \
-    } \
-    return res; \
+    return (V) Vec##binop(vec1, vec2); \
   }
 
-template <typename T>
-ALWAYS_INLINE static bool UCmpTst(T lhs, T rhs) {
-  return UCmpNeq(UAnd(lhs, rhs), T(0));
-}
-
 MAKE_CMP_BROADCAST(CMPEQ, S, CmpEq, 8)
 MAKE_CMP_BROADCAST(CMPEQ, S, CmpEq, 16)
 MAKE_CMP_BROADCAST(CMPEQ, S, CmpEq, 32)
@@ -939,22 +971,13 @@ namespace {
 #define MAKE_FTWICEOP_ASIMDSAME_ONLY(prefix, elem_size, op1, op2) \
   template <typename V> \
   DEF_SEM_T(F##prefix##_V##elem_size, V dst_src, V src1, V src2) { \
-    /* it might good to use F##binop##V##elem_size (e.g. FAddV32)*/ \
     auto dst_src_v = FReadVI##elem_size(dst_src); \
     auto srcv1 = FReadVI##elem_size(src1); \
     auto srcv2 = FReadVI##elem_size(src2); \
-    V res = {}; \
     /* res = Vn op1 Vm */ \
-    _Pragma("unroll") for (size_t i = 0; i < GetVectorElemsNum(srcv1); i++) { \
-      res[i] = CheckedFloatBinOp(F##op1##elem_size, FExtractVI##elem_size(srcv1, i), \
-                                 FExtractVI##elem_size(srcv2, i)); \
-    } \
+    V res = Vec##op1(srcv1, srcv2); \
     /* res = res op2 Vd */ \
-    _Pragma("unroll") for (size_t i = 0; i < GetVectorElemsNum(dst_src_v); i++) { \
-      res[i] = CheckedFloatBinOp(F##op2##elem_size, FExtractVI##elem_size(dst_src_v, i), \
-                                 FExtractVI##elem_size(res, i)); \
-    } \
-    return res; \
+    return Vec##op2(dst_src_v, res); \
   }
 
 // no support of float16
@@ -977,23 +1000,14 @@ namespace {
 #define MAKE_FTWICEOP_ASIMDELEM_R_SD(prefix, elem_size, op1, op2) \
   template <typename V> \
   DEF_SEM_T(F##prefix##_ELEM_V##elem_size, V dst_src, V src1, V src2, I64 index) { \
-    /* it might good to use F##binop##V##elem_size (e.g. FAddV32)*/ \
     auto dst_src_v = FReadVI##elem_size(dst_src); \
     auto srcv1 = FReadVI##elem_size(src1); \
     auto srcv2 = FReadVI##elem_size(src2); \
     auto id = Read(index); \
-    V res = {}; \
-    /* res = Vn op1 Vm */ \
-    _Pragma("unroll") for (size_t i = 0; i < GetVectorElemsNum(srcv1); i++) { \
-      res[i] = CheckedFloatBinOp(F##op1##elem_size, FExtractVI##elem_size(srcv1, i), \
-                                 FExtractVI##elem_size(srcv2, id)); \
-    } \
+    /* res = Vn op1 Vm[<index>] */ \
+    V res = Vec##op1(srcv1, FExtractVI##elem_size(srcv2, id)); \
     /* res = res op2 Vd */ \
-    _Pragma("unroll") for (size_t i = 0; i < GetVectorElemsNum(dst_src_v); i++) { \
-      res[i] = CheckedFloatBinOp(F##op2##elem_size, FExtractVI##elem_size(dst_src_v, i), \
-                                 FExtractVI##elem_size(res, i)); \
-    } \
-    return res; \
+    return Vec##op2(dst_src_v, res); \
   }
 
 MAKE_FTWICEOP_ASIMDELEM_R_SD(MLA, 32, Mul, Add);
@@ -1017,16 +1031,10 @@ namespace {
 #define MAKE_FONCEOP_ASIMDSAME_ONLY(prefix, elem_size, op) \
   template <typename V> \
   DEF_SEM_T(F##prefix##_V##elem_size, V src1, V src2) { \
-    /* it might be good to use F##binop##V##elem_size (e.g. FAddV32)*/ \
     auto srcv1 = FReadVI##elem_size(src1); \
     auto srcv2 = FReadVI##elem_size(src2); \
-    V res = {}; \
     /* res = Vn op Vm */ \
-    _Pragma("unroll") for (size_t i = 0; i < GetVectorElemsNum(srcv1); i++) { \
-      res[i] = CheckedFloatBinOp(F##op##elem_size, FExtractVI##elem_size(srcv1, i), \
-                                 FExtractVI##elem_size(srcv2, i)); \
-    } \
-    return res; \
+    return Vec##op(srcv1, srcv2); \
   }  // namespace
 
 // no support of float16
@@ -1057,13 +1065,9 @@ namespace {
     auto index = Read(imm); \
     auto srcv1 = FReadVI##elem_size(src1); \
     auto srcv2 = FReadVI##elem_size(src2); \
-    V res = {}; \
     auto v2_val = FExtractVI##elem_size(srcv2, index); \
-    /* res = Vn + Vm[<index>] */ \
-    _Pragma("unroll") for (size_t i = 0; i < GetVectorElemsNum(srcv1); i++) { \
-      res[i] = CheckedFloatBinOp(F##op##elem_size, FExtractVI##elem_size(srcv1, i), v2_val); \
-    } \
-    return res; \
+    /* res = Vn op Vm[<index>] */ \
+    return Vec##op(srcv1, v2_val); \
   }  // namespace
 
 // no support of float16
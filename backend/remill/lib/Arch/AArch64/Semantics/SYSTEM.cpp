@@ -16,8 +16,11 @@
 
 namespace {
 
-extern "C" void emulate_system_call(State &state, RuntimeManager *runtime_manager, I32 imm) {
+extern "C" void emulate_system_call(State &state, RuntimeManager *runtime_manager, I32 imm,
+                                    I64 pc) {
   // Linux always get 0 for the argument of `svc` exception (I32 imm).
+  // The lifted code doesn't store PC, so the runtime gets it here.
+  state.gpr.pc = {.qword = Read(pc)};
   __remill_syscall_tranpoline_call(state, runtime_manager);
 }
 
@@ -100,7 +103,8 @@ DEF_SEM_VOID_RUN(DataMemoryBarrier) {
 
   // TODO(pag): Full-system data memory barrier probably requires a synchronous
   //            hypercall if it behaves kind of like Linux's `sys_membarrier`.
-  __remill_barrier_store_store(runtime_manager);
+  // DMB is lowered to the full fence whatever the option (ISH, ISHLD, ISHST, ...) is.
+  __remill_barrier_store_load(runtime_manager);
 }
 
 }  // namespace
@@ -76,6 +76,23 @@ extern "C" [[gnu::used]] void __remill_intrinsics(void) {
   USED(__remill_atomic_begin);
   USED(__remill_atomic_end);
 
+  USED(__remill_atomic_load_memory_8);
+  USED(__remill_atomic_load_memory_16);
+  USED(__remill_atomic_load_memory_32);
+  USED(__remill_atomic_load_memory_64);
+  USED(__remill_atomic_store_memory_8);
+  USED(__remill_atomic_store_memory_16);
+  USED(__remill_atomic_store_memory_32);
+  USED(__remill_atomic_store_memory_64);
+  USED(__remill_atomic_swap_memory_32);
+  USED(__remill_atomic_swap_memory_64);
+  USED(__remill_atomic_add_memory_32);
+  USED(__remill_atomic_add_memory_64);
+  USED(__remill_atomic_or_memory_32);
+  USED(__remill_atomic_or_memory_64);
+  USED(__remill_atomic_cmpxchg_memory_32);
+  USED(__remill_atomic_cmpxchg_memory_64);
+
   USED(__remill_delay_slot_begin);
   USED(__remill_delay_slot_end);
 
@@ -56,7 +56,7 @@ llvm::Function *GetInstructionFunction(llvm::Module *module, std::string_view fu
 /*
   AArch64 register methods.
 */
-std::unordered_map<llvm::Value *, uint64_t> Sema_func_vma_map = {};
+thread_local std::unordered_map<llvm::Value *, uint64_t> Sema_func_vma_map = {};
 
 // get ERC from the register name.
 std::pair<EcvReg, ERC> EcvReg::GetRegInfo(const std::string &_reg_name) {
@@ -344,7 +344,10 @@ bool EcvReg::CheckPassedArgsRegs() const {
   return (0 <= number && number <= 8) || SP_ORDER == number;
 }
 
+// X0-X1 and V0-V3 (e.g. the HFA with four members) hold the return value in AAPCS64.
 bool EcvReg::CheckPassedReturnRegs() const {
+  if (RegKind::Vector == reg_kind)
+    return number <= 3;
   return (0 <= number && number <= 1) || SP_ORDER == number;
 }
 
@@ -34,6 +34,8 @@
 #include <llvm/IR/Metadata.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Type.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Passes/PassBuilder.h>
 #include <llvm/Transforms/IPO.h>
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
 #include <llvm/Transforms/Scalar.h>
@@ -120,4 +122,35 @@ void OptimizeBareModule(llvm::Module *module, OptimizationGuide guide) {
   module_manager.run(*module);
 }
 
+// Optimize the whole lifted module with the new pass manager.
+void OptimizeLiftedModule(llvm::Module *module, unsigned opt_level) {
+  llvm::LoopAnalysisManager loop_manager;
+  llvm::FunctionAnalysisManager func_manager;
+  llvm::CGSCCAnalysisManager cgscc_manager;
+  llvm::ModuleAnalysisManager module_manager;
+
+  llvm::PipelineTuningOptions tuning;
+  tuning.LoopUnrolling = true;
+  tuning.LoopVectorization = opt_level >= 2;
+  tuning.SLPVectorization = opt_level >= 2;
+  llvm::PassBuilder builder(nullptr, tuning);
+
+  llvm::TargetLibraryInfoImpl TLI(llvm::Triple(module->getTargetTriple()));
+  TLI.disableAllFunctions();  // `-fno-builtin`.
+  // Registered before the default analyses so that this one is used.
+  func_manager.registerPass([&] { return llvm::TargetLibraryAnalysis(TLI); });
+
+  builder.registerModuleAnalyses(module_manager);
+  builder.registerCGSCCAnalyses(cgscc_manager);
+  builder.registerFunctionAnalyses(func_manager);
+  builder.registerLoopAnalyses(loop_manager);
+  builder.crossRegisterProxies(loop_manager, func_manager, cgscc_manager, module_manager);
+
+  auto level = 1 == opt_level   ? llvm::OptimizationLevel::O1
+               : 2 == opt_level ? llvm::OptimizationLevel::O2
+                                : llvm::OptimizationLevel::O3;
+  auto module_pass_manager = builder.buildPerModuleDefaultPipeline(level);
+  module_pass_manager.run(*module, module_manager);
+}
+
 }  // namespace remill
@@ -19,6 +19,7 @@
 #include <glog/logging.h>
 #include <iostream>
 #include <llvm/IR/Instructions.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Type.h>
 #include <map>
 #include <remill/Arch/Instruction.h>
@@ -29,6 +30,7 @@
 #include <remill/BC/Util.h>
 #include <set>
 #include <sstream>
+#include <sys/resource.h>
 
 extern remill::ArchName TARGET_ELF_ARCH;
 
@@ -38,7 +40,7 @@ namespace remill {
 #if defined(OPT_ALGO_DEBUG)
 #  define ECV_LOG(...) EcvLog(__VA_ARGS__)
 #  define ECV_LOG_NL(...) EcvLogNL(__VA_ARGS__)
-#  define DEBUG_REMOVE_LOOP_GRAPH(bag) PhiRegsBBBagNode::DebugGraphStruct(bag)
+#  define DEBUG_REMOVE_LOOP_GRAPH(bag) DebugGraphStruct(bag)
 #else
 #  define ECV_LOG(...)
 #  define ECV_LOG_NL(...)
@@ -55,7 +57,14 @@ namespace remill {
     ecv_reg.GetRegName(ecv_reg_class) + "_" + to_string(phi_val_order++)
 #endif
 
-std::ostringstream ECV_DEBUG_STREAM;
+thread_local std::ostringstream ECV_DEBUG_STREAM;
+
+void LiftStats::AddPhase(std::string name, std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double, std::milli> wall = std::chrono::steady_clock::now() - start;
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  phases.push_back({std::move(name), wall.count(), usage.ru_maxrss});
+}
 
 static void DebugStreamReset() {
   ECV_DEBUG_STREAM.str("");
@@ -107,6 +116,14 @@ void TraceManager::ForEachDevirtualizedTarget(
   // Must be extended.
 }
 
+// Try to read `size` executable bytes starting at `addr`.
+bool TraceManager::TryReadExecutableBytes(uint64_t addr, uint8_t *bytes, size_t size) {
+  for (size_t i = 0; i < size; i++)
+    if (!TryReadExecutableByte(addr + i, &bytes[i]))
+      return false;
+  return true;
+}
+
 // Figure out the name for the trace starting at address `addr`.
 std::string TraceManager::TraceName(uint64_t addr) {
   std::stringstream ss;
@@ -255,7 +272,24 @@ void TraceLifter::Impl::ConditionalBranchWithSaveParents(llvm::BasicBlock *true_
   auto &false_parents = virtual_regs_opt->bb_parents[false_bb];
   true_parents.insert(src_bb);
   false_parents.insert(src_bb);
-  llvm::BranchInst::Create(true_bb, false_bb, condition, src_bb);
+  if (profile_branch) {
+    auto profile_branch_fn = module->getFunction(g_profile_branch_func_name);
+    CHECK(profile_branch_fn);
+    llvm::CallInst::Create(profile_branch_fn,
+                           {llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), inst.pc),
+                            condition},
+                           "", src_bb);
+  }
+  auto br_inst = llvm::BranchInst::Create(true_bb, false_bb, condition, src_bb);
+  if (profile && profile->branch_counts.contains(inst.pc)) {
+    auto [taken, not_taken] = profile->branch_counts.at(inst.pc);
+    // scale the counts into the 32 bit weights (+1 not to make the edge unreachable).
+    auto scale = std::max(taken, not_taken) / (UINT32_MAX - 1) + 1;
+    br_inst->setMetadata(llvm::LLVMContext::MD_prof,
+                         llvm::MDBuilder(context).createBranchWeights(
+                             static_cast<uint32_t>(taken / scale + 1),
+                             static_cast<uint32_t>(not_taken / scale + 1)));
+  }
 }
 
 /*
@@ -271,6 +305,14 @@ void TraceLifter::NullCallback(uint64_t, llvm::Function *) {}
 // Reads the bytes of an instruction at `addr` into `inst_bytes`.
 bool TraceLifter::Impl::ReadInstructionBytes(uint64_t addr) {
   inst_bytes.clear();
+  // fast path: fetch the whole instruction at once.
+  if (((addr + max_inst_bytes - 1) & addr_mask) >= addr) {
+    inst_bytes.resize(max_inst_bytes);
+    if (manager.TryReadExecutableBytes(addr, reinterpret_cast<uint8_t *>(inst_bytes.data()),
+                                       max_inst_bytes))
+      return true;
+    inst_bytes.clear();
+  }
   for (size_t i = 0; i < max_inst_bytes; ++i) {
     const auto byte_addr = (addr + i) & addr_mask;
     if (byte_addr < addr) {
@@ -338,6 +380,10 @@ bool TraceLifter::Impl::Lift(uint64_t addr, const char *fn_name,
     if (func) {
       continue;
     }
+    // Lifted by another lifter (e.g. the other worker of `--jobs`).
+    if (!manager.isLiftTarget(trace_addr)) {
+      continue;
+    }
 
     DLOG(INFO) << "Lifting trace at address " << std::hex << trace_addr << std::dec;
 
@@ -354,12 +400,22 @@ bool TraceLifter::Impl::Lift(uint64_t addr, const char *fn_name,
     virtual_regs_opt = new VirtualRegsOpt(func, this, trace_addr);
     virtual_regs_opt->func_name = func->getName().str();
     VirtualRegsOpt::func_v_r_opt_map.insert({func, virtual_regs_opt});
+    LiftFuncStats fn_stats;
 
     // Fill in the function, and make sure the block with all register
     // variables jumps to the block that will contain the first instruction
     // of the trace.
     arch->InitializeEmptyLiftedFunction(func);
 
+    // the calls of the previous run (--profile).
+    if (profile) {
+      auto fn_count =
+          profile->fn_counts.contains(trace_addr) ? profile->fn_counts.at(trace_addr) : 0;
+      func->setEntryCount(fn_count);
+      if (fn_count == 0)
+        func->addFnAttr(llvm::Attribute::Cold);
+    }
+
     auto state_ptr = NthArgument(func, kStatePointerArgNum);
     auto runtime_ptr = NthArgument(func, kRuntimePointerArgNum);
 
@@ -439,6 +495,7 @@ bool TraceLifter::Impl::Lift(uint64_t addr, const char *fn_name,
       // TODO(Ian): not passing context around in trace lifter
       std::ignore =
           arch->DecodeInstruction(inst_addr, inst_bytes, inst, this->arch->CreateInitialContext());
+      fn_stats.inst_num++;
 
       // Lift instruction
       auto lift_status = inst.GetLifter()->LiftIntoBlock(inst, block, state_ptr, bb_reg_info_node);
@@ -530,15 +587,37 @@ bool TraceLifter::Impl::Lift(uint64_t addr, const char *fn_name,
         /* case: BR instruction (only BR in glibc) */
         case Instruction::kCategoryIndirectJump: {
           try_add_delay_slot(true, block);
+          fn_stats.indirect_jump_num++;
           /* indirectbr entry block */
           indirectbr_block = GetOrCreateIndirectJmpBlock();
           if (!virtual_regs_opt->bb_reg_info_node_map.contains(indirectbr_block)) {
             virtual_regs_opt->bb_reg_info_node_map.insert(
                 {indirectbr_block, new BBRegInfoNode(func, state_ptr, runtime_ptr)});
           }
-          br_blocks.push_back({block, FindIndirectBrAddress(block)});
+          auto br_addr = FindIndirectBrAddress(block);
+          auto br_src_block = block;
+          /* switch to the known targets (jump table) and use indirectbr block for the others */
+          std::vector<uint64_t> br_targets;
+          if (manager.TryGetIndirectJumpTargets(trace_addr, inst_addr, br_targets)) {
+            auto fallback_block = llvm::BasicBlock::Create(context, "", func);
+            virtual_regs_opt->bb_reg_info_node_map.insert(
+                {fallback_block, new BBRegInfoNode(func, state_ptr, runtime_ptr)});
+            auto switch_inst =
+                llvm::SwitchInst::Create(br_addr, fallback_block, br_targets.size(), block);
+            virtual_regs_opt->bb_parents[fallback_block].insert(block);
+            for (auto br_target : br_targets) {
+              inst_work_list.insert(br_target);
+              auto target_block = GetOrCreateBlock(br_target);
+              switch_inst->addCase(
+                  llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), br_target),
+                  target_block);
+              virtual_regs_opt->bb_parents[target_block].insert(block);
+            }
+            br_src_block = fallback_block;
+          }
+          br_blocks.push_back({br_src_block, br_addr});
           /* jmp to indirectbr block */
-          DirectBranchWithSaveParents(indirectbr_block, block);
+          DirectBranchWithSaveParents(indirectbr_block, br_src_block);
           break;
         }
 
@@ -549,7 +628,9 @@ bool TraceLifter::Impl::Lift(uint64_t addr, const char *fn_name,
 
           // if the next instruction is not included in this function, jumping to it is illegal.
           // Therefore, we force to return at this block because we assume that this instruction don't come back to.
-          if (manager.isFunctionEntry(inst.next_pc)) {
+          // (the child entry of clone is included in this function and the parent comes back to it.)
+          if (manager.isFunctionEntry(inst.next_pc) &&
+              !manager.isWithinFunction(trace_addr, inst.next_pc)) {
             llvm::ReturnInst::Create(context, block);
           } else {
             goto check_call_return;
@@ -559,6 +640,7 @@ bool TraceLifter::Impl::Lift(uint64_t addr, const char *fn_name,
         /* case: BLR instruction (only BLR in glibc) */
         case Instruction::kCategoryIndirectFunctionCall: {
           try_add_delay_slot(true, block);
+          fn_stats.indirect_call_num++;
           auto not_taken_block = GetOrCreateBranchNotTakenBlock();
           // indirect jump address is value of %Xzzz just before
           auto lifted_func_call =
@@ -825,15 +907,6 @@ bool TraceLifter::Impl::Lift(uint64_t addr, const char *fn_name,
                                              func->getName() + ".bb_addrs");
       auto g_bb_addr_vmas = GenGlobalArrayHelper(llvm::Type::getInt64Ty(context), bb_addr_vmas,
                                                  func->getName() + ".bb_addr_vmas");
-      /* save pointers of the array */
-      manager.g_block_address_ptrs_array.push_back(
-          llvm::ConstantExpr::getBitCast(g_bb_addrs, llvm::Type::getInt64PtrTy(context)));
-      manager.g_block_address_vmas_array.push_back(
-          llvm::ConstantExpr::getBitCast(g_bb_addr_vmas, llvm::Type::getInt64PtrTy(context)));
-      manager.g_block_address_size_array.push_back(
-          llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), bb_addrs.size()));
-      manager.g_block_address_fn_vma_array.push_back(
-          llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), trace_addr));
       /* indirectbr_block */
       llvm::IRBuilder<> ir_1(indirectbr_block);
       /* calculate the target block address */
@@ -847,10 +920,11 @@ bool TraceLifter::Impl::Lift(uint64_t addr, const char *fn_name,
         br_vma_phi->addIncoming(dest_addr, br_block);
         virtual_regs_opt->bb_parents[br_block].insert(indirectbr_block);
       }
+      /* the helper searches the (sorted) vma array of this function in place */
       auto target_bb_i64 = ir_1.CreateCall(
           g_get_jmp_helper_fn,
-          {runtime_ptr, llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), trace_addr),
-           br_vma_phi});
+          {runtime_ptr, g_bb_addr_vmas, g_bb_addrs,
+           llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), bb_addrs.size()), br_vma_phi});
       auto indirect_br_i = ir_1.CreateIndirectBr(
           ir_1.CreatePointerCast(target_bb_i64, llvm::Type::getInt64PtrTy(context)),
           bb_addrs.size());
@@ -951,6 +1025,47 @@ bool TraceLifter::Impl::Lift(uint64_t addr, const char *fn_name,
       }
     }
 
+    // the first block of the guest basic block (not only reached by the fall-through of the
+    // previous instruction).
+    auto is_guest_block_head = [&](std::map<uint64_t, llvm::BasicBlock *>::iterator it) {
+      if (it->first == trace_addr || it == lifted_block_map.begin())
+        return true;
+      auto prev_block = std::prev(it)->second;
+      return it->second->getSinglePredecessor() != prev_block ||
+             prev_block->getTerminator()->getNumSuccessors() != 1;
+    };
+
+    if (stats) {
+      for (auto it = lifted_block_map.begin(); it != lifted_block_map.end(); it++)
+        fn_stats.block_num += is_guest_block_head(it);
+      stats->funcs[trace_addr] = fn_stats;
+    }
+
+    // mark the first block of every guest basic block for the profile counter.
+    if (profile_block) {
+      auto profile_block_fn = module->getFunction(g_profile_block_func_name);
+      CHECK(profile_block_fn);
+      for (auto it = lifted_block_map.begin(); it != lifted_block_map.end(); it++) {
+        if (!is_guest_block_head(it))
+          continue;
+        llvm::CallInst::Create(profile_block_fn,
+                               {llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), it->first)},
+                               "", &*it->second->getFirstInsertionPt());
+      }
+    }
+
+    // move the guest basic blocks which were not executed in the previous run to the end.
+    if (profile && profile->fn_counts.contains(trace_addr) && !profile->block_counts.empty()) {
+      uint64_t block_count = 0;
+      for (auto it = lifted_block_map.begin(); it != lifted_block_map.end(); it++) {
+        if (is_guest_block_head(it))
+          block_count =
+              profile->block_counts.contains(it->first) ? profile->block_counts.at(it->first) : 0;
+        if (block_count == 0)
+          it->second->moveAfter(&func->back());
+      }
+    }
+
     callback(trace_addr, func);
     manager.SetLiftedTraceDefinition(trace_addr, func);
     virtual_regs_opt->block_num = lifted_block_map.size();
@@ -965,6 +1080,7 @@ void TraceLifter::Impl::Optimize() {
   arch->InstanceMinimumInst(inst);
 
   // Opt: AnalyzeRegsBags.
+  auto opt_start = std::chrono::steady_clock::now();
   int opt_cnt = 1;
   for (auto lifted_func : no_indirect_lifted_funcs) {
     std::cout << "\r["
@@ -974,11 +1090,20 @@ void TraceLifter::Impl::Optimize() {
               << "]"
               << " Opt Pass 1: [" << opt_cnt << "/" << no_indirect_lifted_funcs.size() << "]"
               << std::flush;
-    auto virtual_regs_opt = VirtualRegsOpt::func_v_r_opt_map[lifted_func];
+    auto virtual_regs_opt = VirtualRegsOpt::func_v_r_opt_map.at(lifted_func);
+    auto fn_opt_start = std::chrono::steady_clock::now();
     virtual_regs_opt->AnalyzeRegsBags();
+    if (stats)
+      stats->funcs[virtual_regs_opt->fun_vma].opt_ms +=
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                    fn_opt_start)
+              .count();
     opt_cnt++;
   }
   std::cout << std::endl;
+  if (stats)
+    stats->AddPhase("opt_pass1", opt_start);
+  opt_start = std::chrono::steady_clock::now();
 
   // Add __remill_function_call to func_v_r_opt_map for register store selection of calling it.
   auto __remill_func_call_fn = module->getFunction("__remill_function_call");
@@ -996,6 +1121,7 @@ void TraceLifter::Impl::Optimize() {
   VirtualRegsOpt::CalPassedCallerRegForBJump();
 
   // Opt: OptimizeVirtualRegsUsage.
+  // func_v_r_opt_map is read only from here, every function only updates its own VirtualRegsOpt.
   int opt_cnt2 = 1;
   for (auto lifted_func : no_indirect_lifted_funcs) {
     std::cout << "\r["
@@ -1005,11 +1131,19 @@ void TraceLifter::Impl::Optimize() {
               << "]"
               << " Opt Pass 2: [" << opt_cnt2 << "/" << no_indirect_lifted_funcs.size() << "]"
               << std::flush;
-    auto virtual_regs_opt = VirtualRegsOpt::func_v_r_opt_map[lifted_func];
+    auto virtual_regs_opt = VirtualRegsOpt::func_v_r_opt_map.at(lifted_func);
+    auto fn_opt_start = std::chrono::steady_clock::now();
     virtual_regs_opt->OptimizeVirtualRegsUsage();
+    if (stats)
+      stats->funcs[virtual_regs_opt->fun_vma].opt_ms +=
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                    fn_opt_start)
+              .count();
     opt_cnt2++;
   }
   std::cout << std::endl;
+  if (stats)
+    stats->AddPhase("opt_pass2", opt_start);
 
   // Insert `debug_string` for the every function
 #if defined(OPT_CALL_FUNC_DEBUG) || defined(OPT_REAL_REGS_DEBUG)
@@ -1076,7 +1210,7 @@ void PhiRegsBBBagNode::MergeFamilyBags(PhiRegsBBBagNode *merged_bag) {
   }
 }
 
-void PhiRegsBBBagNode::RemoveLoop(llvm::BasicBlock *root_bb) {
+void PhiRegsBBBagGraph::RemoveLoop(llvm::BasicBlock *root_bb) {
 
   ECV_LOG_NL(std::dec, "[DEBUG LOG]: ", "func: PhiRegsBBbagNode::RemoveLoop. target func: ",
              root_bb->getParent()->getName().str());
@@ -1282,7 +1416,7 @@ void PhiRegsBBBagNode::RemoveLoop(llvm::BasicBlock *root_bb) {
 #endif
 }
 
-void PhiRegsBBBagNode::GetPrecedingVirtualRegsBags(llvm::BasicBlock *root_bb) {
+void PhiRegsBBBagGraph::GetPrecedingVirtualRegsBags(llvm::BasicBlock *root_bb) {
   ECV_LOG_NL("[DEBUG LOG]: ", "func: PhiRegsBBbagNode::GetPrecedingVirtualRegsBags. target func: ",
              root_bb->getParent()->getName().str());
   std::queue<PhiRegsBBBagNode *> bag_queue;
@@ -1370,7 +1504,7 @@ void PhiRegsBBBagNode::GetPrecedingVirtualRegsBags(llvm::BasicBlock *root_bb) {
   DebugStreamReset();
 }
 
-void PhiRegsBBBagNode::GetSucceedingVirtualRegsBags(llvm::BasicBlock *root_bb) {
+void PhiRegsBBBagGraph::GetSucceedingVirtualRegsBags(llvm::BasicBlock *root_bb) {
   ECV_LOG_NL("[DEBUG LOG]: ", "func: PhiRegsBBbagNode::GetSucceedingVirtualRegsBags. target func: ",
              root_bb->getParent()->getName().str());
   std::stack<PhiRegsBBBagNode *> bag_stack;
@@ -1436,18 +1570,18 @@ void PhiRegsBBBagNode::GetSucceedingVirtualRegsBags(llvm::BasicBlock *root_bb) {
   DebugStreamReset();
 }
 
-void PhiRegsBBBagNode::GetPhiRegsBags(
+void PhiRegsBBBagGraph::GetPhiRegsBags(
     llvm::BasicBlock *root_bb,
     std::unordered_map<llvm::BasicBlock *, BBRegInfoNode *> &bb_reg_info_node_map) {
 
   // Remove loop from the graph of PhiRegsBBBagNode.
-  PhiRegsBBBagNode::RemoveLoop(root_bb);
+  RemoveLoop(root_bb);
 
 
   // Calculate the bag_preceding_(load | store)_reg_map for the every PhiRegsBBBagNode.
-  PhiRegsBBBagNode::GetPrecedingVirtualRegsBags(root_bb);
+  GetPrecedingVirtualRegsBags(root_bb);
   // Calculate the sucs_ld_rmp for the every PhiRegsBBBagNode.
-  PhiRegsBBBagNode::GetSucceedingVirtualRegsBags(root_bb);
+  GetSucceedingVirtualRegsBags(root_bb);
 
   // Calculate the drvd_rmp.
   std::set<PhiRegsBBBagNode *> finished;
@@ -1558,7 +1692,7 @@ void PhiRegsBBBagNode::GetPhiRegsBags(
   }
 }
 
-void PhiRegsBBBagNode::DebugGraphStruct(PhiRegsBBBagNode *target_bag) {
+void PhiRegsBBBagGraph::DebugGraphStruct(PhiRegsBBBagNode *target_bag) {
   ECV_LOG_NL("target bag: ", debug_bag_map.at(target_bag));
   std::set<PhiRegsBBBagNode *> __bags;
   ECV_LOG("PhiRegsBBBagNode * G Parents: ");
@@ -1614,6 +1748,10 @@ void VirtualRegsOpt::CalPassedCallerRegForBJump() {
       if (callee_fin) {
         auto t_fun_vro = func_v_r_opt_map.at(t_fun);
         for (auto callee : b_jump_callees_map.at(t_fun)) {
+          // the callee lifted in the other module (`--jobs`) isn't analyzed here.
+          if (!func_v_r_opt_map.contains(callee)) {
+            continue;
+          }
           auto callee_v_r_o = func_v_r_opt_map.at(callee);
           for (auto [e_r, e_r_c] : callee_v_r_o->passed_caller_reg_map) {
             t_fun_vro->passed_caller_reg_map.insert({e_r, e_r_c});
@@ -1757,18 +1895,19 @@ void VirtualRegsOpt::AnalyzeRegsBags() {
 
 
   // Initialize the Graph of PhiRegsBBBagNode.
+  PhiRegsBBBagGraph bag_graph;
   for (auto &[bb, bb_reg_info_node] : bb_reg_info_node_map) {
     auto phi_regs_bag =
         new PhiRegsBBBagNode(bb_reg_info_node->bb_ld_r_mp, bb_reg_info_node->bb_ld_r_mp,
                              std::move(bb_reg_info_node->bb_str_r_mp), {bb});
-    PhiRegsBBBagNode::bb_regs_bag_map.insert({bb, phi_regs_bag});
+    bag_graph.bb_regs_bag_map.insert({bb, phi_regs_bag});
   }
-  PhiRegsBBBagNode::bag_num = PhiRegsBBBagNode::bb_regs_bag_map.size();
+  bag_graph.bag_num = bag_graph.bb_regs_bag_map.size();
 
   for (auto [bb, pars] : bb_parents) {
     for (auto par : pars) {
-      auto par_phi_regs_bag = PhiRegsBBBagNode::bb_regs_bag_map.at(par);
-      auto child_phi_regs_bag = PhiRegsBBBagNode::bb_regs_bag_map.at(bb);
+      auto par_phi_regs_bag = bag_graph.bb_regs_bag_map.at(par);
+      auto child_phi_regs_bag = bag_graph.bb_regs_bag_map.at(bb);
       // Remove self-loop because it is not needed for the PhiRegsBBBagNode* Graph.
       if (par_phi_regs_bag == child_phi_regs_bag) {
         continue;
@@ -1779,11 +1918,8 @@ void VirtualRegsOpt::AnalyzeRegsBags() {
   }
 
   // Calculate the registers which needs to get on the phi nodes for every basic block.
-  PhiRegsBBBagNode::GetPhiRegsBags(&func->getEntryBlock(), bb_reg_info_node_map);
-  bb_regs_bag_map = PhiRegsBBBagNode::bb_regs_bag_map;
-
-  // Reset static data of PhiRegsBBBagNode.
-  PhiRegsBBBagNode::Reset();
+  bag_graph.GetPhiRegsBags(&func->getEntryBlock(), bb_reg_info_node_map);
+  bb_regs_bag_map = std::move(bag_graph.bb_regs_bag_map);
 
   ECV_LOG_NL(OutLLVMFunc(func).str().c_str());
   DebugStreamReset();
@@ -2177,11 +2313,22 @@ void VirtualRegsOpt::OptimizeVirtualRegsUsage() {
           // Call the `emulate_system_call` semantic function.
           else if (call_inst->getCalledFunction()->getName().str() == "emulate_system_call") {
             // Store target: x0 ~ x5, x8
+            // (clone: x0 ~ x30, v0 ~ v31, sp because the child copies the whole State)
             // priority: cur_r_inst_mp > pres_str_rmp
+            // the 4th argument is the PC of `svc` (AArch64).
+            llvm::ConstantInt *svc_pc = nullptr;
+            if (call_inst->arg_size() > 3)
+              svc_pc = llvm::dyn_cast<llvm::ConstantInt>(call_inst->getArgOperand(3));
+            bool clone_svc = svc_pc && impl->manager.isCloneSyscall(svc_pc->getZExtValue());
+            auto is_syscall_reg = [clone_svc](EcvReg e_r) {
+              if (clone_svc)
+                return e_r.number <= 31 || e_r.number == SP_ORDER;
+              return e_r.number < 6 || e_r.number == 8;
+            };
             std::set<EcvReg> strd2;
             for (auto [str_er1, er1_valtpl] : cur_r_inst_mp) {
               if (kArchAArch64LittleEndian == TARGET_ELF_ARCH) {
-                if (!(str_er1.number < 6 || str_er1.number == 8)) {
+                if (!is_syscall_reg(str_er1)) {
                   continue;
                 }
               } else if (kArchAMD64 == TARGET_ELF_ARCH) {
@@ -2199,10 +2346,10 @@ void VirtualRegsOpt::OptimizeVirtualRegsUsage() {
                   call_inst);
               strd2.insert(str_er1);
             }
-            // Store target: x0 ~ x5, x8
+            // Store target: x0 ~ x5, x8 (clone: x0 ~ x30, v0 ~ v31, sp)
             for (auto [str_er2, str_erc2] : t_bag->pres_str_rmp) {
               if (kArchAArch64LittleEndian == TARGET_ELF_ARCH) {
-                if (!(str_er2.number < 6 || str_er2.number == 8) || strd2.contains(str_er2)) {
+                if (!is_syscall_reg(str_er2) || strd2.contains(str_er2)) {
                   continue;
                 }
               } else if (kArchAMD64 == TARGET_ELF_ARCH) {
@@ -2355,7 +2502,7 @@ void VirtualRegsOpt::OptimizeVirtualRegsUsage() {
         }
         // Target: llvm::ReturnInst
         else if (auto _ret_inst = llvm::dyn_cast<llvm::ReturnInst>(t_inst)) {
-          // Store already stored `X0` or `X1`
+          // Store already stored return registers (`X0`, `X1` and `V0`-`V3`)
           // priority: cur_r_inst_mp > pres_str_rmp
 
           // Store cur_r_inst_mp
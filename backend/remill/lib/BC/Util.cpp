@@ -219,7 +219,8 @@ FindVarInFunction(llvm::Function *function, std::string_view name_, bool allow_f
   llvm::StringRef name(name_.data(), name_.size());
   auto &context = function->getContext();
 
-  static std::unordered_map<const char *, llvm::Type *> RegNameTypeMap = {
+  // the types belong to the context of the current thread (--jobs).
+  static thread_local std::unordered_map<const char *, llvm::Type *> RegNameTypeMap = {
       {"W", llvm::Type::getInt32Ty(context)},
       {"X", llvm::Type::getInt64Ty(context)},
       {"B", llvm::Type::getInt8Ty(context)},
@@ -10,15 +10,47 @@ setting() {
   BUILD_LIFTER_DIR=${BUILD_DIR}/lifter
   OPTFLAGS="-O3"
   EMCC=emcc
-  EMCCFLAGS="${OPTFLAGS} -I${ROOT_DIR}/backend/remill/include -I${ROOT_DIR}"
+  EMCCFLAGS="${OPTFLAGS} -msimd128 -I${ROOT_DIR}/backend/remill/include -I${ROOT_DIR}"
   WASISDKCC=${WASI_SDK_PATH}/bin/clang++
-  WASISDKFLAGS="${OPTFLAGS} --sysroot=${WASI_SDK_PATH}/share/wasi-sysroot -D_WASI_EMULATED_PROCESS_CLOCKS -I${ROOT_DIR}/backend/remill/include -I${ROOT_DIR} -fno-exceptions"
+  WASISDKFLAGS="${OPTFLAGS} -msimd128 --sysroot=${WASI_SDK_PATH}/share/wasi-sysroot -D_WASI_EMULATED_PROCESS_CLOCKS -I${ROOT_DIR}/backend/remill/include -I${ROOT_DIR} -fno-exceptions"
   WASISDK_LINKFLAGS="-lwasi-emulated-process-clocks"
   ELFCONV_MACROS="-DTARGET_IS_BROWSER=1"
+  # whole-program LTO of the lifted code and the runtime.
+  if [ -n "$LTO" ]; then
+    EMCCFLAGS="${EMCCFLAGS} -flto"
+    WASISDKFLAGS="${WASISDKFLAGS} -flto"
+  fi
+  # run the guest threads (clone) on the wasm threads.
+  if [ -n "$THREADS" ]; then
+    EMCCFLAGS="${EMCCFLAGS} -DELFC_RUNTIME_THREADS=1 -pthread -sPTHREAD_POOL_SIZE=navigator.hardwareConcurrency"
+    WASISDKFLAGS="${WASISDKFLAGS} -DELFC_RUNTIME_THREADS=1 --target=wasm32-wasi-threads -pthread"
+    WASISDK_LINKFLAGS="${WASISDK_LINKFLAGS} -Wl,--import-memory,--export-memory,--max-memory=4294967296"
+  fi
   ELFPATH=$( realpath "$1" )
 
 }
 
+# compile the lifted bitcode files of LIFT_SHARDS to the objects in parallel.
+# $1: compiler and flags
+# LIFTED is set to the lifted code for the final link.
+compile_lifted() {
+
+  LIFTED="lift.bc"
+  if [ "${LIFT_SHARDS:-1}" -gt 1 ]; then
+    LIFTED=""
+    pids=()
+    for bc in lift.bc lift_*.bc; do
+      $1 -c -o "${bc%.bc}.o" "$bc" &
+      pids+=($!)
+      LIFTED="${LIFTED} ${bc%.bc}.o"
+    done
+    for pid in "${pids[@]}"; do
+      wait "$pid" || exit 1
+    done
+  fi
+
+}
+
 main() {
 
   setting "$1"
@@ -39,11 +71,17 @@ main() {
   cp -p "${BUILD_LIFTER_DIR}/elflift" "${BIN_DIR}/"
   echo -e "[\033[32mINFO\033[0m] ELF -> LLVM bitcode..."
     cd "${BIN_DIR}" || { echo "cd Failure"; exit 1; }
+    rm -f lift_*.bc
     ./elflift \
     --arch aarch64 \
     --bc_out lift.bc \
     --target_elf "$ELFPATH" \
     --dbg_fun_cfg "$2" \
+    --jobs "${LIFT_JOBS:-1}" \
+    --opt_level "${LIFT_OPT_LEVEL:-0}" \
+    --shards "${LIFT_SHARDS:-1}" \
+    --reachable_only="${REACHABLE_ONLY:-0}" \
+    --lift_cache "${LIFT_CACHE}" \
     --target_arch "$wasi32_target_arch"
   echo -e "[\033[32mINFO\033[0m] LLVM bitcode (lift.bc) was generated."
 
@@ -54,8 +92,9 @@ main() {
       ELFCONV_MACROS="-DTARGET_IS_BROWSER=1 -DELF_IS_AARCH64"
       echo -e "[\033[32mINFO\033[0m] Compiling to Wasm and Js (for Browser)... "
       cd "${BIN_DIR}" || { echo "cd Failure"; exit 1; }
+      compile_lifted "$EMCC $EMCCFLAGS"
         $EMCC $EMCCFLAGS $ELFCONV_MACROS -sALLOW_MEMORY_GROWTH -sASYNCIFY -sEXPORT_ES6 -sENVIRONMENT=web --js-library ${ROOT_DIR}/xterm-pty/emscripten-pty.js \
-            -o exe.js lift.bc ${RUNTIME_DIR}/Entry.cpp ${RUNTIME_DIR}/Memory.cpp ${RUNTIME_DIR}/Runtime.cpp ${RUNTIME_DIR}/VmIntrinsics.cpp ${RUNTIME_DIR}/syscalls/SyscallBrowser.cpp \
+            -o exe.js $LIFTED ${RUNTIME_DIR}/Entry.cpp ${RUNTIME_DIR}/Memory.cpp ${RUNTIME_DIR}/Runtime.cpp ${RUNTIME_DIR}/VmIntrinsics.cpp ${RUNTIME_DIR}/syscalls/SyscallBrowser.cpp \
             ${UTILS_DIR}/elfconv.cpp ${UTILS_DIR}/Util.cpp
       echo -e "[\033[32mINFO\033[0m] exe.wasm and exe.js were generated."
     ;;
@@ -63,13 +102,14 @@ main() {
       echo -e "[\033[32mINFO\033[0m] Compiling to Wasm (for WASI)... "
       ELFCONV_MACROS="-DTARGET_IS_WASI=1 -DELF_IS_AARCH64"
       cd "${BIN_DIR}" || { echo "cd Failure"; exit 1; }
-      $WASISDKCC $WASISDKFLAGS $WASISDK_LINKFLAGS $ELFCONV_MACROS -o exe.wasm lift.bc ${RUNTIME_DIR}/Entry.cpp ${RUNTIME_DIR}/Memory.cpp ${RUNTIME_DIR}/Runtime.cpp ${RUNTIME_DIR}/VmIntrinsics.cpp ${RUNTIME_DIR}/syscalls/SyscallWasi.cpp \
+      compile_lifted "$WASISDKCC $WASISDKFLAGS"
+      $WASISDKCC $WASISDKFLAGS $WASISDK_LINKFLAGS $ELFCONV_MACROS -o exe.wasm $LIFTED ${RUNTIME_DIR}/Entry.cpp ${RUNTIME_DIR}/Memory.cpp ${RUNTIME_DIR}/Runtime.cpp ${RUNTIME_DIR}/VmIntrinsics.cpp ${RUNTIME_DIR}/syscalls/SyscallWasi.cpp \
           ${UTILS_DIR}/elfconv.cpp ${UTILS_DIR}/Util.cpp
       echo -e "[\033[32mINFO\033[0m] exe.wasm was generated."
     ;;
   esac
 
-  rm ${BIN_DIR}/lift.bc
+  rm -f ${BIN_DIR}/lift.bc ${BIN_DIR}/lift_*.bc ${BIN_DIR}/lift*.o
   return 0
 
 }
@@ -0,0 +1,91 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define THREAD_NUM 4
+#define LOOP_NUM 10000
+
+uint64_t ldaxr_counter = 0;
+uint64_t ldadd_counter = 0;
+uint32_t cas_counter = 0;
+uint64_t swp_lock = 0;
+uint64_t locked_counter = 0;
+
+// LDAXR and STLXR retry loop
+void ldaxr_stlxr_inc(uint64_t *ptr) {
+  uint64_t old, new;
+  uint32_t status;
+  asm __volatile__("1: \n\t"
+                   "LDAXR %x[old], [%[ptr]] \n\t"
+                   "ADD %x[new], %x[old], #1 \n\t"
+                   "STLXR %w[status], %x[new], [%[ptr]] \n\t"
+                   "CBNZ %w[status], 1b"
+                   : [old] "=&r"(old), [new] "=&r"(new), [status] "=&r"(status)
+                   : [ptr] "r"(ptr)
+                   : "memory");
+}
+
+// LDADDAL
+void ldadd_inc(uint64_t *ptr) {
+  uint64_t old;
+  asm __volatile__(".arch_extension lse \n\t"
+                   "LDADDAL %x[inc], %x[old], [%[ptr]]"
+                   : [old] "=r"(old)
+                   : [inc] "r"((uint64_t) 1), [ptr] "r"(ptr)
+                   : "memory");
+}
+
+// CASAL retry loop
+void cas_inc(uint32_t *ptr) {
+  uint32_t expected, desired;
+  do {
+    expected = __atomic_load_n(ptr, __ATOMIC_RELAXED);
+    desired = expected + 1;
+    asm __volatile__(".arch_extension lse \n\t"
+                     "CASAL %w[old], %w[new], [%[ptr]]"
+                     : [old] "+r"(expected)
+                     : [new] "r"(desired), [ptr] "r"(ptr)
+                     : "memory");
+  } while (expected + 1 != desired);
+}
+
+// spin lock by SWPA and STLR
+void swp_lock_inc(uint64_t *counter) {
+  uint64_t old;
+  do {
+    asm __volatile__(".arch_extension lse \n\t"
+                     "SWPA %x[one], %x[old], [%[lock]]"
+                     : [old] "=r"(old)
+                     : [one] "r"((uint64_t) 1), [lock] "r"(&swp_lock)
+                     : "memory");
+  } while (old != 0);
+  (*counter)++;
+  asm __volatile__("STLR xzr, [%0]" ::"r"(&swp_lock) : "memory");
+}
+
+void *worker(void *arg) {
+  for (int i = 0; i < LOOP_NUM; i++) {
+    ldaxr_stlxr_inc(&ldaxr_counter);
+    ldadd_inc(&ldadd_counter);
+    cas_inc(&cas_counter);
+    swp_lock_inc(&locked_counter);
+  }
+  return arg;
+}
+
+int main() {
+  pthread_t threads[THREAD_NUM];
+
+  for (int i = 0; i < THREAD_NUM; i++) {
+    pthread_create(&threads[i], NULL, worker, NULL);
+  }
+  for (int i = 0; i < THREAD_NUM; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  printf("ldaxr/stlxr: %lu\n", ldaxr_counter);
+  printf("ldadd: %lu\n", ldadd_counter);
+  printf("cas: %u\n", cas_counter);
+  printf("swp: %lu\n", locked_counter);
+  return 0;
+}
@@ -0,0 +1,41 @@
+#include <stdio.h>
+
+// homogeneous floating-point aggregates returned in V0-V2 and V0-V3
+typedef struct {
+  float x, y, z;
+} vec3;
+
+typedef struct {
+  double a, b, c, d;
+} vec4;
+
+__attribute__((noinline)) vec3 cross(vec3 u, vec3 v) {
+  vec3 w = {u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x};
+  return w;
+}
+
+__attribute__((noinline)) vec4 scale(vec4 p, double k) {
+  vec4 q = {p.a * k, p.b * k, p.c * k, p.d * k};
+  return q;
+}
+
+__attribute__((noinline)) vec4 reverse(vec4 p) {
+  vec4 q = {p.d, p.c, p.b, p.a};
+  return q;
+}
+
+int main() {
+  vec3 u = {1.0f, 2.0f, 3.0f};
+  vec3 v = {4.0f, 5.0f, 6.0f};
+  vec4 p = {1.5, 2.5, 3.5, 4.5};
+  // the indirect call goes through the wrapper of the lifted function
+  vec4 (*volatile fn)(vec4) = reverse;
+
+  vec3 w = cross(u, v);
+  printf("cross: %.1f %.1f %.1f\n", w.x, w.y, w.z);
+  vec4 q = scale(p, 2.0);
+  printf("scale: %.1f %.1f %.1f %.1f\n", q.a, q.b, q.c, q.d);
+  vec4 r = fn(q);
+  printf("reverse: %.1f %.1f %.1f %.1f\n", r.a, r.b, r.c, r.d);
+  return 0;
+}
@@ -0,0 +1,49 @@
+#include <stdio.h>
+
+// -O0 keeps every local in the stack slot (the spills)
+long fib(int n) {
+  long a = 0, b = 1;
+  for (int i = 0; i < n; i++) {
+    long t = a + b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+// the arguments after the eighth are passed on the stack
+long sum10(long a1, long a2, long a3, long a4, long a5, long a6, long a7, long a8, long a9,
+           long a10) {
+  return a1 + a2 * 2 + a3 * 3 + a4 * 4 + a5 * 5 + a6 * 6 + a7 * 7 + a8 * 8 + a9 * 9 + a10 * 10;
+}
+
+double mix10(double d1, long a1, double d2, long a2, double d3, long a3, double d4, long a4,
+             double d5, long a5, double d6, long a6, double d7, long a7, double d8, long a8,
+             double d9, long a9, double d10, long a10) {
+  return d1 + d2 + d3 + d4 + d5 + d6 + d7 + d8 + d9 + d10 +
+         (double) (a1 + a2 + a3 + a4 + a5 + a6 + a7 + a8 + a9 + a10);
+}
+
+// the callee writes to the frame of the caller by the pointer
+void add_to(long *p, long v) {
+  *p += v;
+}
+
+long escape(int n) {
+  long acc = 0;
+  long arr[4] = {1, 2, 3, 4};
+  for (int i = 0; i < n; i++) {
+    add_to(&acc, i);
+    add_to(&arr[i % 4], acc);
+  }
+  return acc + arr[0] + arr[1] + arr[2] + arr[3];
+}
+
+int main() {
+  printf("fib: %ld\n", fib(50));
+  printf("sum10: %ld\n", sum10(1, 2, 3, 4, 5, 6, 7, 8, 9, 10));
+  printf("mix10: %.1f\n", mix10(0.5, 1, 1.5, 2, 2.5, 3, 3.5, 4, 4.5, 5, 5.5, 6, 6.5, 7, 7.5, 8,
+                                8.5, 9, 9.5, 10));
+  printf("escape: %ld\n", escape(10));
+  return 0;
+}
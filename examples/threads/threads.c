@@ -0,0 +1,53 @@
+#include <pthread.h>
+#include <stdio.h>
+
+#define THREAD_NUM 4
+#define LOOP_NUM 10000
+
+pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+long counter = 0;
+int ready = 0;
+
+void *worker(void *arg) {
+  // wait until every thread is started (futex wait and wake by the condition variable)
+  pthread_mutex_lock(&mutex);
+  ready++;
+  if (ready == THREAD_NUM) {
+    pthread_cond_broadcast(&cond);
+  } else {
+    while (ready < THREAD_NUM) {
+      pthread_cond_wait(&cond, &mutex);
+    }
+  }
+  pthread_mutex_unlock(&mutex);
+
+  // contended increments under the mutex
+  for (int i = 0; i < LOOP_NUM; i++) {
+    pthread_mutex_lock(&mutex);
+    counter++;
+    pthread_mutex_unlock(&mutex);
+  }
+  return arg;
+}
+
+int main() {
+  pthread_t threads[THREAD_NUM];
+  int joined = 0;
+
+  for (long i = 0; i < THREAD_NUM; i++) {
+    pthread_create(&threads[i], NULL, worker, (void *) i);
+  }
+  for (long i = 0; i < THREAD_NUM; i++) {
+    void *ret;
+    pthread_join(threads[i], &ret);
+    if ((long) ret == i) {
+      joined++;
+    }
+  }
+
+  printf("counter: %ld\n", counter);
+  printf("ready: %d\n", ready);
+  printf("joined: %d\n", joined);
+  return 0;
+}
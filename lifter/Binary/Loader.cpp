@@ -1,226 +1,155 @@
-#define PACKAGE
 #include "Loader.h"
 
+#include <cerrno>
+#include <string_view>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
-#define ERROR_LEN 1000
-
 using namespace BinaryLoader;
 
-int ReadEhdr(const char *file_name, uint64_t *e_phent, uint64_t *e_phnum, uint8_t *e_ph[]) {
-
-  /* confirme ELF library version */
-  if (elf_version(EV_CURRENT) == EV_NONE) {
-    printf("ELF library initialization failed.");
-    return EXIT_FAILURE;
-  }
-
-  /* get file descriptor of target ELF file */
-  int fd = open(file_name, O_RDONLY);
-  if (fd < 0) {
-    printf("Failed to open ELF.");
-    return EXIT_FAILURE;
-  }
-
-  /* get Elf* object */
-  auto _elf = elf_begin(fd, ELF_C_READ, NULL);
-  if (!_elf) {
-    printf("Failed to read ELF.");
-    close(fd);
-    return EXIT_FAILURE;
-  }
-
-  /* confirm that the target file is ELF */
-  if (elf_kind(_elf) != ELF_K_ELF) {
-    printf("%s is not an ELF file\n", file_name);
-    elf_end(_elf);
-    close(fd);
-    return EXIT_FAILURE;
-  }
-
-  auto _ehdr = elf64_getehdr(_elf);
-  /* set e_phentsize */
-  *e_phent = _ehdr->e_phentsize;
-  /* set e_phnum */
-  *e_phnum = _ehdr->e_phnum;
-
-  /* get phder array */
-  auto e_phdrs = elf64_getphdr(_elf);
-  if (!e_phdrs) {
-    printf("Failed to get program headers.\n");
-    elf_end(_elf);
-    close(fd);
-    return EXIT_FAILURE;
+/* the pointer to [offset, offset + size) of the mapped file */
+uint8_t *ELFObject::FileBytes(uint64_t offset, uint64_t size) {
+  if (offset > map_size || size > map_size - offset) {
+    printf("file \"%s\" is truncated (offset: 0x%lx, size: 0x%lx).\n", file_name.c_str(), offset,
+           size);
+    abort();
   }
-
-  /* copy e_phdrs */
-  auto e_ph_size = *e_phent * *e_phnum;
-  *e_ph = (uint8_t *) malloc(e_ph_size);
-  memcpy(*e_ph, e_phdrs, e_ph_size);
-
-  elf_end(_elf);
-  close(fd);
-
-  return 0;
+  return map_base + offset;
 }
 
 void ELFObject::GetEhdr() {
-  ReadEhdr(file_name.c_str(), &e_phent, &e_phnum, &e_ph);
+  /* set e_phentsize and e_phnum */
+  e_phent = ehdr->e_phentsize;
+  e_phnum = ehdr->e_phnum;
+  /* program headers in the mapping */
+  e_ph = FileBytes(ehdr->e_phoff, e_phent * e_phnum);
 }
 
 void ELFObject::OpenELF() {
 
-  // init binary file descriptor
-  if (bfd_inited) {
-    bfd_init();
-    bfd_inited = true;
-  }
-
-  bfd_h = bfd_openr(file_name.c_str(), nullptr);
+  int fd = open(file_name.c_str(), O_RDONLY);
   // confirm file_name is opened
-  if (!bfd_h) {
-    printf("failed to open binary file: %s, ERROR: %s\n", file_name.c_str(),
-           bfd_errmsg(bfd_get_error()));
+  if (fd < 0) {
+    printf("failed to open binary file: %s, ERROR: %s\n", file_name.c_str(), strerror(errno));
     abort();
   }
-  // confirm file_name is an object file
-  if (!bfd_check_format(bfd_h, bfd_object)) {
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(Elf64_Ehdr)) {
     printf("file \"%s\" does not look like an executable file.\n", file_name.c_str());
     abort();
   }
+  /* private mapping: the file is never modified even if the section bytes are written */
+  map_size = st.st_size;
+  auto map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    printf("failed to map binary file: %s, ERROR: %s\n", file_name.c_str(), strerror(errno));
+    abort();
+  }
+  map_base = reinterpret_cast<uint8_t *>(map);
 
-  bfd_set_error(bfd_error_no_error);
   // confirm file_name is an ELF binary
-  if (!(bfd_get_flavour(bfd_h) == bfd_target_elf_flavour)) {
+  ehdr = reinterpret_cast<Elf64_Ehdr *>(map_base);
+  if (std::memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0) {
     printf("file \"%s\" is not an ELF binary.\n", file_name.c_str());
     abort();
   }
+  if (ehdr->e_ident[EI_CLASS] != ELFCLASS64 || ehdr->e_ident[EI_DATA] != ELFDATA2LSB) {
+    printf("file \"%s\" is not a little-endian ELF64 binary.\n", file_name.c_str());
+    abort();
+  }
+
+  /* section header table (e_shnum and e_shstrndx may be escaped to the first section header) */
+  /* the code and data are found by the sections, so the section-stripped binary can't be lifted */
+  if (ehdr->e_shoff == 0) {
+    printf("file \"%s\" has no section header table.\n", file_name.c_str());
+    abort();
+  }
+  shdrs = reinterpret_cast<Elf64_Shdr *>(FileBytes(ehdr->e_shoff, sizeof(Elf64_Shdr)));
+  shnum = ehdr->e_shnum != 0 ? ehdr->e_shnum : shdrs[0].sh_size;
+  shstrndx = ehdr->e_shstrndx != SHN_XINDEX ? ehdr->e_shstrndx : shdrs[0].sh_link;
+  FileBytes(ehdr->e_shoff, shnum * sizeof(Elf64_Shdr));
+  if (shstrndx >= shnum) {
+    printf("file \"%s\" has the invalid section name table index.\n", file_name.c_str());
+    abort();
+  }
 
   /* get ELF header info */
   GetEhdr();
 }
 
 void ELFObject::LoadELF() {
-  LoadELFBFD();
-}
-
-void ELFObject::LoadELFBFD() {
-  // get binary handler
+  // map the binary
   OpenELF();
   // get entry point
-  entry = bfd_get_start_address(bfd_h);
+  entry = ehdr->e_entry;
   // get binary format
-  bin_type_str = std::string(bfd_h->xvec->name);
-  switch (bfd_h->xvec->flavour) {
-    case bfd_target_elf_flavour: bin_type = BIN_TYPE_ELF; break;
-    case bfd_target_unknown_flavour:
-    default: printf("file \"%s\" is not an ELF binary.\n", file_name.c_str()); abort();
-  }
+  bin_type = BIN_TYPE_ELF;
   // get architecture
-  bfd_arch_info = bfd_get_arch_info(bfd_h);
-  bin_arch_str = std::string(bfd_arch_info->arch_name);
-  switch (bfd_arch_info->mach) {
-    case bfd_mach_aarch64:
+  switch (ehdr->e_machine) {
+    case EM_AARCH64:
+      bin_type_str = "elf64-littleaarch64";
+      bin_arch_str = "aarch64";
       bin_arch = BinaryArch::ARCH_AARCH64;
       bits = 64;
       break;
-    case bfd_mach_x86_64: printf("x86_64 is not supported now.\n"); abort();
+    case EM_X86_64: printf("x86_64 is not supported now.\n"); abort();
     default:
       printf("unknown architecture\n");
       abort();
       break;
   }
   // get every static symbol table
-  LoadStaticSymbolsBFD();
+  LoadStaticSymbols();
   /* get every dynamic symbol table */
-  // LoadDynamicSymbolsBFD(); /* FIXME */
+  // LoadDynamicSymbols(); /* FIXME */
   // get every section
-  LoadSectionsBFD();
+  LoadSections();
 }
 
-void ELFObject::LoadStaticSymbolsBFD() {
+void ELFObject::LoadSymbols(uint32_t symtab_type) {
 
-  asymbol **bfd_symtab = nullptr;
-  // get symbol table space
-  long table_size = bfd_get_symtab_upper_bound(bfd_h);
-  if (table_size < 0) {
-    printf("failed to read symtab.\n");
-    // abort();
-  } else if (table_size > 0) {
-    bfd_symtab = reinterpret_cast<asymbol **>(malloc(table_size));
-    if (!bfd_symtab) {
-      printf("failed to allocate symtab memory.\n");
-      // abort();
+  bool found = false;
+  for (uint64_t i = 0; i < shnum; i++) {
+    auto &symtab_shdr = shdrs[i];
+    if (symtab_shdr.sh_type != symtab_type || symtab_shdr.sh_link >= shnum) {
+      continue;
     }
-    // read symbol table
-    long sym_num = bfd_canonicalize_symtab(bfd_h, bfd_symtab);
-    if (sym_num < 0) {
-      printf("failed to read symtab.\n");
-      // abort();
-    }
-    for (int i = 0; i < sym_num; i++) {
+    found = true;
+    auto syms = reinterpret_cast<Elf64_Sym *>(
+        FileBytes(symtab_shdr.sh_offset, symtab_shdr.sh_size));
+    auto sym_num = symtab_shdr.sh_size / sizeof(Elf64_Sym);
+    auto &strtab_shdr = shdrs[symtab_shdr.sh_link];
+    auto strtab =
+        reinterpret_cast<const char *>(FileBytes(strtab_shdr.sh_offset, strtab_shdr.sh_size));
+    // the first entry is always the undefined symbol
+    for (uint64_t j = 1; j < sym_num; j++) {
+      auto &sym = syms[j];
+      auto sym_name = sym.st_name < strtab_shdr.sh_size ? strtab + sym.st_name : "";
+      auto sym_name_len = strnlen(sym_name, strtab_shdr.sh_size - sym.st_name);
       ELFSymbol::SymbolType sym_type;
-      if (bfd_symtab[i]->flags & BSF_FUNCTION ||
-          std::memcmp(bfd_symtab[i]->name, "_start", sizeof("_start")) == 0) {
+      if (ELF64_ST_TYPE(sym.st_info) == STT_FUNC ||
+          std::string_view(sym_name, sym_name_len) == "_start") {
         sym_type = ELFSymbol::SymbolType::SYM_TYPE_FUNC;
-      } else if (bfd_symtab[i]->flags & BSF_LOCAL) {
-        sym_type = ELFSymbol::SymbolType::SYM_TYPE_LVAR;
-        continue;
-      } else if (bfd_symtab[i]->flags & BSF_GLOBAL) {
-        sym_type = ELFSymbol::SymbolType::SYM_TYPE_GVAR;
-        continue;
       } else {
         continue;
       }
-      symbols.emplace_back(sym_type, std::string(bfd_symtab[i]->name),
-                           bfd_asymbol_value(bfd_symtab[i]));
+      symbols.emplace_back(sym_type, std::string(sym_name, sym_name_len), sym.st_value);
     }
-  } else {
-    printf("[INFO] static symbol table is not found.\n");
+  }
+  if (!found) {
+    printf("[INFO] %s symbol table is not found.\n", symtab_type == SHT_SYMTAB ? "static" : "dynamic");
   }
 }
 
-void ELFObject::LoadDynamicSymbolsBFD() {
+void ELFObject::LoadStaticSymbols() {
+  LoadSymbols(SHT_SYMTAB);
+}
 
-  asymbol **bfd_symtab = nullptr;
-  // get symbol table space
-  long table_size = bfd_get_dynamic_symtab_upper_bound(bfd_h);
-  if (table_size < 0) {
-    printf("failed to read symtab. gotten table_size: %ld\n", table_size);
-    abort();
-  } else if (table_size > 0) {
-    bfd_symtab = reinterpret_cast<asymbol **>(malloc(table_size));
-    if (!bfd_symtab) {
-      printf("failed to allocate symtab memory.\n");
-      abort();
-    }
-    // read symbol table
-    long sym_num = bfd_canonicalize_dynamic_symtab(bfd_h, bfd_symtab);
-    if (sym_num < 0) {
-      printf("failed to read symtab.\n");
-      abort();
-    }
-    for (int i = 0; i < sym_num; i++) {
-      ELFSymbol::SymbolType sym_type;
-      if (bfd_symtab[i]->flags & BSF_FUNCTION ||
-          std::memcmp(bfd_symtab[i]->name, "_start", sizeof("_start")) == 0) {
-        sym_type = ELFSymbol::SymbolType::SYM_TYPE_FUNC;
-      } else if (bfd_symtab[i]->flags & BSF_LOCAL) {
-        sym_type = ELFSymbol::SymbolType::SYM_TYPE_LVAR;
-        continue;
-      } else if (bfd_symtab[i]->flags & BSF_GLOBAL) {
-        sym_type = ELFSymbol::SymbolType::SYM_TYPE_GVAR;
-        continue;
-      } else {
-        continue;
-      }
-      symbols.emplace_back(sym_type, std::string(bfd_symtab[i]->name),
-                           bfd_asymbol_value(bfd_symtab[i]));
-    }
-  } else {
-    printf("[INFO] static symbol table is not found.\n");
-  }
+void ELFObject::LoadDynamicSymbols() {
+  LoadSymbols(SHT_DYNSYM);
 }
 
 void ELFObject::SetCodeSection() {
@@ -253,48 +182,81 @@ std::vector<ELFObject::FuncEntry> ELFObject::GetFuncEntry() {
   return func_entrys;
 }
 
-void ELFObject::LoadSectionsBFD() {
+void ELFObject::LoadSections() {
 
-  asection *bfd_sec;
+  /* the symbol table and its string table and relocations are not loaded as the sections (as BFD) */
+  uint64_t symtab_ndx = 0, symtab_strndx = 0;
+  for (uint64_t i = 0; i < shnum; i++) {
+    if (shdrs[i].sh_type == SHT_SYMTAB) {
+      symtab_ndx = i;
+      symtab_strndx = shdrs[i].sh_link;
+    }
+  }
+  auto &shstrtab_shdr = shdrs[shstrndx];
+  auto shstrtab =
+      reinterpret_cast<const char *>(FileBytes(shstrtab_shdr.sh_offset, shstrtab_shdr.sh_size));
 
-  for (bfd_sec = bfd_h->sections; bfd_sec; bfd_sec = bfd_sec->next) {
+  for (uint64_t i = 1; i < shnum; i++) {
 
+    auto &shdr = shdrs[i];
     ELFSection::SectionType sec_type;
-    flagword bfd_flags;
-    bfd_vma vma;
-    bfd_size_type size;
     std::string sec_name;
     uint8_t *sec_bytes;
 
-    // get bfd flags
-    bfd_flags = bfd_section_flags(bfd_sec);
-    if (bfd_flags & SEC_CODE) {
+    switch (shdr.sh_type) {
+      case SHT_NULL:
+      case SHT_SYMTAB:
+      case SHT_SYMTAB_SHNDX: continue;
+      case SHT_STRTAB:
+        if (i == shstrndx || (symtab_ndx != 0 && i == symtab_strndx)) {
+          continue;
+        }
+        break;
+      case SHT_REL:
+      case SHT_RELA:
+        if (!(shdr.sh_flags & SHF_ALLOC) && symtab_ndx != 0 && shdr.sh_link == symtab_ndx) {
+          continue;
+        }
+        break;
+      default: break;
+    }
+
+    // get section flags
+    if (shdr.sh_flags & SHF_EXECINSTR) {
       sec_type = ELFSection::SEC_TYPE_CODE;
-    } else if (bfd_flags & (SEC_DATA | SEC_ALLOC)) {
+    } else if (shdr.sh_flags & SHF_ALLOC) {
       sec_type = ELFSection::SEC_TYPE_DATA;
-    } else if (bfd_flags & SEC_READONLY) {
+    } else if (!(shdr.sh_flags & SHF_WRITE)) {
       sec_type = ELFSection::SEC_TYPE_READONLY;
     } else {
       sec_type = ELFSection::SEC_TYPE_UNKNOWN;
     }
-    // get vma, section size, section name, section contents
-    vma = bfd_section_vma(bfd_sec);
-    size = bfd_section_size(bfd_sec);
-    sec_name = std::string(bfd_section_name(bfd_sec));
+    // get section name
+    if (shdr.sh_name < shstrtab_shdr.sh_size) {
+      sec_name = std::string(shstrtab + shdr.sh_name,
+                             strnlen(shstrtab + shdr.sh_name, shstrtab_shdr.sh_size - shdr.sh_name));
+    }
     if (sec_name.empty()) {
       sec_name = std::string("<unnamed>");
     }
-    sec_bytes = reinterpret_cast<uint8_t *>(malloc(size));
-    if (!sec_bytes) {
-      printf("failed to allocate section bytes.\n");
-      abort();
-    }
-    if (!bfd_get_section_contents(bfd_h, bfd_sec, sec_bytes, 0, size)) {
-      printf("failed to read and copy section bytes.\n");
-      abort();
+    // get section contents (.bss and .tbss have no bytes in the file)
+    if (shdr.sh_type == SHT_NOBITS) {
+      if (shdr.sh_size == 0) {
+        sec_bytes = nullptr;
+      } else {
+        auto zero_map = mmap(nullptr, shdr.sh_size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (zero_map == MAP_FAILED) {
+          printf("failed to allocate section bytes.\n");
+          abort();
+        }
+        sec_bytes = reinterpret_cast<uint8_t *>(zero_map);
+      }
+    } else {
+      sec_bytes = FileBytes(shdr.sh_offset, shdr.sh_size);
     }
 
-    sections.emplace_back(this, sec_type, sec_name, vma, size, sec_bytes);
+    sections.emplace_back(this, sec_type, sec_name, shdr.sh_addr, shdr.sh_size, sec_bytes);
   }
 }
 
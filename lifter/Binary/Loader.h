@@ -1,17 +1,17 @@
 #pragma once
 
 #include <algorithm>
-#include <bfd.h>
 #include <cstdint>
 #include <cstring>
+#include <elf.h>
 #include <fcntl.h>
 #include <iostream>
-#include <libelf.h>
 #include <list>
 #include <map>
 #include <memory>
 #include <queue>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace BinaryLoader {
@@ -106,13 +106,13 @@ class ELFObject {
   void DebugStaticSymbols();
   void DebugBinary();
 
-  ELFObject(std::string __file_name) : file_name(__file_name), bfd_inited(false) {}
+  ELFObject(std::string __file_name) : file_name(__file_name) {}
   ELFObject() {}
 
   std::string file_name;
-  bool bfd_inited;
-  bfd *bfd_h;
-  const bfd_arch_info_type *bfd_arch_info;
+  /* the whole file is mapped once, and `ELFSection::bytes` and `e_ph` point into it */
+  uint8_t *map_base = nullptr;
+  uint64_t map_size = 0;
   ELFObject::BinaryType bin_type;
   std::string bin_type_str;
   ELFObject::BinaryArch bin_arch;
@@ -128,11 +128,17 @@ class ELFObject {
   uint8_t *e_ph;
 
  private:
+  Elf64_Ehdr *ehdr = nullptr;
+  Elf64_Shdr *shdrs = nullptr;
+  uint64_t shnum = 0;
+  uint64_t shstrndx = 0;
+
   void OpenELF();
-  void LoadELFBFD();
-  void LoadStaticSymbolsBFD();
-  void LoadDynamicSymbolsBFD();
-  void LoadSectionsBFD();
+  uint8_t *FileBytes(uint64_t offset, uint64_t size);
+  void LoadSymbols(uint32_t symtab_type);
+  void LoadStaticSymbols();
+  void LoadDynamicSymbols();
+  void LoadSections();
   void GetEhdr();
 };
 }  // namespace BinaryLoader
\ No newline at end of file
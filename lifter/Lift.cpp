@@ -17,6 +17,7 @@
 #include "remill/BC/Util.h"
 #if defined(__linux__)
 #  include <signal.h>
+#  include <unistd.h>
 #  include <utils/Util.h>
 #  include <utils/elfconv.h>
 #endif
@@ -25,12 +26,25 @@
 #include "MainLifter.h"
 #include "TraceManager.h"
 
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SHA1.h>
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
 #include <remill/BC/HelperMacro.h>
 #include <remill/BC/InstructionLifter.h>
 #include <remill/BC/Lifter.h>
 #include <remill/BC/Optimizer.h>
+#include <sstream>
+#include <thread>
 #include <utils/Util.h>
 DEFINE_string(bc_out, "", "Name of the file in which to place the generated bitcode.");
 
@@ -45,6 +59,43 @@ DEFINE_string(target_elf, "DUMMY_ELF", "Name of the target ELF binary");
 DEFINE_string(dbg_fun_cfg, "", "Function Name of the debug target");
 DEFINE_string(bitcode_path, "", "Function Name of the debug target");
 DEFINE_string(target_arch, "", "Target Architecture for conversion");
+DEFINE_bool(inline_memory, true,
+            "Inline guest memory accesses (load/store) instead of calling the runtime intrinsics");
+DEFINE_bool(indirect_call_cache, true,
+            "Cache the last target function at every indirect call (BLR) and jump (BR) site");
+DEFINE_bool(lazy_nzcv, true,
+            "Compute only the NZCV bits read by the conditional instructions (B.cond, CSEL, ADC, "
+            "...) from the operands of the flag-setting instruction (SUBS, ADDS, ANDS)");
+DEFINE_string(guest_profile, "",
+              "Count the calls of every lifted function (\"fn\") and also every guest basic block "
+              "(\"block\") for the runtime profile (ELFC_RUNTIME_PROFILE)");
+DEFINE_bool(instrument, false,
+            "Count the guest basic blocks and conditional branches for the profile-guided lifting "
+            "(implies --guest_profile=block)");
+DEFINE_string(profile, "",
+              "Guest profile written by the runtime of the --instrument build (elfconv.pgo)");
+DEFINE_int32(opt_level, 0,
+             "Optimize the lifted module by the LLVM pipeline of this level (1-3, 0: only the "
+             "register optimization of the lifter)");
+DEFINE_bool(stack_slots, false,
+            "Move the guest stack slots of the lifted function whose frame address does not escape "
+            "to the allocas promoted to the registers (needs --opt_level > 0)");
+DEFINE_bool(ssa_call_regs, false,
+            "Pass X0-X7, V0-V7 and SP of the direct calls between the lifted functions as the "
+            "arguments and the return values instead of the State (needs --opt_level > 0)");
+DEFINE_bool(reachable_only, false,
+            "Lift only the functions reachable from the entry point and the function addresses in "
+            "the data sections (the indirect call to the other functions stops at the runtime)");
+DEFINE_string(stats_json, "",
+              "Write the wall time and peak RSS of every lifting phase and the statistics of every "
+              "lifted function to this JSON file");
+DEFINE_string(lift_cache, "",
+              "Directory of the persistent cache of the lifted functions. The function whose bytes, "
+              "callees, lifter and flags are unchanged is reused instead of lifted again");
+DEFINE_int32(shards, 1,
+             "Split the lifted functions into this number of bitcode files (<bc_out>_1.bc, ...) "
+             "for the parallel compilation. <bc_out> keeps the other definitions (e.g. __g_* tables)");
+DEFINE_int32(jobs, 1, "Number of the worker threads which lift and optimize the functions");
 
 ArchName TARGET_ELF_ARCH;
 
@@ -65,14 +116,192 @@ void lift_set_sigaction() {
 #endif
 }
 
+/* the functions are split into this number of shards at most with --jobs (independent of the
+   number of the threads to get the same output) */
+const size_t kMaxLiftShardNum = 64;
+
+/* functions lifted and optimized together in one LLVMContext (--jobs) */
+struct LiftShard {
+  std::vector<uint64_t> func_vmas;
+  /* lifted module */
+  llvm::SmallVector<char, 0> bitcode;
+  /* statistics of the lifted functions (--stats_json) */
+  LiftStats stats;
+  /* cache file of every function (--lift_cache) */
+  std::vector<std::string> cache_paths;
+};
+
+/*
+  Load the guest profile (--profile). every line is one of
+    fn <function vma> <calls>
+    block <block vma> <executions>
+    branch <branch vma> <taken> <not taken>
+*/
+void load_lift_profile(const std::string &profile_path, LiftProfile &profile) {
+  std::ifstream profile_fs(profile_path);
+  if (!profile_fs)
+    elfconv_runtime_error("[ERROR] Cannot open the profile \"%s\".\n", profile_path.c_str());
+  std::string line;
+  while (std::getline(profile_fs, line)) {
+    std::istringstream line_ss(line);
+    std::string kind;
+    uint64_t vma, count, not_taken_count;
+    line_ss >> kind >> std::hex >> vma >> std::dec >> count;
+    if (kind == "fn" && line_ss) {
+      profile.fn_counts[vma] += count;
+    } else if (kind == "block" && line_ss) {
+      profile.block_counts[vma] += count;
+    } else if (kind == "branch" && line_ss >> not_taken_count) {
+      profile.branch_counts[vma].first += count;
+      profile.branch_counts[vma].second += not_taken_count;
+    } else if (!kind.empty()) {
+      elfconv_runtime_error("[ERROR] Invalid line of the profile: %s\n", line.c_str());
+    }
+  }
+}
+
+/* Write the lift-time statistics (--stats_json) */
+void write_lift_stats(const std::string &stats_path, LiftStats &stats,
+                      AArch64TraceManager &manager) {
+  std::error_code ec;
+  llvm::raw_fd_ostream stats_os(stats_path, ec);
+  if (ec)
+    elfconv_runtime_error("[ERROR] Cannot open \"%s\": %s\n", stats_path.c_str(),
+                          ec.message().c_str());
+  std::map<uint64_t, LiftFuncStats> sorted_funcs(stats.funcs.begin(), stats.funcs.end());
+  double total_ms = 0;
+  llvm::json::OStream json(stats_os, 2);
+  json.object([&] {
+    json.attributeArray("phases", [&] {
+      for (auto &phase : stats.phases) {
+        total_ms += phase.wall_ms;
+        json.object([&] {
+          json.attribute("name", phase.name);
+          json.attribute("wall_ms", phase.wall_ms);
+          json.attribute("peak_rss_kb", (int64_t) phase.peak_rss_kb);
+        });
+      }
+    });
+    json.attribute("total_wall_ms", total_ms);
+    json.attributeArray("functions", [&] {
+      for (auto &[vma, fn_stats] : sorted_funcs) {
+        auto disasm_fn_it = manager.disasm_funcs.find(vma);
+        json.object([&] {
+          json.attribute("name", disasm_fn_it != manager.disasm_funcs.end()
+                                     ? disasm_fn_it->second.func_name
+                                     : std::string());
+          json.attribute("vma", llvm::utohexstr(vma));
+          json.attribute("insts", (int64_t) fn_stats.inst_num);
+          json.attribute("blocks", (int64_t) fn_stats.block_num);
+          json.attribute("ir_insts", (int64_t) fn_stats.ir_inst_num);
+          json.attribute("indirect_jumps", (int64_t) fn_stats.indirect_jump_num);
+          json.attribute("indirect_calls", (int64_t) fn_stats.indirect_call_num);
+          json.attribute("opt_ms", fn_stats.opt_ms);
+          json.attribute("promoted_frame_bytes", (int64_t) fn_stats.promoted_frame_bytes);
+        });
+      }
+    });
+  });
+  stats_os << "\n";
+}
+
+/* Hash of the lifter, the semantics and the flags which every lifted function depends on */
+std::string lift_cache_salt(const remill::Arch *arch, const char *argv0) {
+  llvm::SHA1 hasher;
+  hasher.update("elfconv lift cache v1");
+  auto hash_file = [&](const std::string &path) {
+    auto file_buf = llvm::MemoryBuffer::getFile(path);
+    if (!file_buf)
+      elfconv_runtime_error("[ERROR] Cannot read \"%s\" for the lift cache.\n", path.c_str());
+    hasher.update((*file_buf)->getBuffer());
+  };
+  hash_file(llvm::sys::fs::getMainExecutable(argv0, (void *) &lift_set_sigaction));
+  std::vector<std::filesystem::path> sem_dirs;
+  if (!FLAGS_bitcode_path.empty())
+    sem_dirs.push_back(FLAGS_bitcode_path);
+  if (auto sem_path = remill::FindSemanticsBitcodeFile(remill::GetArchName(arch->arch_name),
+                                                       sem_dirs))
+    hash_file(sem_path->string());
+  hasher.update(FLAGS_guest_profile);
+  hasher.update(FLAGS_instrument ? "instrument" : "");
+  if (!FLAGS_profile.empty())
+    hash_file(FLAGS_profile);
+  return llvm::toHex(hasher.final(), true);
+}
+
+/* Lift and optimize the functions of the shard in the own LLVMContext */
+void lift_shard(AArch64TraceManager &manager, LiftShard &shard, const LiftProfile *profile) {
+  llvm::LLVMContext context;
+  auto arch = remill::Arch::Build(&context, remill::GetOSName(REMILL_OS),
+                                  remill::GetArchName(FLAGS_arch));
+  auto module = FLAGS_bitcode_path.empty()
+                    ? remill::LoadArchSemantics(arch.get())
+                    : remill::LoadArchSemantics(arch.get(), {FLAGS_bitcode_path.c_str()});
+
+  ShardTraceManager shard_manager(manager);
+  shard_manager.lift_targets.insert(shard.func_vmas.begin(), shard.func_vmas.end());
+  MainLifter shard_lifter(arch.get(), &shard_manager);
+  if (FLAGS_guest_profile == "block")
+    shard_lifter.EnableProfileBlock();
+  if (FLAGS_instrument)
+    shard_lifter.EnableProfileBranch();
+  shard_lifter.SetProfile(profile);
+  if (!FLAGS_stats_json.empty())
+    shard_lifter.SetStats(&shard.stats);
+  shard_lifter.SetRuntimeManagerClass();
+  shard_lifter.DeclareDebugFunction();
+  shard_lifter.DeclareHelperFunction();
+
+  for (auto vma : shard.func_vmas) {
+    auto &dasm_func = manager.disasm_funcs.at(vma);
+    if (!shard_lifter.Lift(dasm_func.vma, dasm_func.func_name.c_str()))
+      elfconv_runtime_error("[ERROR] Failed to Lift \"%s\"\n", dasm_func.func_name.c_str());
+    shard_manager.GetLiftedTraceDefinition(dasm_func.vma)->setName(dasm_func.func_name.c_str());
+  }
+  shard_lifter.Optimize();
+
+  shard_lifter.PrepareShardModule();
+  if (shard.cache_paths.empty()) {
+    llvm::raw_svector_ostream bitcode_os(shard.bitcode);
+    llvm::WriteBitcodeToFile(*module, bitcode_os);
+    return;
+  }
+
+  /* store every function to the lift cache (renamed at the end not to leave a broken file) */
+  for (size_t i = 0; i < shard.func_vmas.size(); i++) {
+    auto fn_module = shard_lifter.ExtractLiftedFunction(
+        shard_manager.GetLiftedTraceDefinition(shard.func_vmas[i]));
+    auto tmp_path = shard.cache_paths[i] + ".tmp." + std::to_string(getpid());
+    {
+      std::error_code ec;
+      llvm::raw_fd_ostream cache_os(tmp_path, ec);
+      if (ec)
+        elfconv_runtime_error("[ERROR] Cannot open \"%s\": %s\n", tmp_path.c_str(),
+                              ec.message().c_str());
+      llvm::WriteBitcodeToFile(*fn_module, cache_os);
+    }
+    if (auto ec = llvm::sys::fs::rename(tmp_path, shard.cache_paths[i]))
+      elfconv_runtime_error("[ERROR] Cannot store \"%s\": %s\n", shard.cache_paths[i].c_str(),
+                            ec.message().c_str());
+  }
+}
+
 int main(int argc, char *argv[]) {
   // set custom signal handler for SIGSEGV.
   lift_set_sigaction();
   google::ParseCommandLineFlags(&argc, &argv, true);
   google::InitGoogleLogging(argv[0]);
 
+  /* lift-time statistics (--stats_json) */
+  LiftStats lift_stats;
+  auto phase_start = std::chrono::steady_clock::now();
+
   AArch64TraceManager manager(FLAGS_target_elf);
   manager.SetELFData();
+  if (FLAGS_reachable_only)
+    manager.PruneUnreachableFuncs();
+  lift_stats.AddPhase("elf_load", phase_start);
+  phase_start = std::chrono::steady_clock::now();
 
   llvm::LLVMContext context;
   auto os_name = remill::GetOSName(REMILL_OS);
@@ -86,6 +315,24 @@ int main(int argc, char *argv[]) {
 
   remill::IntrinsicTable intrinsics(module.get());
   MainLifter main_lifter(arch.get(), &manager);
+  if (FLAGS_instrument) {
+    FLAGS_guest_profile = "block";
+    main_lifter.EnableProfileBranch();
+  }
+  if (!FLAGS_guest_profile.empty() && FLAGS_guest_profile != "fn" && FLAGS_guest_profile != "block")
+    elfconv_runtime_error("[ERROR] --guest_profile must be \"fn\" or \"block\".\n");
+  if (FLAGS_guest_profile == "block")
+    main_lifter.EnableProfileBlock();
+  /* profile-guided lifting */
+  LiftProfile lift_profile;
+  const LiftProfile *profile = nullptr;
+  if (!FLAGS_profile.empty()) {
+    load_lift_profile(FLAGS_profile, lift_profile);
+    profile = &lift_profile;
+  }
+  main_lifter.SetProfile(profile);
+  if (!FLAGS_stats_json.empty())
+    main_lifter.SetStats(&lift_stats);
   main_lifter.SetRuntimeManagerClass();
 
   std::unordered_map<uint64_t, const char *> addr_fn_map;
@@ -96,19 +343,119 @@ int main(int argc, char *argv[]) {
   main_lifter.DeclareHelperFunction();
   // set global register names
   main_lifter.SetRegisterNames();
+  lift_stats.AddPhase("load_semantics", phase_start);
+  phase_start = std::chrono::steady_clock::now();
 
-  /* lift every disassembled function */
-  for (const auto &[addr, dasm_func] : manager.disasm_funcs) {
-    if (!main_lifter.Lift(dasm_func.vma, dasm_func.func_name.c_str()))
-      elfconv_runtime_error("[ERROR] Failed to Lift \"%s\"\n", dasm_func.func_name.c_str());
-    addr_fn_map[addr] = dasm_func.func_name.c_str();
-    /* set function attributes */
-    auto lifted_fn = manager.GetLiftedTraceDefinition(dasm_func.vma);
-    lifted_fn->setName(dasm_func.func_name.c_str());
-  }
+  if (FLAGS_jobs > 1 || !FLAGS_lift_cache.empty()) {
+    /* split the functions into the shards (sorted by vma to get the same output every time) */
+    std::vector<uint64_t> func_vmas;
+    for (const auto &[addr, dasm_func] : manager.disasm_funcs) {
+      func_vmas.push_back(addr);
+      addr_fn_map[addr] = dasm_func.func_name.c_str();
+    }
+    std::sort(func_vmas.begin(), func_vmas.end());
+    /* lift only the functions which are not in the lift cache */
+    auto lift_vmas = func_vmas;
+    std::unordered_map<uint64_t, std::string> cache_paths;
+    if (!FLAGS_lift_cache.empty()) {
+      if (auto ec = llvm::sys::fs::create_directories(FLAGS_lift_cache))
+        elfconv_runtime_error("[ERROR] Cannot create \"%s\": %s\n", FLAGS_lift_cache.c_str(),
+                              ec.message().c_str());
+      auto cache_salt = lift_cache_salt(arch.get(), argv[0]);
+      lift_vmas.clear();
+      for (auto vma : func_vmas) {
+        llvm::SHA1 hasher;
+        hasher.update(cache_salt);
+        manager.HashLiftInput(vma, hasher);
+        auto &cache_path = cache_paths[vma];
+        cache_path = FLAGS_lift_cache + "/" + llvm::toHex(hasher.final(), true) + ".bc";
+        if (!llvm::sys::fs::exists(cache_path))
+          lift_vmas.push_back(vma);
+      }
+      printf("[INFO] %zu of %zu functions are reused from the lift cache.\n",
+             func_vmas.size() - lift_vmas.size(), func_vmas.size());
+    }
+    std::vector<LiftShard> shards(std::min(kMaxLiftShardNum, lift_vmas.size()));
+    for (size_t i = 0; i < lift_vmas.size(); i++) {
+      auto &shard = shards[i * shards.size() / lift_vmas.size()];
+      shard.func_vmas.push_back(lift_vmas[i]);
+      if (!cache_paths.empty())
+        shard.cache_paths.push_back(cache_paths.at(lift_vmas[i]));
+    }
+
+    /* every worker takes the next shard when it finishes the previous one */
+    std::atomic<size_t> next_shard = 0;
+    std::vector<std::thread> workers;
+    for (int32_t i = 0; i < std::max(FLAGS_jobs, 1); i++) {
+      workers.emplace_back([&]() {
+        for (size_t shard_i; (shard_i = next_shard++) < shards.size();)
+          lift_shard(manager, shards[shard_i], profile);
+      });
+    }
+    for (auto &worker : workers)
+      worker.join();
+    lift_stats.AddPhase("lift_and_opt_shards", phase_start);
+    phase_start = std::chrono::steady_clock::now();
 
-  // Optimize the generated LLVM IR.
-  main_lifter.Optimize();
+    /* link the lifted modules in the shard order (or the vma order of the cached functions) */
+    auto link_lifted_module = [&](llvm::MemoryBufferRef bitcode_ref) {
+      auto lifted_module = llvm::parseBitcodeFile(bitcode_ref, context);
+      if (!lifted_module)
+        elfconv_runtime_error("[ERROR] Failed to load the lifted module: %s\n",
+                              llvm::toString(lifted_module.takeError()).c_str());
+      if (llvm::Linker::linkModules(*module, std::move(*lifted_module)))
+        elfconv_runtime_error("[ERROR] Failed to link the lifted module.\n");
+    };
+    if (cache_paths.empty()) {
+      for (auto &shard : shards)
+        link_lifted_module(
+            llvm::MemoryBufferRef(llvm::StringRef(shard.bitcode.data(), shard.bitcode.size()),
+                                  "lifted_shard"));
+    } else {
+      for (auto vma : func_vmas) {
+        auto cache_buf = llvm::MemoryBuffer::getFile(cache_paths.at(vma));
+        if (!cache_buf)
+          elfconv_runtime_error("[ERROR] Cannot read the lift cache \"%s\".\n",
+                                cache_paths.at(vma).c_str());
+        link_lifted_module((*cache_buf)->getMemBufferRef());
+      }
+    }
+    for (auto &shard : shards)
+      lift_stats.funcs.insert(shard.stats.funcs.begin(), shard.stats.funcs.end());
+    lift_stats.AddPhase("link_shards", phase_start);
+  } else {
+    /* lift every disassembled function */
+    for (const auto &[addr, dasm_func] : manager.disasm_funcs) {
+      if (!main_lifter.Lift(dasm_func.vma, dasm_func.func_name.c_str()))
+        elfconv_runtime_error("[ERROR] Failed to Lift \"%s\"\n", dasm_func.func_name.c_str());
+      addr_fn_map[addr] = dasm_func.func_name.c_str();
+      /* set function attributes */
+      auto lifted_fn = manager.GetLiftedTraceDefinition(dasm_func.vma);
+      lifted_fn->setName(dasm_func.func_name.c_str());
+    }
+    lift_stats.AddPhase("lift", phase_start);
+
+    // Optimize the generated LLVM IR.
+    main_lifter.Optimize();
+  }
+  phase_start = std::chrono::steady_clock::now();
+  // Compute only the NZCV bits read by the conditional instructions.
+  if (FLAGS_lazy_nzcv)
+    main_lifter.FoldNZCVConditions();
+  // Lower the memory intrinsics to load/store.
+  if (FLAGS_inline_memory)
+    main_lifter.InlineMemoryAccess();
+  // Add the inline cache to the indirect calls.
+  if (FLAGS_indirect_call_cache)
+    main_lifter.AddIndirectCallCache();
+  // Count the guest functions and basic blocks.
+  if (!FLAGS_guest_profile.empty())
+    main_lifter.AddGuestProfileCounters(addr_fn_map);
+  // Place the hot functions first.
+  if (profile)
+    main_lifter.OrderFunctionsByProfile(addr_fn_map);
+  lift_stats.AddPhase("post_passes", phase_start);
+  phase_start = std::chrono::steady_clock::now();
 
   /* set entry function of lifted function */
   if (manager.entry_func_lifted_name.empty())
@@ -122,6 +469,10 @@ int main(int argc, char *argv[]) {
 #if defined(LIFT_CALLSTACK_DEBUG)
   /* debug call stack */
   main_lifter.SetFuncSymbolNameTable(addr_fn_map);
+#else
+  /* symbol names of the guest profile */
+  if (!FLAGS_guest_profile.empty())
+    main_lifter.SetFuncSymbolNameTable(addr_fn_map);
 #endif
   /* set Platform name (FIXME) */
   main_lifter.SetPlatform("aarch64");
@@ -129,10 +480,6 @@ int main(int argc, char *argv[]) {
   main_lifter.SetEntryPC(manager.entry_point);
   /* set data section */
   main_lifter.SetDataSections(manager.elf_obj.sections);
-  /* set block address data */
-  main_lifter.SetBlockAddressData(
-      manager.g_block_address_ptrs_array, manager.g_block_address_vmas_array,
-      manager.g_block_address_size_array, manager.g_block_address_fn_vma_array);
 
   /* generate LLVM bitcode file */
   auto host_arch = remill::Arch::Build(&context, os_name, remill::GetArchName(REMILL_ARCH));
@@ -150,7 +497,44 @@ int main(int argc, char *argv[]) {
     module->setTargetTriple(wasm32_triple.str());
   }
 
+  lift_stats.AddPhase("finalize", phase_start);
+
+  // Optimize the whole module for the downstream compilers.
+  if (FLAGS_opt_level > 0) {
+    phase_start = std::chrono::steady_clock::now();
+    if (FLAGS_stack_slots)
+      main_lifter.EnableStackSlots();
+    if (FLAGS_ssa_call_regs)
+      main_lifter.EnableSSACallRegs();
+    main_lifter.OptimizeLiftedModule(addr_fn_map, std::min(FLAGS_opt_level, 3));
+    lift_stats.AddPhase("opt_level", phase_start);
+  }
+
+  if (!FLAGS_stats_json.empty())
+    for (auto &[vma, fn_name] : addr_fn_map)
+      if (auto lifted_fn = module->getFunction(fn_name); lifted_fn && lift_stats.funcs.contains(vma))
+        lift_stats.funcs[vma].ir_inst_num = lifted_fn->getInstructionCount();
+
+  // Split the lifted functions for the parallel compilation.
+  std::vector<std::unique_ptr<llvm::Module>> shard_modules;
+  if (FLAGS_shards > 1) {
+    phase_start = std::chrono::steady_clock::now();
+    shard_modules = main_lifter.SplitLiftedModule(addr_fn_map, FLAGS_shards);
+    lift_stats.AddPhase("split_shards", phase_start);
+  }
+
+  phase_start = std::chrono::steady_clock::now();
   remill::StoreModuleToFile(module.get(), FLAGS_bc_out);
+  auto bc_out_stem = FLAGS_bc_out.ends_with(".bc")
+                         ? FLAGS_bc_out.substr(0, FLAGS_bc_out.size() - 3)
+                         : FLAGS_bc_out;
+  for (size_t i = 0; i < shard_modules.size(); i++)
+    remill::StoreModuleToFile(shard_modules[i].get(),
+                              bc_out_stem + "_" + std::to_string(i + 1) + ".bc");
+  lift_stats.AddPhase("bitcode_write", phase_start);
+
+  if (!FLAGS_stats_json.empty())
+    write_lift_stats(FLAGS_stats_json, lift_stats, manager);
 
   return 0;
 }
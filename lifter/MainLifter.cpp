@@ -1,7 +1,17 @@
 #include "MainLifter.h"
 
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/MDBuilder.h>
+#include <map>
 #include <remill/Arch/Arch.h>
 #include <remill/BC/ABI.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/PromoteMemToReg.h>
+#include <remill/BC/Optimizer.h>
+#include <remill/BC/Util.h>
 #include <utils/Util.h>
 
 // Set RuntimeManager class to the global context
@@ -39,16 +49,6 @@ void MainLifter::SetLiftedFunPtrTable(std::unordered_map<uint64_t, const char *>
   static_cast<WrapImpl *>(impl.get())->SetLiftedFunPtrTable(addr_fn_map);
 }
 
-/* Set block address data */
-void MainLifter::SetBlockAddressData(std::vector<llvm::Constant *> &block_address_ptrs_array,
-                                     std::vector<llvm::Constant *> &block_address_vmas_array,
-                                     std::vector<llvm::Constant *> &block_address_sizes_array,
-                                     std::vector<llvm::Constant *> &block_address_fn_vma_array) {
-  static_cast<WrapImpl *>(impl.get())
-      ->SetBlockAddressData(block_address_ptrs_array, block_address_vmas_array,
-                            block_address_sizes_array, block_address_fn_vma_array);
-}
-
 /* Declare helper function used in lifted LLVM bitcode */
 void MainLifter::DeclareHelperFunction() {
   static_cast<WrapImpl *>(impl.get())->DeclareHelperFunction();
@@ -59,6 +59,89 @@ void MainLifter::Optimize() {
   static_cast<WrapImpl *>(impl.get())->Optimize();
 }
 
+// Inline guest memory accesses into the lifted LLVM IR.
+void MainLifter::InlineMemoryAccess() {
+  static_cast<WrapImpl *>(impl.get())->InlineMemoryAccess();
+}
+
+// Cache the last target function at every indirect call site.
+void MainLifter::AddIndirectCallCache() {
+  static_cast<WrapImpl *>(impl.get())->AddIndirectCallCache();
+}
+
+// Compute only the NZCV bits read by the conditional instructions.
+void MainLifter::FoldNZCVConditions() {
+  static_cast<WrapImpl *>(impl.get())->FoldNZCVConditions();
+}
+
+// Mark every guest basic block for the profile counter while lifting.
+void MainLifter::EnableProfileBlock() {
+  impl->profile_block = true;
+}
+
+// Add the guest profile counters to the lifted functions.
+void MainLifter::AddGuestProfileCounters(std::unordered_map<uint64_t, const char *> &addr_fn_map) {
+  static_cast<WrapImpl *>(impl.get())->AddGuestProfileCounters(addr_fn_map);
+}
+
+// Count the taken of every conditional branch while lifting.
+void MainLifter::EnableProfileBranch() {
+  impl->profile_branch = true;
+}
+
+// Use the guest profile of the previous run for the lifting.
+void MainLifter::SetProfile(const LiftProfile *profile) {
+  impl->profile = profile;
+}
+
+// Record the lift-time statistics of every function.
+void MainLifter::SetStats(LiftStats *stats) {
+  impl->stats = stats;
+}
+
+// Place the hot lifted functions first.
+void MainLifter::OrderFunctionsByProfile(std::unordered_map<uint64_t, const char *> &addr_fn_map) {
+  static_cast<WrapImpl *>(impl.get())->OrderFunctionsByProfile(addr_fn_map);
+}
+
+// Move the guest stack slots of the lifted functions to the allocas (--stack_slots).
+void MainLifter::EnableStackSlots() {
+  static_cast<WrapImpl *>(impl.get())->stack_slots = true;
+}
+
+// Pass the argument and return registers of the direct calls as the SSA values (--ssa_call_regs).
+void MainLifter::EnableSSACallRegs() {
+  static_cast<WrapImpl *>(impl.get())->ssa_call_regs = true;
+}
+
+// Optimize the whole lifted module by the LLVM pipeline (--opt_level).
+void MainLifter::OptimizeLiftedModule(std::unordered_map<uint64_t, const char *> &addr_fn_map,
+                                      unsigned opt_level) {
+  auto wrap_impl = static_cast<WrapImpl *>(impl.get());
+  wrap_impl->InternalizeSemantics(addr_fn_map);
+  if (wrap_impl->stack_slots)
+    wrap_impl->RecoverStackSlots(addr_fn_map);
+  if (wrap_impl->ssa_call_regs)
+    wrap_impl->PassRegsInSSA(addr_fn_map);
+  remill::OptimizeLiftedModule(wrap_impl->module, opt_level);
+}
+
+// Leave only the lifted functions in the module of the lifting worker.
+void MainLifter::PrepareShardModule() {
+  static_cast<WrapImpl *>(impl.get())->PrepareShardModule();
+}
+
+std::unique_ptr<llvm::Module> MainLifter::ExtractLiftedFunction(llvm::Function *lifted_fn) {
+  return static_cast<WrapImpl *>(impl.get())->ExtractLiftedFunction(lifted_fn);
+}
+
+// Split the lifted functions into the modules compiled in parallel.
+std::vector<std::unique_ptr<llvm::Module>>
+MainLifter::SplitLiftedModule(std::unordered_map<uint64_t, const char *> &addr_fn_map,
+                              unsigned shard_num) {
+  return static_cast<WrapImpl *>(impl.get())->SplitLiftedModule(addr_fn_map, shard_num);
+}
+
 /* Declare debug function */
 void MainLifter::DeclareDebugFunction() {
   static_cast<WrapImpl *>(impl.get())->DeclareDebugFunction();
@@ -206,7 +289,9 @@ llvm::GlobalVariable *MainLifter::WrapImpl::SetLiftedFunPtrTable(
 
   std::vector<llvm::Constant *> addr_list, fn_ptr_list;
 
-  for (auto &[addr, fn_name] : addr_fn_map) {
+  /* sorted by vma so that the runtime can binary search the table */
+  std::map<uint64_t, const char *> sorted_addr_fn_map(addr_fn_map.begin(), addr_fn_map.end());
+  for (auto &[addr, fn_name] : sorted_addr_fn_map) {
     auto lifted_fun = module->getFunction(fn_name);
     if (!lifted_fun) {
       elfconv_runtime_error("[ERROR] lifted fun \"%s\" cannot be found.\n", fn_name);
@@ -221,26 +306,6 @@ llvm::GlobalVariable *MainLifter::WrapImpl::SetLiftedFunPtrTable(
   return GenGlobalArrayHelper(fn_ptr_list[0]->getType(), fn_ptr_list, g_fun_ptr_table_name);
 }
 
-/* Set block address data */
-llvm::GlobalVariable *MainLifter::WrapImpl::SetBlockAddressData(
-    std::vector<llvm::Constant *> &block_address_ptrs_array,
-    std::vector<llvm::Constant *> &block_address_vmas_array,
-    std::vector<llvm::Constant *> &block_address_sizes_array,
-    std::vector<llvm::Constant *> &block_address_fn_vma_array) {
-  (void) new llvm::GlobalVariable(
-      *module, llvm::Type::getInt64Ty(context), true, llvm::GlobalValue::ExternalLinkage,
-      llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), block_address_ptrs_array.size()),
-      g_block_address_array_size_name);
-  GenGlobalArrayHelper(llvm::Type::getInt64PtrTy(context), block_address_ptrs_array,
-                       g_block_address_ptrs_array_name);
-  GenGlobalArrayHelper(llvm::Type::getInt64PtrTy(context), block_address_vmas_array,
-                       g_block_address_vmas_array_name);
-  GenGlobalArrayHelper(llvm::Type::getInt64Ty(context), block_address_sizes_array,
-                       g_block_address_size_array_name);
-  return GenGlobalArrayHelper(llvm::Type::getInt64Ty(context), block_address_fn_vma_array,
-                              g_block_address_fn_vma_array_name);
-}
-
 /* Global variable array definition helper */
 llvm::GlobalVariable *MainLifter::WrapImpl::GenGlobalArrayHelper(
     llvm::Type *elem_type, std::vector<llvm::Constant *> &constant_array, const llvm::Twine &Name,
@@ -253,13 +318,1387 @@ llvm::GlobalVariable *MainLifter::WrapImpl::GenGlobalArrayHelper(
 
 /* declare helper function in the lifted LLVM bitcode */
 void MainLifter::WrapImpl::DeclareHelperFunction() {
-  /* uint64_t *__g_get_jmp_block_address(RuntimeManager*,  uint64_t, uint64_t) */
+  /* uint64_t *__g_get_indirectbr_block_address(RuntimeManager*, const uint64_t *bb_vmas,
+                                                uint64_t **bb_addrs, uint64_t bb_num, uint64_t) */
   llvm::Function::Create(
       llvm::FunctionType::get(llvm::Type::getInt64PtrTy(context),
-                              {llvm::Type::getInt64PtrTy(context), llvm::Type::getInt64Ty(context),
+                              {llvm::Type::getInt64PtrTy(context), llvm::Type::getInt64PtrTy(context),
+                               llvm::Type::getInt64PtrTy(context), llvm::Type::getInt64Ty(context),
                                llvm::Type::getInt64Ty(context)},
                               false),
       llvm::Function::ExternalLinkage, g_get_indirectbr_block_address_func_name, *module);
+  /* void __g_profile_block(uint64_t block_vma) (marker replaced by AddGuestProfileCounters) */
+  auto profile_block_fn = llvm::Function::Create(
+      llvm::FunctionType::get(llvm::Type::getVoidTy(context), {llvm::Type::getInt64Ty(context)},
+                              false),
+      llvm::Function::ExternalLinkage, g_profile_block_func_name, *module);
+  profile_block_fn->setOnlyAccessesInaccessibleMemory();
+  profile_block_fn->setDoesNotThrow();
+  profile_block_fn->setWillReturn();
+  /* void __g_profile_branch(uint64_t branch_vma, bool taken) (same as __g_profile_block) */
+  auto profile_branch_fn = llvm::Function::Create(
+      llvm::FunctionType::get(llvm::Type::getVoidTy(context),
+                              {llvm::Type::getInt64Ty(context), llvm::Type::getInt1Ty(context)},
+                              false),
+      llvm::Function::ExternalLinkage, g_profile_branch_func_name, *module);
+  profile_branch_fn->setOnlyAccessesInaccessibleMemory();
+  profile_branch_fn->setDoesNotThrow();
+  profile_branch_fn->setWillReturn();
+  /* the paths to the unexpected instructions are cold */
+  intrinsics->error->addFnAttr(llvm::Attribute::Cold);
+  intrinsics->missing_block->addFnAttr(llvm::Attribute::Cold);
+}
+
+/*
+  ptr __g_translate_vma_fast(ptr runtime_manager, i64 vma)
+  fast path: the vma is in the memory region registered by the runtime (__g_mem_region_*).
+  slow path: call __g_translate_vma (RuntimeManager::TranslateVMA) of the runtime.
+*/
+llvm::Function *MainLifter::WrapImpl::DefineTranslateVMAFast() {
+
+  auto u64_ty = llvm::Type::getInt64Ty(context);
+  auto ptr_ty = llvm::Type::getInt8PtrTy(context);
+  auto runtime_manager_ptr_type = llvm::Type::getInt64PtrTy(context);
+
+  auto declare_gvar = [&](llvm::Type *ty, const std::string &name) {
+    auto gvar = new llvm::GlobalVariable(*module, ty, false, llvm::GlobalVariable::ExternalLinkage,
+                                         nullptr, name);
+    gvar->setAlignment(llvm::MaybeAlign(8));
+    return gvar;
+  };
+  auto guest_base_gvar = declare_gvar(u64_ty, g_mem_region_guest_base_name);
+  auto size_gvar = declare_gvar(u64_ty, g_mem_region_size_name);
+  auto host_base_gvar = declare_gvar(ptr_ty, g_mem_region_host_base_name);
+
+  /* ptr __g_translate_vma(ptr runtime_manager, i64 vma) (slow path) */
+  auto slow_fn = llvm::Function::Create(
+      llvm::FunctionType::get(ptr_ty, {runtime_manager_ptr_type, u64_ty}, false),
+      llvm::Function::ExternalLinkage, g_translate_vma_func_name, *module);
+  slow_fn->addFnAttr(llvm::Attribute::Cold);
+  slow_fn->addFnAttr(llvm::Attribute::NoInline);
+
+  auto fast_fn = llvm::Function::Create(
+      llvm::FunctionType::get(ptr_ty, {runtime_manager_ptr_type, u64_ty}, false),
+      llvm::Function::InternalLinkage, g_translate_vma_fast_func_name, *module);
+  fast_fn->addFnAttr(llvm::Attribute::AlwaysInline);
+  auto runtime_manager_arg = fast_fn->getArg(0);
+  auto vma_arg = fast_fn->getArg(1);
+
+  auto entry_bb = llvm::BasicBlock::Create(context, "", fast_fn);
+  auto fast_bb = llvm::BasicBlock::Create(context, "L_fast", fast_fn);
+  auto slow_bb = llvm::BasicBlock::Create(context, "L_slow", fast_fn);
+
+  llvm::IRBuilder<> ir(entry_bb);
+  auto offset = ir.CreateSub(vma_arg, ir.CreateLoad(u64_ty, guest_base_gvar));
+  auto in_region = ir.CreateICmpULT(offset, ir.CreateLoad(u64_ty, size_gvar));
+  ir.CreateCondBr(in_region, fast_bb, slow_bb,
+                  llvm::MDBuilder(context).createBranchWeights(1 << 20, 1));
+
+  ir.SetInsertPoint(fast_bb);
+  ir.CreateRet(ir.CreateGEP(llvm::Type::getInt8Ty(context),
+                            ir.CreateLoad(ptr_ty, host_base_gvar), offset));
+
+  ir.SetInsertPoint(slow_bb);
+  ir.CreateRet(ir.CreateCall(slow_fn, {runtime_manager_arg, vma_arg}));
+
+  return fast_fn;
+}
+
+/* Replace every memory intrinsic call with the translation and load/store */
+void MainLifter::WrapImpl::InlineMemoryAccess() {
+
+  auto translate_fn = DefineTranslateVMAFast();
+
+  // f128 access is left to the runtime (unsupported yet).
+  std::vector<llvm::Function *> read_fns = {
+      intrinsics->read_memory_8,   intrinsics->read_memory_16,  intrinsics->read_memory_32,
+      intrinsics->read_memory_64,  intrinsics->read_memory_128, intrinsics->read_memory_f32,
+      intrinsics->read_memory_f64};
+  std::vector<llvm::Function *> write_fns = {
+      intrinsics->write_memory_8,   intrinsics->write_memory_16,  intrinsics->write_memory_32,
+      intrinsics->write_memory_64,  intrinsics->write_memory_128, intrinsics->write_memory_f32,
+      intrinsics->write_memory_f64};
+
+  auto collect_calls = [](llvm::Function *fn) {
+    std::vector<llvm::CallInst *> calls;
+    for (auto user : fn->users())
+      if (auto call = llvm::dyn_cast<llvm::CallInst>(user); call && call->getCalledFunction() == fn)
+        calls.push_back(call);
+    return calls;
+  };
+
+  /* T __remill_read_memory_N(ptr runtime_manager, i64 vma) -> load T, ptr (translate(vma)) */
+  for (auto read_fn : read_fns) {
+    for (auto call : collect_calls(read_fn)) {
+      llvm::IRBuilder<> ir(call);
+      auto host_ptr =
+          ir.CreateCall(translate_fn, {call->getArgOperand(0), call->getArgOperand(1)});
+      auto load = ir.CreateAlignedLoad(call->getType(), host_ptr, llvm::Align(1));
+      call->replaceAllUsesWith(load);
+      call->eraseFromParent();
+    }
+  }
+  /* void __remill_write_memory_N(ptr runtime_manager, i64 vma, T val) -> store T val, ptr */
+  for (auto write_fn : write_fns) {
+    for (auto call : collect_calls(write_fn)) {
+      llvm::IRBuilder<> ir(call);
+      auto host_ptr =
+          ir.CreateCall(translate_fn, {call->getArgOperand(0), call->getArgOperand(1)});
+      ir.CreateAlignedStore(call->getArgOperand(2), host_ptr, llvm::Align(1));
+      call->eraseFromParent();
+    }
+  }
+
+  /* the last argument `order` of the atomic intrinsics (__ATOMIC_RELAXED, ...) */
+  auto to_ordering = [](llvm::Value *order) {
+    auto order_c = llvm::dyn_cast<llvm::ConstantInt>(order);
+    switch (order_c ? order_c->getSExtValue() : __ATOMIC_SEQ_CST) {
+      case __ATOMIC_RELAXED: return llvm::AtomicOrdering::Monotonic;
+      case __ATOMIC_CONSUME:
+      case __ATOMIC_ACQUIRE: return llvm::AtomicOrdering::Acquire;
+      case __ATOMIC_RELEASE: return llvm::AtomicOrdering::Release;
+      case __ATOMIC_ACQ_REL: return llvm::AtomicOrdering::AcquireRelease;
+      default: return llvm::AtomicOrdering::SequentiallyConsistent;
+    }
+  };
+
+  /* T __remill_atomic_load_memory_N(ptr, i64 vma, i32 order) -> load atomic T, ptr */
+  /* void __remill_atomic_store_memory_N(ptr, i64 vma, T val, i32 order) -> store atomic T val */
+  for (auto size : {8, 16, 32, 64}) {
+    auto align = llvm::Align(size / 8);
+    if (auto load_fn = module->getFunction("__remill_atomic_load_memory_" + std::to_string(size)))
+      for (auto call : collect_calls(load_fn)) {
+        llvm::IRBuilder<> ir(call);
+        auto host_ptr =
+            ir.CreateCall(translate_fn, {call->getArgOperand(0), call->getArgOperand(1)});
+        auto load = ir.CreateAlignedLoad(call->getType(), host_ptr, align);
+        /* the load can't have the release */
+        auto ordering = to_ordering(call->getArgOperand(2));
+        if (ordering == llvm::AtomicOrdering::Release)
+          ordering = llvm::AtomicOrdering::Monotonic;
+        else if (ordering == llvm::AtomicOrdering::AcquireRelease)
+          ordering = llvm::AtomicOrdering::Acquire;
+        load->setAtomic(ordering);
+        call->replaceAllUsesWith(load);
+        call->eraseFromParent();
+      }
+    if (auto store_fn = module->getFunction("__remill_atomic_store_memory_" + std::to_string(size)))
+      for (auto call : collect_calls(store_fn)) {
+        llvm::IRBuilder<> ir(call);
+        auto host_ptr =
+            ir.CreateCall(translate_fn, {call->getArgOperand(0), call->getArgOperand(1)});
+        auto store = ir.CreateAlignedStore(call->getArgOperand(2), host_ptr, align);
+        /* the store can't have the acquire */
+        auto ordering = to_ordering(call->getArgOperand(3));
+        if (ordering == llvm::AtomicOrdering::Acquire)
+          ordering = llvm::AtomicOrdering::Monotonic;
+        else if (ordering == llvm::AtomicOrdering::AcquireRelease)
+          ordering = llvm::AtomicOrdering::Release;
+        store->setAtomic(ordering);
+        call->eraseFromParent();
+      }
+  }
+
+  /* T __remill_atomic_{swap,add,or}_memory_N(ptr, i64 vma, T val, i32 order) -> atomicrmw */
+  /* T __remill_atomic_cmpxchg_memory_N(ptr, i64 vma, T expected, T desired, i32 order)
+     -> cmpxchg */
+  std::vector<std::pair<std::string, llvm::AtomicRMWInst::BinOp>> rmw_ops = {
+      {"swap", llvm::AtomicRMWInst::Xchg},
+      {"add", llvm::AtomicRMWInst::Add},
+      {"or", llvm::AtomicRMWInst::Or}};
+  for (auto size : {32, 64}) {
+    auto align = llvm::MaybeAlign(size / 8);
+    for (auto &[op_name, bin_op] : rmw_ops) {
+      auto rmw_fn = module->getFunction("__remill_atomic_" + op_name + "_memory_" +
+                                        std::to_string(size));
+      if (!rmw_fn)
+        continue;
+      for (auto call : collect_calls(rmw_fn)) {
+        llvm::IRBuilder<> ir(call);
+        auto host_ptr =
+            ir.CreateCall(translate_fn, {call->getArgOperand(0), call->getArgOperand(1)});
+        auto rmw = ir.CreateAtomicRMW(bin_op, host_ptr, call->getArgOperand(2), align,
+                                      to_ordering(call->getArgOperand(3)));
+        call->replaceAllUsesWith(rmw);
+        call->eraseFromParent();
+      }
+    }
+    if (auto cmpxchg_fn =
+            module->getFunction("__remill_atomic_cmpxchg_memory_" + std::to_string(size)))
+      for (auto call : collect_calls(cmpxchg_fn)) {
+        llvm::IRBuilder<> ir(call);
+        auto host_ptr =
+            ir.CreateCall(translate_fn, {call->getArgOperand(0), call->getArgOperand(1)});
+        auto ordering = to_ordering(call->getArgOperand(4));
+        auto cmpxchg = ir.CreateAtomicCmpXchg(
+            host_ptr, call->getArgOperand(2), call->getArgOperand(3), align, ordering,
+            llvm::AtomicCmpXchgInst::getStrongestFailureOrdering(ordering));
+        call->replaceAllUsesWith(ir.CreateExtractValue(cmpxchg, 0));
+        call->eraseFromParent();
+      }
+  }
+
+  /* void __remill_barrier_*(ptr runtime_manager) -> fence */
+  std::vector<std::pair<llvm::Function *, llvm::AtomicOrdering>> barrier_fns = {
+      {intrinsics->barrier_load_load, llvm::AtomicOrdering::Acquire},
+      {intrinsics->barrier_load_store, llvm::AtomicOrdering::Acquire},
+      {intrinsics->barrier_store_load, llvm::AtomicOrdering::SequentiallyConsistent},
+      {intrinsics->barrier_store_store, llvm::AtomicOrdering::Release}};
+  for (auto &[barrier_fn, ordering] : barrier_fns) {
+    for (auto call : collect_calls(barrier_fn)) {
+      llvm::IRBuilder<> ir(call);
+      ir.CreateFence(ordering);
+      call->eraseFromParent();
+    }
+  }
+}
+
+/*
+  Give every __remill_function_call (BLR) and __remill_jump (BR to another function) site
+  a one-entry cache of the last target.
+    hit:  call the cached lifted function directly.
+    miss: look up the function table by __g_get_lifted_func and update the cache.
+  The empty cache holds UINT64_MAX (no function is there), so BR/BLR to 0 misses the cache.
+  The cache is thread local because the guest threads update the vma and the function separately.
+*/
+void MainLifter::WrapImpl::AddIndirectCallCache() {
+
+  auto u64_ty = llvm::Type::getInt64Ty(context);
+  auto lifted_func_ty = intrinsics->function_call->getFunctionType();
+  auto lifted_func_ptr_ty = llvm::PointerType::getUnqual(lifted_func_ty);
+
+  /* LiftedFunc __g_get_lifted_func(ptr runtime_manager, i64 fn_vma) */
+  auto get_lifted_func_fn = llvm::Function::Create(
+      llvm::FunctionType::get(lifted_func_ptr_ty,
+                              {llvm::Type::getInt64PtrTy(context), u64_ty}, false),
+      llvm::Function::ExternalLinkage, g_get_lifted_func_name, *module);
+  get_lifted_func_fn->addFnAttr(llvm::Attribute::Cold);
+  get_lifted_func_fn->addFnAttr(llvm::Attribute::NoInline);
+
+  for (auto indirect_fn : {intrinsics->function_call, intrinsics->jump}) {
+    std::vector<llvm::CallInst *> calls;
+    for (auto user : indirect_fn->users())
+      if (auto call = llvm::dyn_cast<llvm::CallInst>(user);
+          call && call->getCalledFunction() == indirect_fn &&
+          !llvm::isa<llvm::ConstantInt>(call->getArgOperand(kPCArgNum)))
+        calls.push_back(call);
+
+    for (auto call : calls) {
+      auto fn_vma = call->getArgOperand(kPCArgNum);
+      auto runtime_manager = call->getArgOperand(kRuntimePointerArgNum);
+      auto cached_vma_gvar = new llvm::GlobalVariable(
+          *module, u64_ty, false, llvm::GlobalVariable::PrivateLinkage,
+          llvm::ConstantInt::get(u64_ty, UINT64_MAX), "__g_ic_vma", nullptr,
+          llvm::GlobalVariable::LocalExecTLSModel);
+      auto cached_fn_gvar = new llvm::GlobalVariable(
+          *module, lifted_func_ptr_ty, false, llvm::GlobalVariable::PrivateLinkage,
+          llvm::ConstantPointerNull::get(lifted_func_ptr_ty), "__g_ic_fn", nullptr,
+          llvm::GlobalVariable::LocalExecTLSModel);
+
+      auto head_bb = call->getParent();
+      auto call_bb = head_bb->splitBasicBlock(call, "L_ic_call");
+      auto miss_bb = llvm::BasicBlock::Create(context, "L_ic_miss", head_bb->getParent(), call_bb);
+
+      head_bb->getTerminator()->eraseFromParent();
+      llvm::IRBuilder<> ir(head_bb);
+      auto cached_fn = ir.CreateLoad(lifted_func_ptr_ty, cached_fn_gvar);
+      auto is_hit = ir.CreateICmpEQ(ir.CreateLoad(u64_ty, cached_vma_gvar), fn_vma);
+      ir.CreateCondBr(is_hit, call_bb, miss_bb,
+                      llvm::MDBuilder(context).createBranchWeights(1 << 10, 1));
+
+      /* the function is stored first not to pair the new vma with the old function */
+      ir.SetInsertPoint(miss_bb);
+      auto found_fn = ir.CreateCall(get_lifted_func_fn, {runtime_manager, fn_vma});
+      ir.CreateStore(found_fn, cached_fn_gvar);
+      ir.CreateStore(fn_vma, cached_vma_gvar);
+      ir.CreateBr(call_bb);
+
+      ir.SetInsertPoint(call);
+      auto target_fn = ir.CreatePHI(lifted_func_ptr_ty, 2);
+      target_fn->addIncoming(cached_fn, head_bb);
+      target_fn->addIncoming(found_fn, miss_bb);
+      llvm::SmallVector<llvm::Value *> args(call->args());
+      auto new_call = ir.CreateCall(lifted_func_ty, target_fn, args);
+      new_call->setTailCallKind(call->getTailCallKind());
+      call->replaceAllUsesWith(new_call);
+      call->eraseFromParent();
+    }
+  }
+}
+
+/*
+  Lazy NZCV: the flag-setting instruction (SUBS, ADDS, ANDS and the aliases CMP, CMN, TST) packs
+  all the four bits into ECV_NZCV, but the conditional instruction (B.cond, CSEL, CCMP, ADC, ...)
+  reads only the bits of its condition. The condition is computed from the operands of the
+  flag-setting instruction (e.g. `cmp x0, x1; b.lt` -> `icmp slt x0, x1`), also through the phi
+  nodes of the lifted blocks, and the reader gets the constant NZCV of the same condition result.
+  So the packed NZCV is removed by the optimization unless it is stored to the State.
+*/
+void MainLifter::WrapImpl::FoldNZCVConditions() {
+
+  enum class FlagOp { Sub, Add, And };
+  /* NZCV values which make the condition true and false */
+  static const std::unordered_map<std::string, std::pair<uint64_t, uint64_t>> cond_nzcvs = {
+      {"EQ", {0b0100, 0}}, {"NE", {0, 0b0100}}, {"CS", {0b0010, 0}}, {"CC", {0, 0b0010}},
+      {"MI", {0b1000, 0}}, {"PL", {0, 0b1000}}, {"VS", {0b0001, 0}}, {"VC", {0, 0b0001}},
+      {"HI", {0b0010, 0}}, {"LS", {0, 0b0010}}, {"GE", {0, 0b1000}}, {"LT", {0b1000, 0}},
+      {"GT", {0, 0b0100}}, {"LE", {0b0100, 0}}};
+
+  /* the semantics functions of the flag setters and the condition readers (last argument) */
+  std::unordered_map<llvm::Function *, FlagOp> setter_fns;
+  std::unordered_map<llvm::Function *, std::string> reader_fns;
+  std::set<llvm::Function *> shared_fns;
+  ForEachISel(module, [&](llvm::GlobalVariable *isel, llvm::Function *sem) {
+    if (!sem)
+      return;
+    auto isel_name = isel->getName();
+    std::optional<FlagOp> flag_op;
+    std::string cond;
+    if (isel_name.startswith("ISEL_SUBS_"))
+      flag_op = FlagOp::Sub;
+    else if (isel_name.startswith("ISEL_ADDS_"))
+      flag_op = FlagOp::Add;
+    else if (isel_name.startswith("ISEL_ANDS_"))
+      flag_op = FlagOp::And;
+    else if (isel_name.startswith("ISEL_ADC_") || isel_name.startswith("ISEL_SBC_") ||
+             isel_name.startswith("ISEL_SBCS_"))
+      cond = "CS";  // only the carry is read
+    else
+      for (auto prefix : {"ISEL_B_ONLY_CONDBRANCH_", "ISEL_CSEL_", "ISEL_FCSEL_", "ISEL_CSINC_",
+                          "ISEL_CSINV_", "ISEL_CSNEG_", "ISEL_CCMP_", "ISEL_CCMN_"})
+        if (isel_name.startswith(prefix) && cond_nzcvs.contains(isel_name.take_back(2).str()) &&
+            isel_name.drop_back(2).endswith("_"))
+          cond = isel_name.take_back(2).str();
+    if (!flag_op && cond.empty())
+      return;
+    /* the function shared by the different instructions is not folded */
+    if ((flag_op && ((setter_fns.contains(sem) && setter_fns.at(sem) != *flag_op) ||
+                     reader_fns.contains(sem))) ||
+        (!cond.empty() && ((reader_fns.contains(sem) && reader_fns.at(sem) != cond) ||
+                           setter_fns.contains(sem))))
+      shared_fns.insert(sem);
+    if (flag_op)
+      setter_fns.insert({sem, *flag_op});
+    else
+      reader_fns.insert({sem, cond});
+  });
+
+  /* `extractvalue {iN, i64} (call setter(lhs, rhs)), 1` */
+  auto as_setter = [&](llvm::Value *val) -> llvm::CallInst * {
+    auto extract = llvm::dyn_cast<llvm::ExtractValueInst>(val);
+    if (!extract || extract->getNumIndices() != 1 || extract->getIndices()[0] != 1)
+      return nullptr;
+    auto call = llvm::dyn_cast<llvm::CallInst>(extract->getAggregateOperand());
+    if (!call || !call->getCalledFunction() || !setter_fns.contains(call->getCalledFunction()) ||
+        shared_fns.contains(call->getCalledFunction()) || call->arg_size() != 2)
+      return nullptr;
+    auto struct_ty = llvm::dyn_cast<llvm::StructType>(call->getType());
+    if (!struct_ty || struct_ty->getNumElements() != 2 ||
+        !struct_ty->getElementType(0)->isIntegerTy() ||
+        !call->getArgOperand(0)->getType()->isIntegerTy() ||
+        !call->getArgOperand(1)->getType()->isIntegerTy())
+      return nullptr;
+    return call;
+  };
+
+  /* every value reaching the reader is the NZCV of the setter (phi cycles are allowed) */
+  std::function<bool(llvm::Value *, std::set<llvm::PHINode *> &)> is_foldable =
+      [&](llvm::Value *val, std::set<llvm::PHINode *> &visited) {
+        if (as_setter(val))
+          return true;
+        auto phi = llvm::dyn_cast<llvm::PHINode>(val);
+        if (!phi)
+          return false;
+        if (!visited.insert(phi).second)
+          return true;
+        for (auto &incoming : phi->incoming_values())
+          if (!is_foldable(incoming, visited))
+            return false;
+        return true;
+      };
+
+  /* the condition computed from the operands just after the setter */
+  auto setter_cond = [&](llvm::CallInst *setter, const std::string &cond) -> llvm::Value * {
+    auto flag_op = setter_fns.at(setter->getCalledFunction());
+    auto res_ty = llvm::cast<llvm::StructType>(setter->getType())->getElementType(0);
+    llvm::IRBuilder<> ir(setter->getNextNode());
+    auto lhs = ir.CreateZExtOrTrunc(setter->getArgOperand(0), res_ty);
+    auto rhs = ir.CreateZExtOrTrunc(setter->getArgOperand(1), res_ty);
+    if (FlagOp::Sub == flag_op) {
+      static const std::unordered_map<std::string, llvm::CmpInst::Predicate> sub_preds = {
+          {"EQ", llvm::CmpInst::ICMP_EQ},  {"NE", llvm::CmpInst::ICMP_NE},
+          {"CS", llvm::CmpInst::ICMP_UGE}, {"CC", llvm::CmpInst::ICMP_ULT},
+          {"HI", llvm::CmpInst::ICMP_UGT}, {"LS", llvm::CmpInst::ICMP_ULE},
+          {"GE", llvm::CmpInst::ICMP_SGE}, {"LT", llvm::CmpInst::ICMP_SLT},
+          {"GT", llvm::CmpInst::ICMP_SGT}, {"LE", llvm::CmpInst::ICMP_SLE}};
+      if (sub_preds.contains(cond))
+        return ir.CreateICmp(sub_preds.at(cond), lhs, rhs);
+    }
+    auto res = FlagOp::Sub == flag_op   ? ir.CreateSub(lhs, rhs)
+               : FlagOp::Add == flag_op ? ir.CreateAdd(lhs, rhs)
+                                        : ir.CreateAnd(lhs, rhs);
+    auto zero = llvm::ConstantInt::get(res_ty, 0);
+    auto flag_n = [&] { return ir.CreateICmpSLT(res, zero); };
+    auto flag_z = [&] { return ir.CreateICmpEQ(res, zero); };
+    auto flag_c = [&]() -> llvm::Value * {
+      if (FlagOp::Add == flag_op)
+        return ir.CreateICmpULT(res, lhs);
+      return FlagOp::Sub == flag_op ? ir.CreateICmpUGE(lhs, rhs) : ir.getFalse();
+    };
+    auto flag_v = [&]() -> llvm::Value * {
+      if (FlagOp::And == flag_op)
+        return ir.getFalse();
+      auto same_sign = FlagOp::Add == flag_op ? ir.CreateNot(ir.CreateXor(lhs, rhs))
+                                              : ir.CreateXor(lhs, rhs);
+      return ir.CreateICmpSLT(ir.CreateAnd(same_sign, ir.CreateXor(lhs, res)), zero);
+    };
+    if ("EQ" == cond)
+      return flag_z();
+    if ("NE" == cond)
+      return ir.CreateNot(flag_z());
+    if ("CS" == cond)
+      return flag_c();
+    if ("CC" == cond)
+      return ir.CreateNot(flag_c());
+    if ("MI" == cond)
+      return flag_n();
+    if ("PL" == cond)
+      return ir.CreateNot(flag_n());
+    if ("VS" == cond)
+      return flag_v();
+    if ("VC" == cond)
+      return ir.CreateNot(flag_v());
+    if ("HI" == cond)
+      return ir.CreateAnd(flag_c(), ir.CreateNot(flag_z()));
+    if ("LS" == cond)
+      return ir.CreateOr(ir.CreateNot(flag_c()), flag_z());
+    if ("GE" == cond)
+      return ir.CreateICmpEQ(flag_n(), flag_v());
+    if ("LT" == cond)
+      return ir.CreateICmpNE(flag_n(), flag_v());
+    if ("GT" == cond)
+      return ir.CreateAnd(ir.CreateNot(flag_z()), ir.CreateICmpEQ(flag_n(), flag_v()));
+    CHECK("LE" == cond);
+    return ir.CreateOr(flag_z(), ir.CreateICmpNE(flag_n(), flag_v()));
+  };
+
+  /* the condition of the NZCV value (the phi of NZCV becomes the phi of the condition) */
+  std::map<std::pair<llvm::Value *, std::string>, llvm::Value *> cond_cache;
+  std::function<llvm::Value *(llvm::Value *, const std::string &)> get_cond =
+      [&](llvm::Value *nzcv, const std::string &cond) -> llvm::Value * {
+    if (auto cache_it = cond_cache.find({nzcv, cond}); cache_it != cond_cache.end())
+      return cache_it->second;
+    if (auto setter = as_setter(nzcv))
+      return cond_cache[{nzcv, cond}] = setter_cond(setter, cond);
+    auto nzcv_phi = llvm::cast<llvm::PHINode>(nzcv);
+    auto cond_phi = llvm::PHINode::Create(llvm::Type::getInt1Ty(context),
+                                          nzcv_phi->getNumIncomingValues(), "", nzcv_phi);
+    cond_cache[{nzcv, cond}] = cond_phi;
+    for (unsigned i = 0; i < nzcv_phi->getNumIncomingValues(); i++)
+      cond_phi->addIncoming(get_cond(nzcv_phi->getIncomingValue(i), cond),
+                            nzcv_phi->getIncomingBlock(i));
+    return cond_phi;
+  };
+
+  std::vector<llvm::CallInst *> readers;
+  for (auto &func : *module)
+    for (auto &inst : llvm::instructions(func))
+      if (auto call = llvm::dyn_cast<llvm::CallInst>(&inst);
+          call && call->getCalledFunction() && reader_fns.contains(call->getCalledFunction()) &&
+          !shared_fns.contains(call->getCalledFunction()) && call->arg_size() > 0)
+        readers.push_back(call);
+
+  for (auto reader : readers) {
+    auto &cond = reader_fns.at(reader->getCalledFunction());
+    auto nzcv_i = reader->arg_size() - 1;
+    auto nzcv = reader->getArgOperand(nzcv_i);
+    std::set<llvm::PHINode *> visited;
+    if (!nzcv->getType()->isIntegerTy(64) || !is_foldable(nzcv, visited))
+      continue;
+    auto [true_nzcv, false_nzcv] = cond_nzcvs.at(cond);
+    llvm::IRBuilder<> ir(reader);
+    reader->setArgOperand(nzcv_i, ir.CreateSelect(get_cond(nzcv, cond), ir.getInt64(true_nzcv),
+                                                  ir.getInt64(false_nzcv)));
+  }
+}
+
+/*
+  __g_prof_fn_counts[i]: the number of the calls of the lifted function of __g_fn_vmas[i].
+  __g_prof_block_counts[i]: the number of the executions of the guest basic block
+  (__g_prof_block_fn_vmas[i], __g_prof_block_vmas[i]) marked by __g_profile_block.
+*/
+void MainLifter::WrapImpl::AddGuestProfileCounters(
+    std::unordered_map<uint64_t, const char *> &addr_fn_map) {
+
+  auto u64_ty = llvm::Type::getInt64Ty(context);
+
+  auto gen_counters = [&](size_t num, const std::string &name) {
+    std::vector<llvm::Constant *> zeros(num, llvm::ConstantInt::get(u64_ty, 0));
+    return GenGlobalArrayHelper(u64_ty, zeros, name, false);
+  };
+  auto increment_counter = [&](llvm::GlobalVariable *counters, uint64_t i,
+                               llvm::Instruction *inst_at_before) {
+    llvm::IRBuilder<> ir(inst_at_before);
+    auto counter = ir.CreateConstInBoundsGEP2_64(counters->getValueType(), counters, 0, i);
+    ir.CreateStore(ir.CreateAdd(ir.CreateLoad(u64_ty, counter), llvm::ConstantInt::get(u64_ty, 1)),
+                   counter);
+  };
+
+  /* function counters (same order as __g_fn_vmas) */
+  std::map<uint64_t, const char *> sorted_addr_fn_map(addr_fn_map.begin(), addr_fn_map.end());
+  std::unordered_map<llvm::Function *, uint64_t> fn_vma_map;
+  auto fn_counts = gen_counters(sorted_addr_fn_map.size(), g_prof_fn_counts_name);
+  uint64_t fn_i = 0;
+  for (auto &[fn_vma, fn_name] : sorted_addr_fn_map) {
+    auto lifted_fn = module->getFunction(fn_name);
+    CHECK(lifted_fn && !lifted_fn->isDeclaration()) << "lifted function " << fn_name;
+    fn_vma_map.insert({lifted_fn, fn_vma});
+    increment_counter(fn_counts, fn_i++, &*lifted_fn->getEntryBlock().getFirstInsertionPt());
+  }
+
+  /* block counters (sorted by the function vma and the block vma) */
+  std::vector<std::tuple<uint64_t, uint64_t, llvm::CallInst *>> marks;
+  auto profile_block_fn = module->getFunction(g_profile_block_func_name);
+  if (profile_block_fn) {
+    for (auto user : profile_block_fn->users()) {
+      auto call = llvm::cast<llvm::CallInst>(user);
+      marks.emplace_back(fn_vma_map.at(call->getFunction()),
+                         llvm::cast<llvm::ConstantInt>(call->getArgOperand(0))->getZExtValue(),
+                         call);
+    }
+  }
+  /* the block duplicated by the optimization shares the counter */
+  std::map<std::pair<uint64_t, uint64_t>, uint64_t> block_counter_map;
+  for (auto &[fn_vma, block_vma, _] : marks)
+    block_counter_map.insert({{fn_vma, block_vma}, block_counter_map.size()});
+  std::vector<llvm::Constant *> block_fn_vmas, block_vmas;
+  for (auto &[block_key, _] : block_counter_map) {
+    block_fn_vmas.push_back(llvm::ConstantInt::get(u64_ty, block_key.first));
+    block_vmas.push_back(llvm::ConstantInt::get(u64_ty, block_key.second));
+  }
+  auto block_counts = gen_counters(block_counter_map.size(), g_prof_block_counts_name);
+  for (auto &[fn_vma, block_vma, call] : marks) {
+    increment_counter(block_counts, block_counter_map.at({fn_vma, block_vma}), call);
+    call->eraseFromParent();
+  }
+  GenGlobalArrayHelper(u64_ty, block_fn_vmas, g_prof_block_fn_vmas_name);
+  GenGlobalArrayHelper(u64_ty, block_vmas, g_prof_block_vmas_name);
+  (void) new llvm::GlobalVariable(*module, u64_ty, true, llvm::GlobalValue::ExternalLinkage,
+                                  llvm::ConstantInt::get(u64_ty, block_counter_map.size()),
+                                  g_prof_block_num_name);
+
+  /* conditional branch counters (the executions and the taken) */
+  std::map<uint64_t, std::vector<llvm::CallInst *>> branch_marks;
+  if (auto profile_branch_fn = module->getFunction(g_profile_branch_func_name)) {
+    for (auto user : profile_branch_fn->users()) {
+      auto call = llvm::cast<llvm::CallInst>(user);
+      branch_marks[llvm::cast<llvm::ConstantInt>(call->getArgOperand(0))->getZExtValue()]
+          .push_back(call);
+    }
+  }
+  std::vector<llvm::Constant *> branch_vmas;
+  auto branch_counts = gen_counters(branch_marks.size(), g_prof_branch_counts_name);
+  auto branch_taken_counts = gen_counters(branch_marks.size(), g_prof_branch_taken_counts_name);
+  for (auto &[branch_vma, calls] : branch_marks) {
+    auto branch_i = branch_vmas.size();
+    branch_vmas.push_back(llvm::ConstantInt::get(u64_ty, branch_vma));
+    for (auto call : calls) {
+      increment_counter(branch_counts, branch_i, call);
+      llvm::IRBuilder<> ir(call);
+      auto taken_counter = ir.CreateConstInBoundsGEP2_64(branch_taken_counts->getValueType(),
+                                                         branch_taken_counts, 0, branch_i);
+      ir.CreateStore(ir.CreateAdd(ir.CreateLoad(u64_ty, taken_counter),
+                                  ir.CreateZExt(call->getArgOperand(1), u64_ty)),
+                     taken_counter);
+      call->eraseFromParent();
+    }
+  }
+  GenGlobalArrayHelper(u64_ty, branch_vmas, g_prof_branch_vmas_name);
+  (void) new llvm::GlobalVariable(*module, u64_ty, true, llvm::GlobalValue::ExternalLinkage,
+                                  llvm::ConstantInt::get(u64_ty, branch_marks.size()),
+                                  g_prof_branch_num_name);
+}
+
+/*
+  The runtime uses only the lifted functions (via __g_fn_ptr_table) and the data (__g_*, debug_*),
+  so the other definitions (e.g. semantics functions, ISEL_* variables) become internal and are
+  always inlined and removed by the optimization.
+*/
+void MainLifter::WrapImpl::InternalizeSemantics(
+    std::unordered_map<uint64_t, const char *> &addr_fn_map) {
+  std::set<llvm::Function *> lifted_fns;
+  for (auto &[_, fn_name] : addr_fn_map)
+    lifted_fns.insert(module->getFunction(fn_name));
+
+  for (auto used_name : {"llvm.used", "llvm.compiler.used"})
+    if (auto used_gvar = module->getGlobalVariable(used_name))
+      used_gvar->eraseFromParent();
+
+  for (auto &func : *module) {
+    if (func.isDeclaration() || func.hasLocalLinkage() || lifted_fns.contains(&func))
+      continue;
+    func.setLinkage(llvm::GlobalValue::InternalLinkage);
+    func.setComdat(nullptr);
+    if (!func.hasFnAttribute(llvm::Attribute::NoInline) &&
+        !func.hasFnAttribute(llvm::Attribute::OptimizeNone))
+      func.addFnAttr(llvm::Attribute::AlwaysInline);
+  }
+  for (auto &gvar : module->globals()) {
+    auto gvar_name = gvar.getName();
+    if (gvar.isDeclaration() || gvar.hasLocalLinkage() || gvar_name.startswith("__g_") ||
+        gvar_name.startswith("debug_") || gvar_name.startswith("llvm."))
+      continue;
+    gvar.setLinkage(llvm::GlobalValue::InternalLinkage);
+    gvar.setComdat(nullptr);
+  }
+}
+
+/* Inline the always_inline callees (e.g. semantics functions) into the lifted function */
+static void InlineAlwaysInlineCalls(llvm::Function *func, const llvm::Function *kept_fn = nullptr) {
+  for (bool inlined = true; inlined;) {
+    inlined = false;
+    std::vector<llvm::CallBase *> calls;
+    for (auto &inst : llvm::instructions(*func))
+      if (auto call = llvm::dyn_cast<llvm::CallBase>(&inst))
+        if (auto callee = call->getCalledFunction();
+            callee && callee != kept_fn && !callee->isDeclaration() &&
+            callee->hasFnAttribute(llvm::Attribute::AlwaysInline))
+          calls.push_back(call);
+    for (auto call : calls) {
+      llvm::InlineFunctionInfo inline_info;
+      inlined |= llvm::InlineFunction(*call, inline_info).isSuccess();
+    }
+  }
+}
+
+/* the access to the register in the State (instruction, register index, offset in the register) */
+struct StateRegAccess {
+  llvm::Instruction *inst;
+  size_t reg_i;
+  uint64_t reg_offset;
+};
+
+/*
+  Collect the loads and stores of `regs` in the State of the lifted function and the calls which
+  take the State. Returns false if the State pointer escapes (e.g. stored, phi) or the register is
+  accessed at an unknown offset.
+*/
+static bool CollectStateRegAccesses(llvm::Function *func, const std::vector<const Register *> &regs,
+                                    std::vector<StateRegAccess> &reg_accesses,
+                                    std::set<llvm::CallInst *> &state_calls) {
+  auto &dl = func->getParent()->getDataLayout();
+  auto state_ptr = NthArgument(func, kStatePointerArgNum);
+  std::vector<llvm::Value *> state_ptrs = {state_ptr};
+  while (!state_ptrs.empty()) {
+    auto ptr = state_ptrs.back();
+    state_ptrs.pop_back();
+    for (auto user : ptr->users()) {
+      if (auto gep = llvm::dyn_cast<llvm::GetElementPtrInst>(user)) {
+        if (!gep->hasAllConstantIndices())
+          return false;
+        state_ptrs.push_back(gep);
+      } else if (llvm::isa<llvm::BitCastInst>(user)) {
+        state_ptrs.push_back(user);
+      } else if (auto call = llvm::dyn_cast<llvm::CallInst>(user)) {
+        state_calls.insert(call);
+      } else if (llvm::isa<llvm::LoadInst>(user) ||
+                 (llvm::isa<llvm::StoreInst>(user) &&
+                  llvm::cast<llvm::StoreInst>(user)->getPointerOperand() == ptr)) {
+        auto inst = llvm::cast<llvm::Instruction>(user);
+        auto load_inst = llvm::dyn_cast<llvm::LoadInst>(inst);
+        auto store_inst = llvm::dyn_cast<llvm::StoreInst>(inst);
+        auto access_ty =
+            load_inst ? load_inst->getType() : store_inst->getValueOperand()->getType();
+        auto unordered = load_inst ? load_inst->isUnordered() : store_inst->isUnordered();
+        int64_t offset = 0;
+        if (llvm::GetPointerBaseWithConstantOffset(ptr, offset, dl) != state_ptr)
+          return false;
+        uint64_t access_begin = offset, access_end = offset + dl.getTypeStoreSize(access_ty);
+        for (size_t reg_i = 0; reg_i < regs.size(); reg_i++) {
+          auto reg = regs[reg_i];
+          if (access_end <= reg->offset || reg->offset + reg->size <= access_begin)
+            continue;
+          /* the access beyond the register or the volatile (atomic) access stays */
+          if (access_begin < reg->offset || reg->offset + reg->size < access_end || !unordered)
+            return false;
+          reg_accesses.push_back({inst, reg_i, access_begin - reg->offset});
+        }
+      } else {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/*
+  Stack-slot recovery (--stack_slots): SP is callee-saved, so the lifted function keeps SP in SSA
+  from the entry instead of reloading it from the State after the calls, and every SP value (also
+  X29 of `mov x29, sp`) becomes `entry SP + k`. If these values are used only as the addresses of
+  the guest memory accesses (the frame address is not stored to the memory or the State), the
+  accesses below the entry SP (the own frame) are moved to an alloca promoted by SROA. The frame is
+  written back to the guest stack before the calls because the callee may read the stack
+  arguments. The function with a dynamic SP (e.g. `sub sp, sp, x0`) or an escaping frame address
+  keeps the guest stack. The analysis runs on a copy of the function first, so only the function
+  whose frame is promoted gets SP in SSA.
+*/
+void MainLifter::WrapImpl::RecoverStackSlots(
+    std::unordered_map<uint64_t, const char *> &addr_fn_map) {
+  auto lifted_func_ty = intrinsics->function_call->getFunctionType();
+  auto u64_ty = llvm::Type::getInt64Ty(context);
+  auto &dl = module->getDataLayout();
+  auto sp_reg = arch->RegisterByName("SP");
+  /* the guest memory access is `load/store (__g_translate_vma_fast(vma))` with --inline_memory */
+  auto translate_fn = module->getFunction(g_translate_vma_fast_func_name);
+  std::set<llvm::Function *> read_fns = {
+      intrinsics->read_memory_8,   intrinsics->read_memory_16,  intrinsics->read_memory_32,
+      intrinsics->read_memory_64,  intrinsics->read_memory_128, intrinsics->read_memory_f32,
+      intrinsics->read_memory_f64};
+  std::set<llvm::Function *> write_fns = {
+      intrinsics->write_memory_8,   intrinsics->write_memory_16,  intrinsics->write_memory_32,
+      intrinsics->write_memory_64,  intrinsics->write_memory_128, intrinsics->write_memory_f32,
+      intrinsics->write_memory_f64};
+  /* the larger frame (e.g. local arrays) stays */
+  constexpr int64_t max_frame_size = 4096;
+
+  /*
+    SP in SSA, the frame analysis and (if `promote`) the promotion of the frame of `fn`. Returns
+    the size of the promoted (or promotable) frame, or 0 if the frame stays on the guest stack.
+  */
+  auto recover_frame = [&](llvm::Function *fn, bool promote) -> int64_t {
+    std::vector<StateRegAccess> sp_accesses;
+    std::set<llvm::CallInst *> state_calls;
+    if (!CollectStateRegAccesses(fn, {sp_reg}, sp_accesses, state_calls) ||
+        llvm::any_of(sp_accesses, [&](auto &sp_access) {
+          auto load_inst = llvm::dyn_cast<llvm::LoadInst>(sp_access.inst);
+          auto access_ty = load_inst ? load_inst->getType()
+                                     : llvm::cast<llvm::StoreInst>(sp_access.inst)
+                                           ->getValueOperand()
+                                           ->getType();
+          return access_ty != u64_ty;
+        }))
+      return 0;
+
+    /* SP in SSA (stored to the State only before the calls and the return) */
+    auto state_ptr = NthArgument(fn, kStatePointerArgNum);
+    auto runtime_manager = NthArgument(fn, kRuntimePointerArgNum);
+    auto &entry_bb = fn->getEntryBlock();
+    llvm::IRBuilder<> ir(&entry_bb, entry_bb.getFirstInsertionPt());
+    auto sp_alloca = ir.CreateAlloca(u64_ty, nullptr, "SP");
+    auto state_sp_ptr = ir.CreateConstInBoundsGEP1_64(ir.getInt8Ty(), state_ptr, sp_reg->offset);
+    auto entry_sp = ir.CreateLoad(u64_ty, state_sp_ptr, "entry_sp");
+    ir.CreateStore(entry_sp, sp_alloca);
+    for (auto &sp_access : sp_accesses) {
+      if (auto load_inst = llvm::dyn_cast<llvm::LoadInst>(sp_access.inst))
+        load_inst->setOperand(load_inst->getPointerOperandIndex(), sp_alloca);
+      else
+        sp_access.inst->setOperand(llvm::StoreInst::getPointerOperandIndex(), sp_alloca);
+    }
+    std::vector<llvm::Instruction *> sp_exits(state_calls.begin(), state_calls.end());
+    for (auto &bb : *fn)
+      if (auto ret = llvm::dyn_cast<llvm::ReturnInst>(bb.getTerminator()))
+        sp_exits.push_back(ret);
+    for (auto sp_exit : sp_exits) {
+      ir.SetInsertPoint(sp_exit);
+      ir.CreateStore(ir.CreateLoad(u64_ty, sp_alloca), state_sp_ptr);
+    }
+    llvm::DominatorTree dom_tree(*fn);
+    llvm::PromoteMemToReg({sp_alloca}, dom_tree);
+
+    /* the offsets from the entry SP and the guest memory accesses by them */
+    struct FrameAccess {
+      llvm::CallInst *call;
+      int64_t offset;
+      llvm::Type *access_ty;
+    };
+    std::vector<FrameAccess> frame_accesses;
+    std::map<llvm::Value *, int64_t> sp_offsets = {{entry_sp, 0}};
+    std::vector<llvm::Value *> sp_vals = {entry_sp};
+    bool escaped = false;
+    auto add_sp_val = [&](llvm::Value *sp_val, int64_t offset) {
+      if (auto [it, inserted] = sp_offsets.emplace(sp_val, offset); inserted)
+        sp_vals.push_back(sp_val);
+      else
+        escaped |= it->second != offset;
+    };
+    while (!escaped && !sp_vals.empty()) {
+      auto sp_val = sp_vals.back();
+      sp_vals.pop_back();
+      auto offset = sp_offsets.at(sp_val);
+      for (auto user : sp_val->users()) {
+        auto bin_op = llvm::dyn_cast<llvm::BinaryOperator>(user);
+        auto call = llvm::dyn_cast<llvm::CallInst>(user);
+        auto callee = call ? call->getCalledFunction() : nullptr;
+        /* sp + imm, imm + sp, sp - imm */
+        llvm::ConstantInt *imm = nullptr;
+        if (bin_op && bin_op->getOpcode() == llvm::Instruction::Add)
+          imm = llvm::dyn_cast<llvm::ConstantInt>(
+              bin_op->getOperand(bin_op->getOperand(0) == sp_val ? 1 : 0));
+        else if (bin_op && bin_op->getOpcode() == llvm::Instruction::Sub &&
+                 bin_op->getOperand(0) == sp_val)
+          imm = llvm::dyn_cast<llvm::ConstantInt>(bin_op->getOperand(1));
+        if (imm) {
+          add_sp_val(bin_op, bin_op->getOpcode() == llvm::Instruction::Add
+                                 ? offset + imm->getSExtValue()
+                                 : offset - imm->getSExtValue());
+        } else if (llvm::isa<llvm::PHINode>(user) ||
+                   (llvm::isa<llvm::SelectInst>(user) &&
+                    llvm::cast<llvm::SelectInst>(user)->getCondition() != sp_val)) {
+          add_sp_val(user, offset);
+        } else if (callee && callee == translate_fn && call->getArgOperand(1) == sp_val &&
+                   call->hasOneUse()) {
+          auto mem_inst = call->user_back();
+          if (auto load_inst = llvm::dyn_cast<llvm::LoadInst>(mem_inst))
+            frame_accesses.push_back({call, offset, load_inst->getType()});
+          else if (auto store_inst = llvm::dyn_cast<llvm::StoreInst>(mem_inst);
+                   store_inst && store_inst->getPointerOperand() == call)
+            frame_accesses.push_back({call, offset, store_inst->getValueOperand()->getType()});
+          else
+            escaped = true;
+        } else if (callee && read_fns.contains(callee) && call->getArgOperand(1) == sp_val) {
+          frame_accesses.push_back({call, offset, call->getType()});
+        } else if (callee && write_fns.contains(callee) && call->getArgOperand(1) == sp_val &&
+                   call->getArgOperand(2) != sp_val) {
+          frame_accesses.push_back({call, offset, call->getArgOperand(2)->getType()});
+        } else if (auto store_inst = llvm::dyn_cast<llvm::StoreInst>(user);
+                   store_inst && store_inst->getValueOperand() == sp_val) {
+          /* only SP of the State */
+          int64_t state_offset = 0;
+          escaped |= llvm::GetPointerBaseWithConstantOffset(store_inst->getPointerOperand(),
+                                                            state_offset, dl) != state_ptr ||
+                     state_offset != static_cast<int64_t>(sp_reg->offset);
+        } else {
+          escaped = true;
+        }
+      }
+    }
+    /* every incoming value of the phi and select is also the same SP value */
+    for (auto &[sp_val, offset] : sp_offsets) {
+      if (auto phi = llvm::dyn_cast<llvm::PHINode>(sp_val))
+        escaped |= llvm::any_of(phi->incoming_values(), [&](auto &incoming) {
+          return !sp_offsets.contains(incoming) || sp_offsets.at(incoming) != offset;
+        });
+      else if (auto select = llvm::dyn_cast<llvm::SelectInst>(sp_val))
+        for (auto operand : {select->getTrueValue(), select->getFalseValue()})
+          escaped |= !sp_offsets.contains(operand) || sp_offsets.at(operand) != offset;
+    }
+
+    /* the own frame is below the entry SP (the stack arguments above it stay) */
+    int64_t frame_begin = 0;
+    size_t frame_access_num = 0;
+    for (auto &frame_access : frame_accesses) {
+      if (frame_access.offset >= 0)
+        continue;
+      auto access_end = frame_access.offset +
+                        static_cast<int64_t>(dl.getTypeStoreSize(frame_access.access_ty));
+      escaped |= access_end > 0;
+      frame_begin = std::min(frame_begin, frame_access.offset);
+      frame_access_num++;
+    }
+    frame_begin = -static_cast<int64_t>(llvm::alignTo(-frame_begin, 8));
+    if (escaped || frame_access_num == 0 || -frame_begin > max_frame_size)
+      return 0;
+
+    /* the calls which may read the guest stack (other than the memory accesses) */
+    std::vector<llvm::CallInst *> flush_calls;
+    for (auto &inst : llvm::instructions(*fn))
+      if (auto call = llvm::dyn_cast<llvm::CallInst>(&inst)) {
+        auto callee = call->getCalledFunction();
+        if (!callee || (!callee->isIntrinsic() && callee != translate_fn &&
+                        !read_fns.contains(callee) && !write_fns.contains(callee) &&
+                        !callee->getName().startswith("__remill_atomic") &&
+                        !callee->getName().startswith("__remill_barrier")))
+          flush_calls.push_back(call);
+      }
+    /* the write back costs more than the accesses */
+    if (flush_calls.size() * static_cast<size_t>(-frame_begin / 8) >= frame_access_num)
+      return 0;
+    if (!promote)
+      return -frame_begin;
+
+    ir.SetInsertPoint(&entry_bb, entry_bb.getFirstInsertionPt());
+    auto frame_alloca =
+        ir.CreateAlloca(llvm::ArrayType::get(ir.getInt8Ty(), -frame_begin), nullptr, "frame");
+    frame_alloca->setAlignment(llvm::Align(16));
+    auto frame_ptr = [&](int64_t offset) {
+      return ir.CreateConstInBoundsGEP1_64(ir.getInt8Ty(), frame_alloca, offset - frame_begin);
+    };
+    for (auto &[call, offset, access_ty] : frame_accesses) {
+      if (offset >= 0)
+        continue;
+      ir.SetInsertPoint(call);
+      if (call->getCalledFunction() == translate_fn) {
+        auto mem_inst = call->user_back();
+        if (auto load_inst = llvm::dyn_cast<llvm::LoadInst>(mem_inst))
+          load_inst->setOperand(load_inst->getPointerOperandIndex(), frame_ptr(offset));
+        else
+          mem_inst->setOperand(llvm::StoreInst::getPointerOperandIndex(), frame_ptr(offset));
+      } else if (read_fns.contains(call->getCalledFunction())) {
+        call->replaceAllUsesWith(ir.CreateLoad(access_ty, frame_ptr(offset)));
+      } else {
+        ir.CreateStore(call->getArgOperand(2), frame_ptr(offset));
+      }
+      call->eraseFromParent();
+    }
+    for (auto call : flush_calls) {
+      ir.SetInsertPoint(call);
+      for (auto offset = frame_begin; offset < 0; offset += 8) {
+        auto vma = ir.CreateAdd(entry_sp, llvm::ConstantInt::get(u64_ty, offset));
+        auto val = ir.CreateLoad(u64_ty, frame_ptr(offset));
+        if (translate_fn)
+          ir.CreateAlignedStore(val, ir.CreateCall(translate_fn, {runtime_manager, vma}),
+                                llvm::Align(1));
+        else
+          ir.CreateCall(intrinsics->write_memory_64, {runtime_manager, vma, val});
+      }
+    }
+    return -frame_begin;
+  };
+
+  for (auto &[fn_vma, fn_name] : addr_fn_map) {
+    auto lifted_fn = module->getFunction(fn_name);
+    if (!lifted_fn || lifted_fn->isDeclaration() || lifted_fn->getFunctionType() != lifted_func_ty)
+      continue;
+    InlineAlwaysInlineCalls(lifted_fn, translate_fn);
+    /* analyze the copy first, so the function which keeps the guest stack stays unchanged */
+    llvm::ValueToValueMapTy vmap;
+    auto scratch_fn = llvm::CloneFunction(lifted_fn, vmap);
+    auto frame_size = recover_frame(scratch_fn, false);
+    scratch_fn->eraseFromParent();
+    if (frame_size == 0)
+      continue;
+    auto promoted_size = recover_frame(lifted_fn, true);
+    CHECK(promoted_size == frame_size)
+        << "The frame of " << fn_name << " isn't promoted after the analysis.";
+    if (stats)
+      stats->funcs[fn_vma].promoted_frame_bytes = promoted_size;
+  }
+}
+
+/*
+  SSA call registers (--ssa_call_regs): the direct call between the lifted functions passes
+  X0-X7, V0-V7 and SP as the arguments and gets X0, X1, V0-V3 and SP as the return value (every
+  AAPCS64 result register, e.g. V0-V3 of the HFA with four members). The other argument
+  registers keep the caller's values after the call, both in the caller and through the wrapper
+  (AAPCS64 doesn't define them after the call). The body of the lifted function `F` moves
+  to the internal `F.ssa`, which keeps these registers in the allocas (promoted by SROA) and
+  stores them to the `State` only around the other calls taking the `State` (e.g.
+  __remill_function_call, the syscall and the function which is not converted). `F` becomes the
+  wrapper for the indirect calls and the runtime. The function which accesses the `State` at an
+  unknown offset or has the block addresses (indirect jumps) is not converted.
+*/
+void MainLifter::WrapImpl::PassRegsInSSA(std::unordered_map<uint64_t, const char *> &addr_fn_map) {
+  auto lifted_func_ty = intrinsics->function_call->getFunctionType();
+
+  /* (register, returned) */
+  std::vector<std::pair<const Register *, bool>> ssa_regs;
+  for (int i = 0; i < 8; i++)
+    ssa_regs.emplace_back(arch->RegisterByName("X" + std::to_string(i)), i < 2);
+  for (int i = 0; i < 8; i++)
+    ssa_regs.emplace_back(arch->RegisterByName("V" + std::to_string(i)), i < 4);
+  ssa_regs.emplace_back(arch->RegisterByName("SP"), true);
+
+  std::vector<llvm::Type *> param_tys(lifted_func_ty->param_begin(), lifted_func_ty->param_end());
+  std::vector<llvm::Type *> ret_tys;
+  for (auto [reg, returned] : ssa_regs) {
+    auto reg_ty = llvm::IntegerType::get(context, reg->size * 8);
+    param_tys.push_back(reg_ty);
+    if (returned)
+      ret_tys.push_back(reg_ty);
+  }
+  auto ssa_ret_ty = llvm::StructType::get(context, ret_tys);
+  auto ssa_fn_ty = llvm::FunctionType::get(ssa_ret_ty, param_tys, false);
+
+  std::map<uint64_t, llvm::Function *> lifted_fn_map;
+  for (auto &[fn_vma, fn_name] : addr_fn_map)
+    if (auto lifted_fn = module->getFunction(fn_name);
+        lifted_fn && !lifted_fn->isDeclaration() && lifted_fn->getFunctionType() == lifted_func_ty)
+      lifted_fn_map[fn_vma] = lifted_fn;
+
+  /* the semantics functions are inlined first to see their accesses to the State */
+  for (auto &[_, lifted_fn] : lifted_fn_map)
+    InlineAlwaysInlineCalls(lifted_fn);
+
+  struct SSAFunc {
+    llvm::Function *ssa_fn;
+    std::vector<StateRegAccess> reg_accesses;
+    std::set<llvm::CallInst *> state_calls;
+  };
+  std::map<llvm::Function *, SSAFunc> ssa_fns;
+  std::vector<const Register *> regs;
+  for (auto [reg, _] : ssa_regs)
+    regs.push_back(reg);
+  for (auto &[_, lifted_fn] : lifted_fn_map) {
+    SSAFunc ssa_func = {nullptr, {}, {}};
+    if (!llvm::any_of(*lifted_fn, [](auto &bb) { return bb.hasAddressTaken(); }) &&
+        CollectStateRegAccesses(lifted_fn, regs, ssa_func.reg_accesses, ssa_func.state_calls))
+      ssa_fns.emplace(lifted_fn, std::move(ssa_func));
+  }
+
+  /* move the body to `F.ssa` and make `F` the wrapper */
+  for (auto &[_, lifted_fn] : lifted_fn_map) {
+    if (!ssa_fns.contains(lifted_fn))
+      continue;
+    auto &ssa_func = ssa_fns.at(lifted_fn);
+    auto ssa_fn = llvm::Function::Create(ssa_fn_ty, llvm::GlobalValue::InternalLinkage,
+                                         lifted_fn->getName() + ".ssa", *module);
+    for (auto attr : lifted_fn->getAttributes().getFnAttrs())
+      ssa_fn->addFnAttr(attr);
+    ssa_fn->splice(ssa_fn->begin(), lifted_fn);
+    for (unsigned arg_i = 0; arg_i < lifted_func_ty->getNumParams(); arg_i++) {
+      ssa_fn->getArg(arg_i)->takeName(lifted_fn->getArg(arg_i));
+      lifted_fn->getArg(arg_i)->replaceAllUsesWith(ssa_fn->getArg(arg_i));
+    }
+    ssa_func.ssa_fn = ssa_fn;
+
+    auto state_ptr = NthArgument(lifted_fn, kStatePointerArgNum);
+    llvm::IRBuilder<> ir(llvm::BasicBlock::Create(context, "entry", lifted_fn));
+    llvm::SmallVector<llvm::Value *> args;
+    for (auto &arg : lifted_fn->args())
+      args.push_back(&arg);
+    for (auto [reg, _] : ssa_regs)
+      args.push_back(ir.CreateLoad(ssa_fn_ty->getParamType(args.size()),
+                                   ir.CreateConstInBoundsGEP1_64(ir.getInt8Ty(), state_ptr,
+                                                                 reg->offset)));
+    auto ret_regs = ir.CreateCall(ssa_fn, args);
+    for (unsigned reg_i = 0, ret_i = 0; reg_i < ssa_regs.size(); reg_i++)
+      if (auto [reg, returned] = ssa_regs[reg_i]; returned)
+        ir.CreateStore(ir.CreateExtractValue(ret_regs, ret_i++),
+                       ir.CreateConstInBoundsGEP1_64(ir.getInt8Ty(), state_ptr, reg->offset));
+    ir.CreateRetVoid();
+  }
+
+  for (auto &[_, ssa_func] : ssa_fns) {
+    auto ssa_fn = ssa_func.ssa_fn;
+    auto state_ptr = NthArgument(ssa_fn, kStatePointerArgNum);
+    auto entry_bb = &ssa_fn->getEntryBlock();
+    llvm::IRBuilder<> ir(entry_bb, entry_bb->getFirstInsertionPt());
+
+    /* the registers in the allocas */
+    std::vector<llvm::AllocaInst *> reg_allocas;
+    for (size_t reg_i = 0; reg_i < ssa_regs.size(); reg_i++) {
+      auto reg_ty = ssa_fn_ty->getParamType(lifted_func_ty->getNumParams() + reg_i);
+      reg_allocas.push_back(ir.CreateAlloca(reg_ty, nullptr, ssa_regs[reg_i].first->name));
+    }
+    for (size_t reg_i = 0; reg_i < ssa_regs.size(); reg_i++)
+      ir.CreateStore(ssa_fn->getArg(lifted_func_ty->getNumParams() + reg_i), reg_allocas[reg_i]);
+
+    for (auto &[inst, reg_i, reg_offset] : ssa_func.reg_accesses) {
+      ir.SetInsertPoint(inst);
+      auto reg_ptr = ir.CreateConstInBoundsGEP1_64(ir.getInt8Ty(), reg_allocas[reg_i], reg_offset);
+      if (auto load_inst = llvm::dyn_cast<llvm::LoadInst>(inst))
+        load_inst->setOperand(load_inst->getPointerOperandIndex(), reg_ptr);
+      else
+        inst->setOperand(llvm::StoreInst::getPointerOperandIndex(), reg_ptr);
+    }
+
+    for (auto call : ssa_func.state_calls) {
+      ir.SetInsertPoint(call);
+      auto callee_it = ssa_fns.find(call->getCalledFunction());
+      /* the direct call of the converted function */
+      if (callee_it != ssa_fns.end() && call->getArgOperand(kStatePointerArgNum) == state_ptr) {
+        llvm::SmallVector<llvm::Value *> args(call->args());
+        for (auto reg_alloca : reg_allocas)
+          args.push_back(ir.CreateLoad(reg_alloca->getAllocatedType(), reg_alloca));
+        auto ret_regs = ir.CreateCall(callee_it->second.ssa_fn, args);
+        for (unsigned reg_i = 0, ret_i = 0; reg_i < ssa_regs.size(); reg_i++)
+          if (ssa_regs[reg_i].second)
+            ir.CreateStore(ir.CreateExtractValue(ret_regs, ret_i++), reg_allocas[reg_i]);
+        call->eraseFromParent();
+        continue;
+      }
+      /* the other call sees the registers in the State */
+      auto state_reg_ptr = [&](size_t reg_i) {
+        return ir.CreateConstInBoundsGEP1_64(ir.getInt8Ty(), state_ptr,
+                                             ssa_regs[reg_i].first->offset);
+      };
+      for (size_t reg_i = 0; reg_i < ssa_regs.size(); reg_i++)
+        ir.CreateStore(ir.CreateLoad(reg_allocas[reg_i]->getAllocatedType(), reg_allocas[reg_i]),
+                       state_reg_ptr(reg_i));
+      ir.SetInsertPoint(call->getNextNode());
+      for (size_t reg_i = 0; reg_i < ssa_regs.size(); reg_i++)
+        ir.CreateStore(ir.CreateLoad(reg_allocas[reg_i]->getAllocatedType(), state_reg_ptr(reg_i)),
+                       reg_allocas[reg_i]);
+    }
+
+    std::vector<llvm::ReturnInst *> rets;
+    for (auto &bb : *ssa_fn)
+      if (auto ret = llvm::dyn_cast<llvm::ReturnInst>(bb.getTerminator()))
+        rets.push_back(ret);
+    for (auto ret : rets) {
+      ir.SetInsertPoint(ret);
+      llvm::Value *ret_regs = llvm::UndefValue::get(ssa_ret_ty);
+      for (unsigned reg_i = 0, ret_i = 0; reg_i < ssa_regs.size(); reg_i++)
+        if (ssa_regs[reg_i].second)
+          ret_regs = ir.CreateInsertValue(
+              ret_regs, ir.CreateLoad(reg_allocas[reg_i]->getAllocatedType(), reg_allocas[reg_i]),
+              ret_i++);
+      ir.CreateRet(ret_regs);
+      ret->eraseFromParent();
+    }
+  }
+}
+
+/* Place the lifted functions in the descending order of the calls of the previous run */
+void MainLifter::WrapImpl::OrderFunctionsByProfile(
+    std::unordered_map<uint64_t, const char *> &addr_fn_map) {
+  CHECK(profile);
+  std::vector<std::tuple<uint64_t, uint64_t, llvm::Function *>> hot_fns;
+  for (auto &[fn_vma, fn_name] : addr_fn_map)
+    if (profile->fn_counts.contains(fn_vma))
+      hot_fns.emplace_back(profile->fn_counts.at(fn_vma), fn_vma, module->getFunction(fn_name));
+  /* (calls, vma) descending */
+  std::sort(hot_fns.rbegin(), hot_fns.rend());
+  auto &func_list = module->getFunctionList();
+  for (auto it = hot_fns.rbegin(); it != hot_fns.rend(); it++) {
+    auto hot_fn = std::get<llvm::Function *>(*it);
+    func_list.splice(func_list.begin(), func_list, hot_fn->getIterator());
+  }
+}
+
+/* Remove the local definitions which are no longer used */
+static void EraseUnusedLocalDefinitions(llvm::Module *module) {
+  for (bool erased = true; erased;) {
+    erased = false;
+    for (auto &func : llvm::make_early_inc_range(*module)) {
+      if (func.hasLocalLinkage() && func.use_empty()) {
+        func.eraseFromParent();
+        erased = true;
+      }
+    }
+    for (auto &gvar : llvm::make_early_inc_range(module->globals())) {
+      if (gvar.hasLocalLinkage() && gvar.use_empty()) {
+        gvar.eraseFromParent();
+        erased = true;
+      }
+    }
+  }
+}
+
+/* Strip the definitions which the main module also has (e.g. semantics) before linking */
+void MainLifter::WrapImpl::PrepareShardModule() {
+  /* the block address arrays of the lifted functions */
+  std::set<llvm::GlobalValue *> kept_gvars;
+  for (auto lifted_fn : lifted_funcs)
+    for (auto suffix : {".bb_addrs", ".bb_addr_vmas"})
+      if (auto bb_gvar = module->getGlobalVariable((lifted_fn->getName() + suffix).str()))
+        kept_gvars.insert(bb_gvar);
+
+  for (auto used_name : {"llvm.used", "llvm.compiler.used"})
+    if (auto used_gvar = module->getGlobalVariable(used_name))
+      used_gvar->eraseFromParent();
+
+  for (auto &func : *module) {
+    if (func.isDeclaration() || func.hasLocalLinkage() || lifted_funcs.contains(&func))
+      continue;
+    func.deleteBody();
+    func.setComdat(nullptr);
+  }
+  for (auto &gvar : module->globals()) {
+    if (gvar.isDeclaration() || gvar.hasLocalLinkage() || kept_gvars.contains(&gvar))
+      continue;
+    gvar.setInitializer(nullptr);
+    gvar.setLinkage(llvm::GlobalValue::ExternalLinkage);
+    gvar.setComdat(nullptr);
+  }
+  EraseUnusedLocalDefinitions(module);
+}
+
+/*
+  Clone the initializers of the global variables again after the function bodies are cloned.
+  CloneModule maps the initializers first, so the blockaddress of the function which is not
+  cloned yet (e.g. `.bb_addrs`) becomes `inttoptr (i32 1)`.
+*/
+static void RemapGlobalInitializers(llvm::Module &src_module, llvm::ValueToValueMapTy &vmap) {
+  /* only the globals and blocks (`vmap` also caches the broken constants) */
+  llvm::ValueToValueMapTy gval_bb_vmap;
+  for (auto vmap_entry : vmap)
+    if (llvm::isa<llvm::GlobalValue>(vmap_entry.first) ||
+        llvm::isa<llvm::BasicBlock>(vmap_entry.first))
+      gval_bb_vmap[vmap_entry.first] = vmap_entry.second;
+  for (auto &src_gvar : src_module.globals()) {
+    if (src_gvar.isDeclaration())
+      continue;
+    auto cloned_gvar = llvm::dyn_cast_or_null<llvm::GlobalVariable>(vmap.lookup(&src_gvar));
+    if (cloned_gvar && !cloned_gvar->isDeclaration())
+      cloned_gvar->setInitializer(llvm::MapValue(src_gvar.getInitializer(), gval_bb_vmap));
+  }
+}
+
+/*
+  Copy the prepared shard module with only one lifted function (--lift_cache).
+  The other lifted functions and their block address data become declarations.
+*/
+std::unique_ptr<llvm::Module>
+MainLifter::WrapImpl::ExtractLiftedFunction(llvm::Function *lifted_fn) {
+  std::set<const llvm::GlobalValue *> other_lifted_gvals(lifted_funcs.begin(), lifted_funcs.end());
+  for (auto other_fn : lifted_funcs)
+    for (auto suffix : {".bb_addrs", ".bb_addr_vmas"})
+      if (auto bb_gvar = module->getGlobalVariable((other_fn->getName() + suffix).str()))
+        other_lifted_gvals.insert(bb_gvar);
+  auto fn_name = lifted_fn->getName().str();
+  for (auto own_name : {fn_name, fn_name + ".bb_addrs", fn_name + ".bb_addr_vmas"})
+    if (auto own_gval = module->getNamedValue(own_name))
+      other_lifted_gvals.erase(own_gval);
+
+  llvm::ValueToValueMapTy vmap;
+  auto fn_module = llvm::CloneModule(*module, vmap, [&](const llvm::GlobalValue *gval) {
+    return !other_lifted_gvals.contains(gval);
+  });
+  RemapGlobalInitializers(*module, vmap);
+  EraseUnusedLocalDefinitions(fn_module.get());
+  for (auto &func : llvm::make_early_inc_range(*fn_module))
+    if (func.isDeclaration() && func.use_empty())
+      func.eraseFromParent();
+  for (auto &gvar : llvm::make_early_inc_range(fn_module->globals()))
+    if (gvar.isDeclaration() && gvar.use_empty())
+      gvar.eraseFromParent();
+  return fn_module;
+}
+
+/*
+  Split the lifted functions into `shard_num` modules for the parallel compilation (--shards).
+  The functions are placed in the depth-first order of the direct calls and cut into the shards
+  of the same instruction number, so the caller and the callees are mostly in the same shard.
+  The main module keeps the other definitions (e.g. `__g_*` tables), and the shard has the
+  available_externally copies of the helper functions to inline them.
+*/
+std::vector<std::unique_ptr<llvm::Module>>
+MainLifter::WrapImpl::SplitLiftedModule(std::unordered_map<uint64_t, const char *> &addr_fn_map,
+                                        unsigned shard_num) {
+  std::map<uint64_t, llvm::Function *> lifted_fn_map;
+  for (auto &[fn_vma, fn_name] : addr_fn_map)
+    if (auto lifted_fn = module->getFunction(fn_name); lifted_fn && !lifted_fn->isDeclaration())
+      lifted_fn_map[fn_vma] = lifted_fn;
+
+  /* depth-first order of the direct calls */
+  std::set<llvm::Function *> lifted_fns, visited_fns;
+  /* `F` of `F.ssa` (--ssa_call_regs) */
+  std::map<llvm::Function *, llvm::Function *> ssa_lifted_fns;
+  for (auto &[_, lifted_fn] : lifted_fn_map) {
+    lifted_fns.insert(lifted_fn);
+    if (auto ssa_fn = module->getFunction((lifted_fn->getName() + ".ssa").str()))
+      ssa_lifted_fns[ssa_fn] = lifted_fn;
+  }
+  std::vector<llvm::Function *> ordered_fns;
+  for (auto &[_, root_fn] : lifted_fn_map) {
+    std::vector<llvm::Function *> fn_stack = {root_fn};
+    while (!fn_stack.empty()) {
+      auto lifted_fn = fn_stack.back();
+      fn_stack.pop_back();
+      if (!visited_fns.insert(lifted_fn).second)
+        continue;
+      ordered_fns.push_back(lifted_fn);
+      std::vector<llvm::Function *> body_fns = {lifted_fn};
+      if (auto ssa_fn = module->getFunction((lifted_fn->getName() + ".ssa").str()))
+        body_fns.push_back(ssa_fn);
+      for (auto body_fn : body_fns)
+        for (auto &inst : llvm::instructions(*body_fn))
+          if (auto call_inst = llvm::dyn_cast<llvm::CallBase>(&inst)) {
+            auto callee = call_inst->getCalledFunction();
+            if (ssa_lifted_fns.contains(callee))
+              callee = ssa_lifted_fns.at(callee);
+            if (callee && lifted_fns.contains(callee) && !visited_fns.contains(callee))
+              fn_stack.push_back(callee);
+          }
+    }
+  }
+
+  /* cut into the shards of the same instruction number */
+  std::map<const llvm::GlobalValue *, unsigned> gval_shards;
+  uint64_t total_inst_num = 0, inst_num = 0;
+  for (auto lifted_fn : ordered_fns) {
+    total_inst_num += lifted_fn->getInstructionCount();
+    if (auto ssa_fn = module->getFunction((lifted_fn->getName() + ".ssa").str()))
+      total_inst_num += ssa_fn->getInstructionCount();
+  }
+  for (auto lifted_fn : ordered_fns) {
+    auto shard_i = std::min<uint64_t>(inst_num * shard_num / std::max<uint64_t>(total_inst_num, 1),
+                                      shard_num - 1);
+    inst_num += lifted_fn->getInstructionCount();
+    gval_shards[lifted_fn] = shard_i;
+    for (auto suffix : {".bb_addrs", ".bb_addr_vmas"})
+      if (auto bb_gvar = module->getGlobalVariable((lifted_fn->getName() + suffix).str()))
+        gval_shards[bb_gvar] = shard_i;
+    /* the body moved by --ssa_call_regs */
+    if (auto ssa_fn = module->getFunction((lifted_fn->getName() + ".ssa").str())) {
+      inst_num += ssa_fn->getInstructionCount();
+      gval_shards[ssa_fn] = shard_i;
+    }
+  }
+  /* the global variable only used by one shard (e.g. the inline cache) is moved to the shard */
+  for (auto &gvar : module->globals()) {
+    if (gvar.isDeclaration() || gval_shards.contains(&gvar) || gvar.getName().startswith("llvm."))
+      continue;
+    std::set<unsigned> user_shards;
+    std::vector<const llvm::User *> users(gvar.user_begin(), gvar.user_end());
+    while (!users.empty()) {
+      auto user = users.back();
+      users.pop_back();
+      if (auto user_inst = llvm::dyn_cast<llvm::Instruction>(user)) {
+        auto user_fn_it = gval_shards.find(user_inst->getFunction());
+        user_shards.insert(user_fn_it != gval_shards.end() ? user_fn_it->second : shard_num);
+      } else if (llvm::isa<llvm::Constant>(user) && !llvm::isa<llvm::GlobalValue>(user)) {
+        users.insert(users.end(), user->user_begin(), user->user_end());
+      } else {
+        user_shards.insert(shard_num);
+      }
+    }
+    if (user_shards.size() == 1 && *user_shards.begin() < shard_num)
+      gval_shards[&gvar] = *user_shards.begin();
+  }
+
+  /* every definition is referred from the other modules */
+  for (auto &gval : module->global_values()) {
+    if (gval.isDeclaration() || !gval.hasLocalLinkage() || gval.getName().startswith("llvm."))
+      continue;
+    gval.setName("elfc.local." + (gval.hasName() ? gval.getName().str() : std::string("anon")));
+    gval.setLinkage(llvm::GlobalValue::ExternalLinkage);
+    gval.setVisibility(llvm::GlobalValue::HiddenVisibility);
+  }
+
+  std::vector<std::unique_ptr<llvm::Module>> shard_modules;
+  for (unsigned shard_i = 0; shard_i < shard_num; shard_i++) {
+    llvm::ValueToValueMapTy vmap;
+    auto shard_module = llvm::CloneModule(*module, vmap, [&](const llvm::GlobalValue *gval) {
+      if (auto gval_shard_it = gval_shards.find(gval); gval_shard_it != gval_shards.end())
+        return gval_shard_it->second == shard_i;
+      return llvm::isa<llvm::Function>(gval);
+    });
+    RemapGlobalInitializers(*module, vmap);
+    for (auto &func : *shard_module) {
+      if (func.isDeclaration() || gval_shards.contains(module->getFunction(func.getName())))
+        continue;
+      func.setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+      func.setVisibility(llvm::GlobalValue::DefaultVisibility);
+      func.setComdat(nullptr);
+    }
+    /* remove the helper functions and declarations which are not used in the shard */
+    for (bool erased = true; erased;) {
+      erased = false;
+      for (auto &func : llvm::make_early_inc_range(*shard_module)) {
+        if ((func.isDeclaration() || func.hasAvailableExternallyLinkage()) && func.use_empty()) {
+          func.eraseFromParent();
+          erased = true;
+        }
+      }
+    }
+    for (auto &gvar : llvm::make_early_inc_range(shard_module->globals()))
+      if (gvar.isDeclaration() && (gvar.use_empty() || gvar.getName().startswith("llvm.")))
+        gvar.eraseFromParent();
+    shard_modules.push_back(std::move(shard_module));
+  }
+
+  /* the main module has only the declarations of the moved definitions */
+  for (auto &[gval, _] : gval_shards) {
+    auto moved_gobj = llvm::cast<llvm::GlobalObject>(const_cast<llvm::GlobalValue *>(gval));
+    if (auto moved_fn = llvm::dyn_cast<llvm::Function>(moved_gobj))
+      moved_fn->deleteBody();
+    else
+      llvm::cast<llvm::GlobalVariable>(moved_gobj)->setInitializer(nullptr);
+    moved_gobj->setComdat(nullptr);
+  }
+  return shard_modules;
 }
 
 /* Prepare the virtual machine for instruction test */
@@ -379,6 +1818,10 @@ llvm::GlobalVariable *MainLifter::WrapImpl::SetFuncSymbolNameTable(
         llvm::ConstantExpr::getBitCast(symbol_name_gvar, llvm::Type::getInt8PtrTy(context)));
     fn_vma_list.push_back(llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), fn_addr));
   }
+  /* insert guard */
+  func_symbol_ptr_list.push_back(
+      llvm::ConstantPointerNull::get(llvm::Type::getInt8PtrTy(context)));
+  fn_vma_list.push_back(llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), 0));
 
   GenGlobalArrayHelper(llvm::Type::getInt8PtrTy(context), func_symbol_ptr_list,
                        g_fun_symbol_table_name);
@@ -26,13 +26,23 @@ class MainLifter : public TraceLifter {
           g_platform_name("__g_platform_name"),
           g_addr_list_name("__g_fn_vmas"),
           g_fun_ptr_table_name("__g_fn_ptr_table"),
-          g_block_address_ptrs_array_name("__g_block_address_ptrs_array"),
-          g_block_address_vmas_array_name("__g_block_address_vmas_array"),
-          g_block_address_size_array_name("__g_block_address_size_array"),
-          g_block_address_fn_vma_array_name("__g_block_address_fn_vma_array"),
-          g_block_address_array_size_name("__g_block_address_array_size"),
           g_fun_symbol_table_name("__g_fn_symbol_table"),
           g_addr_list_second_name("__g_fn_vmas_second"),
+          g_mem_region_guest_base_name("__g_mem_region_guest_base"),
+          g_mem_region_size_name("__g_mem_region_size"),
+          g_mem_region_host_base_name("__g_mem_region_host_base"),
+          g_translate_vma_func_name("__g_translate_vma"),
+          g_translate_vma_fast_func_name("__g_translate_vma_fast"),
+          g_get_lifted_func_name("__g_get_lifted_func"),
+          g_prof_fn_counts_name("__g_prof_fn_counts"),
+          g_prof_block_num_name("__g_prof_block_num"),
+          g_prof_block_fn_vmas_name("__g_prof_block_fn_vmas"),
+          g_prof_block_vmas_name("__g_prof_block_vmas"),
+          g_prof_block_counts_name("__g_prof_block_counts"),
+          g_prof_branch_num_name("__g_prof_branch_num"),
+          g_prof_branch_vmas_name("__g_prof_branch_vmas"),
+          g_prof_branch_counts_name("__g_prof_branch_counts"),
+          g_prof_branch_taken_counts_name("__g_prof_branch_taken_counts"),
           debug_state_machine_name("debug_state_machine"),
           debug_state_machine_vectors_name("debug_state_machine_vectors"),
           debug_llvmir_u64value_name("debug_llvmir_u64value"),
@@ -57,13 +67,23 @@ class MainLifter : public TraceLifter {
     std::string g_platform_name;
     std::string g_addr_list_name;
     std::string g_fun_ptr_table_name;
-    std::string g_block_address_ptrs_array_name;
-    std::string g_block_address_vmas_array_name;
-    std::string g_block_address_size_array_name;
-    std::string g_block_address_fn_vma_array_name;
-    std::string g_block_address_array_size_name;
     std::string g_fun_symbol_table_name;
     std::string g_addr_list_second_name;
+    std::string g_mem_region_guest_base_name;
+    std::string g_mem_region_size_name;
+    std::string g_mem_region_host_base_name;
+    std::string g_translate_vma_func_name;
+    std::string g_translate_vma_fast_func_name;
+    std::string g_get_lifted_func_name;
+    std::string g_prof_fn_counts_name;
+    std::string g_prof_block_num_name;
+    std::string g_prof_block_fn_vmas_name;
+    std::string g_prof_block_vmas_name;
+    std::string g_prof_block_counts_name;
+    std::string g_prof_branch_num_name;
+    std::string g_prof_branch_vmas_name;
+    std::string g_prof_branch_counts_name;
+    std::string g_prof_branch_taken_counts_name;
     std::string debug_state_machine_name;
     std::string debug_state_machine_vectors_name;
     std::string debug_llvmir_u64value_name;
@@ -73,6 +93,11 @@ class MainLifter : public TraceLifter {
     std::string debug_string_name;
     std::string debug_vma_and_registers_name;
 
+    /* move the guest stack slots to the allocas (--stack_slots) */
+    bool stack_slots = false;
+    /* pass X0-X7, V0-V7 and SP of the direct calls as the SSA values (--ssa_call_regs) */
+    bool ssa_call_regs = false;
+
     // Set RuntimeManager class to global context
     void SetRuntimeManagerClass();
 
@@ -95,13 +120,6 @@ class MainLifter : public TraceLifter {
     llvm::GlobalVariable *
     SetLiftedFunPtrTable(std::unordered_map<uint64_t, const char *> &addr_fun_map);
 
-    /* Set block address data */
-    llvm::GlobalVariable *
-    SetBlockAddressData(std::vector<llvm::Constant *> &block_address_ptrs_array,
-                        std::vector<llvm::Constant *> &block_address_vmas_array,
-                        std::vector<llvm::Constant *> &block_address_size_array,
-                        std::vector<llvm::Constant *> &block_address_fn_vma_array);
-
     /* Global variable array definition helper */
     llvm::GlobalVariable *GenGlobalArrayHelper(
         llvm::Type *elem_type, std::vector<llvm::Constant *> &constant_array,
@@ -111,6 +129,33 @@ class MainLifter : public TraceLifter {
     /* Declare global helper function called by lifted llvm bitcode */
     virtual void DeclareHelperFunction() override;
 
+    /* Replace every call of __remill_read_memory_* and __remill_write_memory_* with load/store */
+    /* (and __remill_atomic_*, __remill_barrier_* with atomicrmw, cmpxchg and fence) */
+    void InlineMemoryAccess();
+    /* Define the address translation (region fast path + out-of-line slow path) */
+    llvm::Function *DefineTranslateVMAFast();
+    /* Add the inline cache of the target function to every indirect call (BLR, BR) */
+    void AddIndirectCallCache();
+    /* Fold the NZCV read by B.cond, CSEL, ADC, ... into the operands of SUBS, ADDS and ANDS */
+    void FoldNZCVConditions();
+    /* Count the calls of every lifted function and the marked guest basic blocks */
+    void AddGuestProfileCounters(std::unordered_map<uint64_t, const char *> &addr_fn_map);
+    /* Make the definitions other than the lifted functions and the runtime data internal */
+    void InternalizeSemantics(std::unordered_map<uint64_t, const char *> &addr_fn_map);
+    /* Move the guest stack accesses of the non-escaping frame to the allocas */
+    void RecoverStackSlots(std::unordered_map<uint64_t, const char *> &addr_fn_map);
+    /* Move the lifted functions to the SSA argument and return registers (`F.ssa`) */
+    void PassRegsInSSA(std::unordered_map<uint64_t, const char *> &addr_fn_map);
+    /* Place the lifted functions in the descending order of the calls (--profile) */
+    void OrderFunctionsByProfile(std::unordered_map<uint64_t, const char *> &addr_fn_map);
+    /* Strip the definitions shared with the main module (--jobs) */
+    void PrepareShardModule();
+    /* Copy the shard module with only one lifted function (--lift_cache) */
+    std::unique_ptr<llvm::Module> ExtractLiftedFunction(llvm::Function *lifted_fn);
+    /* Move the lifted functions to the modules compiled in parallel (--shards) */
+    std::vector<std::unique_ptr<llvm::Module>>
+    SplitLiftedModule(std::unordered_map<uint64_t, const char *> &addr_fn_map, unsigned shard_num);
+
     /* instruction test helper */
     /* Prepare the virtual machine for instruction test (need override) */
     llvm::BasicBlock *PreVirtualMachineForInsnTest(uint64_t, TraceManager &,
@@ -144,13 +189,26 @@ class MainLifter : public TraceLifter {
   void SetELFPhdr(uint64_t e_phent, uint64_t e_phnum, uint8_t *e_ph);
   void SetPlatform(const char *platform_name);
   void SetLiftedFunPtrTable(std::unordered_map<uint64_t, const char *> &addr_fn_map);
-  void SetBlockAddressData(std::vector<llvm::Constant *> &block_address_ptrs_array,
-                           std::vector<llvm::Constant *> &block_address_vmas_array,
-                           std::vector<llvm::Constant *> &block_address_size_array,
-                           std::vector<llvm::Constant *> &block_address_fn_vma_array);
   virtual void DeclareHelperFunction();
 
   void Optimize();
+  void InlineMemoryAccess();
+  void AddIndirectCallCache();
+  void FoldNZCVConditions();
+  void EnableProfileBlock();
+  void EnableProfileBranch();
+  void SetProfile(const LiftProfile *profile);
+  void SetStats(LiftStats *stats);
+  void AddGuestProfileCounters(std::unordered_map<uint64_t, const char *> &addr_fn_map);
+  void OrderFunctionsByProfile(std::unordered_map<uint64_t, const char *> &addr_fn_map);
+  void EnableStackSlots();
+  void EnableSSACallRegs();
+  void OptimizeLiftedModule(std::unordered_map<uint64_t, const char *> &addr_fn_map,
+                            unsigned opt_level);
+  void PrepareShardModule();
+  std::unique_ptr<llvm::Module> ExtractLiftedFunction(llvm::Function *lifted_fn);
+  std::vector<std::unique_ptr<llvm::Module>>
+  SplitLiftedModule(std::unordered_map<uint64_t, const char *> &addr_fn_map, unsigned shard_num);
   /* debug */
   void DeclareDebugFunction();
   void SetFuncSymbolNameTable(std::unordered_map<uint64_t, const char *> &addr_fn_map);
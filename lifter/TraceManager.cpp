@@ -2,6 +2,8 @@
 
 #include "Lift.h"
 
+#include <functional>
+#include <set>
 #include <utils/Util.h>
 
 void AArch64TraceManager::SetLiftedTraceDefinition(uint64_t addr, llvm::Function *lifted_func) {
@@ -21,20 +23,34 @@ llvm::Function *AArch64TraceManager::GetLiftedTraceDefinition(uint64_t addr) {
   return GetLiftedTraceDeclaration(addr);
 }
 
+const CodeSpan *AArch64TraceManager::FindCodeSpan(uint64_t addr) {
+  auto span_it =
+      std::upper_bound(code_spans.begin(), code_spans.end(), addr,
+                       [](uint64_t key, const CodeSpan &span) { return key < span.vma; });
+  if (span_it == code_spans.begin() || addr >= (--span_it)->vma_end)
+    return nullptr;
+  return &*span_it;
+}
+
 bool AArch64TraceManager::TryReadExecutableByte(uint64_t addr, uint8_t *byte) {
+  auto span = FindCodeSpan(addr);
+  if (!span)
+    return false;
+  *byte = span->bytes[addr - span->vma];
+  return true;
+}
 
-  auto byte_it = memory.find(addr);
-  if (byte_it != memory.end()) {
-    *byte = byte_it->second;
-    return true;
-  } else {
+bool AArch64TraceManager::TryReadExecutableBytes(uint64_t addr, uint8_t *bytes, size_t size) {
+  auto span = FindCodeSpan(addr);
+  if (!span || span->vma_end - addr < size)
     return false;
-  }
+  memcpy(bytes, span->bytes + (addr - span->vma), size);
+  return true;
 }
 
 std::string AArch64TraceManager::GetLiftedFuncName(uint64_t addr) {
   if (disasm_funcs.count(addr) == 1)
-    return disasm_funcs[addr].func_name;
+    return disasm_funcs.at(addr).func_name;
   else
     elfconv_runtime_error("[ERROR] addr (0x%lx) doesn't indicate the entry of function.\n", addr);
 }
@@ -52,7 +68,7 @@ std::string AArch64TraceManager::GetUniqueLiftedFuncName(std::string func_name,
 bool AArch64TraceManager::isWithinFunction(uint64_t trace_addr, uint64_t target_addr) {
   if (disasm_funcs.count(trace_addr) == 1) {
     if (trace_addr <= target_addr &&
-        target_addr < trace_addr + disasm_funcs[trace_addr].func_size) {
+        target_addr < trace_addr + disasm_funcs.at(trace_addr).func_size) {
       return true;
     } else {
       return false;
@@ -66,12 +82,217 @@ bool AArch64TraceManager::isWithinFunction(uint64_t trace_addr, uint64_t target_
 
 uint64_t AArch64TraceManager::GetFuncVMA_E(uint64_t vma_s) {
   if (disasm_funcs.count(vma_s) == 1) {
-    return vma_s + disasm_funcs[vma_s].func_size;
+    return vma_s + disasm_funcs.at(vma_s).func_size;
   } else {
     elfconv_runtime_error("[ERROR] vma_s (%ld) is not a start address of function.\n", vma_s);
   }
 }
 
+/* the number of the instructions searched backward from BR for the jump table */
+#define JUMP_TABLE_SEARCH_INSN_NUM 32
+/* upper limit of the entry number of the jump table */
+#define JUMP_TABLE_MAX_ENTRY_NUM 4096
+
+static int64_t SignExtend(uint64_t val, uint32_t bits) {
+  return (int64_t) (val << (64 - bits)) >> (64 - bits);
+}
+
+/* apply the extend option (uxtb, ..., sxtx) of the register operand */
+static uint64_t ExtendReg(uint64_t val, uint32_t option) {
+  auto bits = 8u << (option & 3);
+  if (bits == 64)
+    return val;
+  return option & 4 ? SignExtend(val, bits) : val & ((1ULL << bits) - 1);
+}
+
+/* the instruction may write the register `reg` (branches and `cmp` never do) */
+static bool MayWriteReg(uint32_t insn, uint32_t reg) {
+  /* branch, exception and system instructions except mrs */
+  if (((insn >> 26) & 0b111) == 0b101 && (insn & 0xfff00000) != 0xd5300000)
+    return false;
+  /* ldp writes Rt2 too */
+  if ((insn & 0x3a400000) == 0x28400000 && ((insn >> 10) & 0x1f) == reg)
+    return true;
+  return (insn & 0x1f) == reg;
+}
+
+bool AArch64TraceManager::TryReadDataBytes(uint64_t addr, uint8_t *bytes, size_t size) {
+  for (auto &section : elf_obj.sections) {
+    if (section.vma <= addr && addr + size <= section.vma + section.size) {
+      memcpy(bytes, section.bytes + (addr - section.vma), size);
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+  Recover the targets of BR from the jump table idioms of gcc and clang, e.g.
+    cmp   w0, #N
+    b.hi  .Ldefault
+    adrp  x1, .Ltable
+    add   x1, x1, :lo12:.Ltable
+    ldrb  w1, [x1, w0, uxtw]    (ldrh, ldr, ldrsw ...)
+    adr   x2, .Lbase            (or the table address itself)
+    add   x1, x2, w1, sxtb #2   (or add x1, x2, x1, lsl #2)
+    br    x1
+  Every target is checked to be within the function, and the case of the switch maps the target
+  address to the block of the address, so the result is correct even if we misread the idiom.
+*/
+bool AArch64TraceManager::TryGetIndirectJumpTargets(uint64_t trace_addr, uint64_t br_addr,
+                                                    std::vector<uint64_t> &targets) {
+  auto lowest_vma = br_addr - trace_addr > JUMP_TABLE_SEARCH_INSN_NUM * AARCH64_OP_SIZE
+                        ? br_addr - JUMP_TABLE_SEARCH_INSN_NUM * AARCH64_OP_SIZE
+                        : trace_addr;
+  auto read_insn = [this](uint64_t vma, uint32_t &insn) {
+    return TryReadExecutableBytes(vma, reinterpret_cast<uint8_t *>(&insn), sizeof(insn));
+  };
+  /* find the latest instruction which writes `reg` before `vma` */
+  auto find_def = [&](uint64_t vma, uint32_t reg, uint64_t &def_vma, uint32_t &def_insn) {
+    for (def_vma = vma; def_vma > lowest_vma;) {
+      def_vma -= AARCH64_OP_SIZE;
+      if (!read_insn(def_vma, def_insn))
+        return false;
+      if (MayWriteReg(def_insn, reg))
+        return true;
+    }
+    return false;
+  };
+  /* the address calculated by adr or adrp (+ add) */
+  std::function<bool(uint64_t, uint32_t, uint64_t &)> resolve_addr =
+      [&](uint64_t vma, uint32_t reg, uint64_t &addr) {
+        uint64_t def_vma;
+        uint32_t insn;
+        if (!find_def(vma, reg, def_vma, insn))
+          return false;
+        auto adr_imm = ((insn >> 3) & 0x1ffffc) | ((insn >> 29) & 0b11);
+        if ((insn & 0x9f000000) == 0x10000000) { /* adr */
+          addr = def_vma + SignExtend(adr_imm, 21);
+          return true;
+        } else if ((insn & 0x9f000000) == 0x90000000) { /* adrp */
+          addr = (def_vma & ~0xfffULL) + (SignExtend(adr_imm, 21) << 12);
+          return true;
+        } else if ((insn & 0xff800000) == 0x91000000) { /* add (immediate, 64-bit) */
+          auto imm = ((insn >> 10) & 0xfff) << ((insn >> 22) & 1 ? 12 : 0);
+          if (!resolve_addr(def_vma, (insn >> 5) & 0x1f, addr))
+            return false;
+          addr += imm;
+          return true;
+        }
+        return false;
+      };
+
+  uint32_t br_insn;
+  if (!read_insn(br_addr, br_insn) || (br_insn & 0xfffffc1f) != 0xd61f0000)
+    return false;
+
+  /* target = base + extend(entry) << shift */
+  uint64_t add_vma;
+  uint32_t add_insn;
+  if (!find_def(br_addr, (br_insn >> 5) & 0x1f, add_vma, add_insn))
+    return false;
+  uint32_t entry_option, entry_shift;
+  if ((add_insn & 0xffe00000) == 0x8b200000) { /* add (extended register, 64-bit) */
+    entry_option = (add_insn >> 13) & 0b111;
+    entry_shift = (add_insn >> 10) & 0b111;
+  } else if ((add_insn & 0xffe00000) == 0x8b000000) { /* add (shifted register, lsl, 64-bit) */
+    entry_option = 0b011;
+    entry_shift = (add_insn >> 10) & 0x3f;
+  } else {
+    return false;
+  }
+  auto base_reg = (add_insn >> 5) & 0x1f;
+  auto entry_reg = (add_insn >> 16) & 0x1f;
+
+  /* entry = load [table, index(, lsl #log2(size))] */
+  uint64_t ld_vma;
+  uint32_t ld_insn;
+  if (!find_def(add_vma, entry_reg, ld_vma, ld_insn) || (ld_insn & 0x3f200c00) != 0x38200800)
+    return false;
+  auto entry_size = 1u << (ld_insn >> 30);
+  auto ld_opc = (ld_insn >> 22) & 0b11;
+  auto scaled = (ld_insn >> 12) & 1;
+  if (ld_opc == 0b00 || entry_size == 8 || (entry_size > 1 && !scaled) ||
+      (entry_size == 4 && ld_opc == 0b11))
+    return false;
+  auto table_reg = (ld_insn >> 5) & 0x1f;
+  auto index_reg = (ld_insn >> 16) & 0x1f;
+
+  uint64_t table_addr, base_addr;
+  if (!resolve_addr(ld_vma, table_reg, table_addr) || !resolve_addr(add_vma, base_reg, base_addr))
+    return false;
+
+  /* the number of the entries is bounded by `cmp index, #imm` and the conditional branch, which is
+     `b.hi (b.hs) default` just before the table code or `b.ls (b.lo) table code` */
+  auto cmp_imm = [index_reg](uint32_t insn, uint64_t &imm) {
+    if ((insn & 0x7f80001f) != 0x7100001f || ((insn >> 5) & 0x1f) != index_reg)
+      return false;
+    imm = ((insn >> 10) & 0xfff) << ((insn >> 22) & 1 ? 12 : 0);
+    return true;
+  };
+  uint64_t entry_num = 0, imm;
+  uint64_t table_code_vma = 0;
+  int bound_cond = -1;
+  for (auto vma = ld_vma; vma > lowest_vma;) {
+    vma -= AARCH64_OP_SIZE;
+    uint32_t insn;
+    if (!read_insn(vma, insn))
+      return false;
+    if ((insn & 0xff000010) == 0x54000000) { /* b.cond */
+      bound_cond = insn & 0xf;
+    } else if (cmp_imm(insn, imm)) {
+      if (bound_cond == 0b1000) /* hi */
+        entry_num = imm + 1;
+      else if (bound_cond == 0b0010) /* hs */
+        entry_num = imm;
+      break;
+    } else if ((insn & 0xfc000000) == 0x14000000 || (insn & 0xfffffc1f) == 0xd65f0000) {
+      /* b or ret: the table code is reached by the conditional branch */
+      table_code_vma = vma + AARCH64_OP_SIZE;
+      break;
+    } else if (MayWriteReg(insn, index_reg)) {
+      return false;
+    }
+  }
+  for (auto vma = lowest_vma + AARCH64_OP_SIZE; table_code_vma && vma < table_code_vma;
+       vma += AARCH64_OP_SIZE) {
+    uint32_t insn, prev_insn;
+    if (!read_insn(vma, insn) || !read_insn(vma - AARCH64_OP_SIZE, prev_insn))
+      return false;
+    if ((insn & 0xff000010) != 0x54000000 ||
+        vma + SignExtend(((insn >> 5) & 0x7ffff) << 2, 21) != table_code_vma ||
+        !cmp_imm(prev_insn, imm))
+      continue;
+    if ((insn & 0xf) == 0b1001) /* ls */
+      entry_num = imm + 1;
+    else if ((insn & 0xf) == 0b0011) /* lo */
+      entry_num = imm;
+    break;
+  }
+  if (entry_num == 0 || entry_num > JUMP_TABLE_MAX_ENTRY_NUM)
+    return false;
+
+  auto func_end = GetFuncVMA_E(trace_addr);
+  std::set<uint64_t> target_set;
+  for (uint64_t i = 0; i < entry_num; i++) {
+    uint64_t entry = 0;
+    if (!TryReadDataBytes(table_addr + i * entry_size, reinterpret_cast<uint8_t *>(&entry),
+                          entry_size))
+      return false;
+    /* ldrs* (64-bit) or ldrs* (32-bit) */
+    if (ld_opc == 0b10)
+      entry = SignExtend(entry, entry_size * 8);
+    else if (ld_opc == 0b11)
+      entry = SignExtend(entry, entry_size * 8) & 0xffffffff;
+    auto target = base_addr + (ExtendReg(entry, entry_option) << entry_shift);
+    if (target < trace_addr || func_end <= target || target % AARCH64_OP_SIZE != 0)
+      return false;
+    target_set.insert(target);
+  }
+  targets.assign(target_set.begin(), target_set.end());
+  return true;
+}
+
 void AArch64TraceManager::SetELFData() {
 
   elf_obj.LoadELF();
@@ -111,7 +332,8 @@ void AArch64TraceManager::SetELFData() {
       elfconv_runtime_error("[ERROR] \"%s\" is not included in any section.\n",
                             func_entrys[i].func_name.c_str());
     }
-    while (sec_addr < fun_end_addr) {
+    auto sec_end_addr = fun_end_addr;
+    while (sec_addr < fun_end_addr && i < func_entrys.size()) {
       /* assign every insn to the manager */
       auto lifted_func_name =
           GetUniqueLiftedFuncName(func_entrys[i].func_name, func_entrys[i].entry);
@@ -123,15 +345,15 @@ void AArch64TraceManager::SetELFData() {
           elfconv_runtime_error("[ERROR] multiple entrypoints are found.\n");
         entry_func_lifted_name = lifted_func_name;
       }
-      for (uintptr_t addr = func_entrys[i].entry; addr < fun_end_addr; addr++) {
-        memory[addr] = bytes[addr - sec_addr];
-      }
       disasm_funcs.emplace(func_entrys[i].entry, DisasmFunc(lifted_func_name, func_entrys[i].entry,
                                                             fun_end_addr - func_entrys[i].entry));
       /* next loop */
       fun_end_addr = func_entrys[i].entry;
       i++;
     }
+    /* the instructions from the lowest function entry to the section end */
+    auto code_start = std::max(fun_end_addr, sec_addr);
+    code_spans.emplace_back(code_start, sec_end_addr, bytes + (code_start - sec_addr));
   }
   /* set instructions of every block of .plt section (FIXME) */
   auto plt_section = elf_obj.code_sections[".plt"];
@@ -142,10 +364,6 @@ void AArch64TraceManager::SetELFData() {
     while (ins_i < plt_section.size) {
       auto b_entry = plt_section.vma + ins_i;
       for (; ins_i < plt_section.size;) {
-        memory[plt_section.vma + ins_i] = plt_section.bytes[ins_i];
-        memory[plt_section.vma + ins_i + 1] = plt_section.bytes[ins_i + 1];
-        memory[plt_section.vma + ins_i + 2] = plt_section.bytes[ins_i + 2];
-        memory[plt_section.vma + ins_i + 3] = plt_section.bytes[ins_i + 3];
         uint8_t *bts = plt_section.bytes + ins_i;
         ins_i += AARCH64_OP_SIZE;
         if ((bts[0] & 0x1f) == 0x00 && (bts[1] & 0xfc) == 0x00 && bts[2] == 0x1f &&
@@ -158,7 +376,12 @@ void AArch64TraceManager::SetELFData() {
       disasm_funcs.emplace(b_entry,
                            DisasmFunc(fn_name.str(), b_entry, (plt_section.vma + ins_i) - b_entry));
     }
+    code_spans.emplace_back(plt_section.vma,
+                            plt_section.vma + std::min(ins_i, plt_section.size),
+                            plt_section.bytes);
   }
+  std::sort(code_spans.begin(), code_spans.end(),
+            [](const CodeSpan &lhs, const CodeSpan &rhs) { return lhs.vma < rhs.vma; });
   /* 
     define __wrap_main function (FIXME)
     __libc_start_call_main BLR jump to the instructions as following in _start.
@@ -187,4 +410,209 @@ void AArch64TraceManager::SetELFData() {
   } else {
     elfconv_runtime_error("[ERROR] Entry function is not defined.\n");
   }
-}
\ No newline at end of file
+  /*
+    define the entry of the child thread of clone.
+    the runtime starts the child at the next instruction of `svc` on the other host thread.
+    `mov x8, #220` (clone)
+    `svc #0`
+  */
+  std::vector<std::pair<uint64_t, uint64_t>> clone_child_spans;
+  for (auto &[fn_vma, disasm_fn] : disasm_funcs) {
+    auto fn_vma_e = fn_vma + disasm_fn.func_size;
+    for (uint64_t pc = fn_vma; pc + AARCH64_OP_SIZE * 2 < fn_vma_e; pc += AARCH64_OP_SIZE) {
+      uint32_t insns[2];
+      if (TryReadExecutableBytes(pc, reinterpret_cast<uint8_t *>(insns), sizeof(insns)) &&
+          insns[0] == 0xd2801b88 && insns[1] == 0xd4000001) {
+        clone_svc_vmas.insert(pc + AARCH64_OP_SIZE);
+        clone_child_spans.emplace_back(pc + AARCH64_OP_SIZE * 2, fn_vma_e);
+      }
+    }
+  }
+  for (auto [child_vma, fn_vma_e] : clone_child_spans) {
+    std::stringstream fn_name;
+    fn_name << "fn_clone_child_" << std::hex << child_vma;
+    disasm_funcs.emplace(child_vma, DisasmFunc(fn_name.str(), child_vma, fn_vma_e - child_vma));
+  }
+}
+/*
+  Remove the functions which are not reachable from the entry point (--reachable_only).
+  The roots are the entry point, `__wrap_main`, the child entries of clone and every function
+  whose address is stored in the data sections (.init_array, .got, .rela.iplt, vtables, ...).
+  From every reachable function, the targets of the direct branches (b, bl, b.cond, cbz, tbz)
+  and the code addresses made by adr, adrp + add and ldr (literal) are also reachable. The pruned
+  functions are not included in the lifted function pointer table, so an indirect call to them
+  stops at the runtime error.
+*/
+void AArch64TraceManager::PruneUnreachableFuncs() {
+  std::map<uintptr_t, uint64_t> fn_vma_ends;
+  for (auto &[vma, disasm_fn] : disasm_funcs)
+    fn_vma_ends[vma] = vma + disasm_fn.func_size;
+
+  std::unordered_set<uintptr_t> reachable;
+  std::vector<uintptr_t> worklist;
+  auto add_fn = [&](uintptr_t vma) {
+    if (reachable.insert(vma).second)
+      worklist.push_back(vma);
+  };
+  /* add the function which includes `addr` (`__wrap_main` is included in `_start`) */
+  auto add_code_addr = [&](uint64_t addr) {
+    auto fn_it = fn_vma_ends.upper_bound(addr);
+    for (int i = 0; i < 2 && fn_it != fn_vma_ends.begin(); i++) {
+      fn_it--;
+      if (addr < fn_it->second) {
+        add_fn(fn_it->first);
+        return;
+      }
+    }
+  };
+
+  add_fn(entry_point);
+  for (auto &[vma, disasm_fn] : disasm_funcs)
+    if (disasm_fn.func_name == "__wrap_main" ||
+        disasm_fn.func_name.starts_with("fn_clone_child_"))
+      add_fn(vma);
+  if (_io_file_xsputn_vma != 0)
+    add_fn(_io_file_xsputn_vma);
+  /* the function addresses in the data sections */
+  for (auto &section : elf_obj.sections) {
+    if (section.sec_type == BinaryLoader::ELFSection::SEC_TYPE_CODE || !section.bytes)
+      continue;
+    for (uint64_t off = (8 - (section.vma & 7)) & 7; off + 8 <= section.size; off += 8) {
+      uint64_t val;
+      memcpy(&val, section.bytes + off, 8);
+      if (disasm_funcs.count(val) == 1)
+        add_fn(val);
+    }
+  }
+
+  while (!worklist.empty()) {
+    auto fn_vma = worklist.back();
+    worklist.pop_back();
+    auto fn_vma_e = fn_vma_ends[fn_vma];
+    /* page address set by adrp (valid until the register is overwritten) */
+    uint64_t adrp_pages[32];
+    uint32_t adrp_valid = 0;
+    for (uint64_t pc = fn_vma; pc + AARCH64_OP_SIZE <= fn_vma_e; pc += AARCH64_OP_SIZE) {
+      uint32_t insn;
+      if (!TryReadExecutableBytes(pc, reinterpret_cast<uint8_t *>(&insn), AARCH64_OP_SIZE))
+        break;
+      auto rd = insn & 0x1f;
+      auto rn = (insn >> 5) & 0x1f;
+      if ((insn & 0x7c000000) == 0x14000000) {
+        /* b, bl */
+        add_code_addr(pc + SignExtend((insn & 0x3ffffff) << 2, 28));
+      } else if ((insn & 0xff000010) == 0x54000000 || (insn & 0x7e000000) == 0x34000000) {
+        /* b.cond, cbz, cbnz */
+        add_code_addr(pc + SignExtend(((insn >> 5) & 0x7ffff) << 2, 21));
+      } else if ((insn & 0x7e000000) == 0x36000000) {
+        /* tbz, tbnz */
+        add_code_addr(pc + SignExtend(((insn >> 5) & 0x3fff) << 2, 16));
+      } else if ((insn & 0x1f000000) == 0x10000000) {
+        /* adr, adrp */
+        uint64_t imm = (((insn >> 5) & 0x7ffff) << 2) | ((insn >> 29) & 3);
+        if (insn & 0x80000000) {
+          adrp_pages[rd] = (pc & ~0xfffULL) + (SignExtend(imm, 21) << 12);
+          adrp_valid |= 1U << rd;
+          continue;
+        }
+        add_code_addr(pc + SignExtend(imm, 21));
+      } else if ((insn & 0xff800000) == 0x91000000 && (adrp_valid >> rn) & 1) {
+        /* add (immediate, 64-bit) to the adrp page */
+        uint64_t imm12 = (insn >> 10) & 0xfff;
+        add_code_addr(adrp_pages[rn] + (insn & 0x400000 ? imm12 << 12 : imm12));
+      } else if ((insn & 0xff000000) == 0x58000000) {
+        /* ldr (literal, 64-bit) */
+        uint64_t val;
+        if (TryReadDataBytes(pc + SignExtend(((insn >> 5) & 0x7ffff) << 2, 21),
+                             reinterpret_cast<uint8_t *>(&val), 8))
+          add_code_addr(val);
+      }
+      if (MayWriteReg(insn, rd))
+        adrp_valid &= ~(1U << rd);
+    }
+  }
+
+  auto fn_num = disasm_funcs.size();
+  std::erase_if(disasm_funcs, [&](auto &vma_fn) { return !reachable.contains(vma_fn.first); });
+  printf("[INFO] %zu of %zu functions are reachable.\n", disasm_funcs.size(), fn_num);
+}
+
+/*
+  Hash every input which the lifted function of `fn_vma` depends on (--lift_cache).
+  i.e. the name, range and bytes of the function, the names of the functions which it branches
+  to, the functions reached by the tail calls (b) because the optimization uses their registers
+  (and the same inputs of them), and the recovered targets of BR.
+*/
+void AArch64TraceManager::HashLiftInput(uint64_t fn_vma, llvm::SHA1 &hasher) {
+  auto hash_u64 = [&](uint64_t val) {
+    hasher.update(llvm::ArrayRef<uint8_t>(reinterpret_cast<uint8_t *>(&val), sizeof(val)));
+  };
+  auto hash_fn = [&](uint64_t vma) {
+    auto &disasm_fn = disasm_funcs.at(vma);
+    hasher.update(disasm_fn.func_name);
+    hash_u64(vma);
+    hash_u64(disasm_fn.func_size);
+  };
+
+  hash_fn(fn_vma);
+  /* the function entries in the function (e.g. `__wrap_main` in `_start`) */
+  for (auto &[vma, disasm_fn] : disasm_funcs)
+    if (fn_vma < vma && isWithinFunction(fn_vma, vma))
+      hash_fn(vma);
+
+  std::vector<uint64_t> tail_callees = {fn_vma};
+  std::set<uint64_t> hashed = {fn_vma};
+  for (size_t callee_i = 0; callee_i < tail_callees.size(); callee_i++) {
+    auto vma = tail_callees[callee_i];
+    auto vma_e = GetFuncVMA_E(vma);
+    if (callee_i > 0)
+      hash_fn(vma);
+    for (uint64_t pc = vma; pc + AARCH64_OP_SIZE <= vma_e; pc += AARCH64_OP_SIZE) {
+      uint32_t insn = 0;
+      TryReadExecutableBytes(pc, reinterpret_cast<uint8_t *>(&insn), AARCH64_OP_SIZE);
+      hash_u64(insn);
+      uint64_t target = 0;
+      if ((insn & 0x7c000000) == 0x14000000) {
+        /* b, bl */
+        target = pc + SignExtend((insn & 0x3ffffff) << 2, 28);
+        if (!(insn & 0x80000000) && isFunctionEntry(target) && !hashed.contains(target)) {
+          tail_callees.push_back(target);
+          hashed.insert(target);
+        }
+      } else if ((insn & 0xff000010) == 0x54000000 || (insn & 0x7e000000) == 0x34000000) {
+        /* b.cond, cbz, cbnz */
+        target = pc + SignExtend(((insn >> 5) & 0x7ffff) << 2, 21);
+      } else if ((insn & 0x7e000000) == 0x36000000) {
+        /* tbz, tbnz */
+        target = pc + SignExtend(((insn >> 5) & 0x3fff) << 2, 16);
+      } else if ((insn & 0xfffffc1f) == 0xd61f0000) {
+        /* br */
+        std::vector<uint64_t> br_targets;
+        if (TryGetIndirectJumpTargets(vma, pc, br_targets))
+          for (auto br_target : br_targets)
+            hash_u64(br_target);
+        continue;
+      } else {
+        continue;
+      }
+      if (!isWithinFunction(vma, target) && isFunctionEntry(target))
+        hasher.update(disasm_funcs.at(target).func_name);
+    }
+  }
+}
+
+/*
+  ShardTraceManager
+*/
+llvm::Function *ShardTraceManager::GetLiftedTraceDeclaration(uint64_t addr) {
+  auto trace_it = traces.find(addr);
+  if (trace_it != traces.end()) {
+    return trace_it->second;
+  } else {
+    return nullptr;
+  }
+}
+
+llvm::Function *ShardTraceManager::GetLiftedTraceDefinition(uint64_t addr) {
+  return GetLiftedTraceDeclaration(addr);
+}
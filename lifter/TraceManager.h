@@ -12,6 +12,7 @@
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Type.h>
+#include <llvm/Support/SHA1.h>
 #include <map>
 #include <memory>
 #include <remill/Arch/AArch64/Runtime/State.h>
@@ -26,6 +27,7 @@
 #include <remill/OS/OS.h>
 #include <sstream>
 #include <string>
+#include <unordered_set>
 
 class DisasmFunc {
  public:
@@ -40,6 +42,19 @@ class DisasmFunc {
   uint64_t func_size;
 };
 
+/* executable bytes [vma, vma_end) which point to the loaded section bytes */
+class CodeSpan {
+ public:
+  CodeSpan(uintptr_t __vma, uintptr_t __vma_end, const uint8_t *__bytes)
+      : vma(__vma),
+        vma_end(__vma_end),
+        bytes(__bytes) {}
+
+  uintptr_t vma;
+  uintptr_t vma_end;
+  const uint8_t *bytes;
+};
+
 class AArch64TraceManager : public remill::TraceManager {
  public:
   virtual ~AArch64TraceManager(void) = default;
@@ -51,22 +66,88 @@ class AArch64TraceManager : public remill::TraceManager {
   llvm::Function *GetLiftedTraceDeclaration(uint64_t addr);
   llvm::Function *GetLiftedTraceDefinition(uint64_t addr);
   bool TryReadExecutableByte(uint64_t addr, uint8_t *byte);
+  bool TryReadExecutableBytes(uint64_t addr, uint8_t *bytes, size_t size) override;
   std::string GetLiftedFuncName(uint64_t addr);
   std::string GetUniqueLiftedFuncName(std::string func_name, uint64_t vma_s);
   bool isFunctionEntry(uint64_t addr);
   bool isWithinFunction(uint64_t trace_addr, uint64_t inst_addr);
   uint64_t GetFuncVMA_E(uint64_t vma_s);
+  bool TryGetIndirectJumpTargets(uint64_t trace_addr, uint64_t br_addr,
+                                 std::vector<uint64_t> &targets) override;
+  bool isCloneSyscall(uint64_t svc_addr) override {
+    return clone_svc_vmas.contains(svc_addr);
+  }
 
   void SetELFData();
+  void PruneUnreachableFuncs();
+  void HashLiftInput(uint64_t fn_vma, llvm::SHA1 &hasher);
 
   BinaryLoader::ELFObject elf_obj;
-  std::unordered_map<uintptr_t, uint8_t> memory;
+  /* sorted by vma and never overlapped */
+  std::vector<CodeSpan> code_spans;
   std::unordered_map<uintptr_t, llvm::Function *> traces;
   std::unordered_map<uintptr_t, DisasmFunc> disasm_funcs;
+  /* `svc` of `mov x8, #220; svc #0` (clone) */
+  std::unordered_set<uint64_t> clone_svc_vmas;
   std::string entry_func_lifted_name;
   std::string panic_plt_jmp_fun_name;
   uintptr_t entry_point;
 
  private:
+  const CodeSpan *FindCodeSpan(uint64_t addr);
+  bool TryReadDataBytes(uint64_t addr, uint8_t *bytes, size_t size);
+
   uint64_t unique_i64;
 };
+
+/*
+  TraceManager of the one lifting worker (--jobs).
+  The ELF data is shared with the main manager (read only), and the lifted functions and
+  block address data are owned by the worker.
+*/
+class ShardTraceManager : public remill::TraceManager {
+ public:
+  virtual ~ShardTraceManager(void) = default;
+  ShardTraceManager(AArch64TraceManager &__main_manager) : main_manager(__main_manager) {
+    _io_file_xsputn_vma = main_manager._io_file_xsputn_vma;
+  }
+
+  void SetLiftedTraceDefinition(uint64_t addr, llvm::Function *lifted_func) override {
+    traces[addr] = lifted_func;
+  }
+  llvm::Function *GetLiftedTraceDeclaration(uint64_t addr) override;
+  llvm::Function *GetLiftedTraceDefinition(uint64_t addr) override;
+  bool TryReadExecutableByte(uint64_t addr, uint8_t *byte) override {
+    return main_manager.TryReadExecutableByte(addr, byte);
+  }
+  bool TryReadExecutableBytes(uint64_t addr, uint8_t *bytes, size_t size) override {
+    return main_manager.TryReadExecutableBytes(addr, bytes, size);
+  }
+  std::string GetLiftedFuncName(uint64_t addr) override {
+    return main_manager.GetLiftedFuncName(addr);
+  }
+  bool isFunctionEntry(uint64_t addr) override {
+    return main_manager.isFunctionEntry(addr);
+  }
+  bool isWithinFunction(uint64_t trace_addr, uint64_t inst_addr) override {
+    return main_manager.isWithinFunction(trace_addr, inst_addr);
+  }
+  uint64_t GetFuncVMA_E(uint64_t vma_s) override {
+    return main_manager.GetFuncVMA_E(vma_s);
+  }
+  bool TryGetIndirectJumpTargets(uint64_t trace_addr, uint64_t br_addr,
+                                 std::vector<uint64_t> &targets) override {
+    return main_manager.TryGetIndirectJumpTargets(trace_addr, br_addr, targets);
+  }
+  bool isCloneSyscall(uint64_t svc_addr) override {
+    return main_manager.isCloneSyscall(svc_addr);
+  }
+  bool isLiftTarget(uint64_t addr) override {
+    return lift_targets.contains(addr);
+  }
+
+  AArch64TraceManager &main_manager;
+  std::unordered_map<uintptr_t, llvm::Function *> traces;
+  /* entry addresses of the functions lifted by this worker */
+  std::unordered_set<uintptr_t> lift_targets;
+};
@@ -1,6 +1,7 @@
 #include "Runtime.h"
 
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <map>
@@ -13,27 +14,46 @@
 #  include <remill/Arch/X86/Runtime/State.h>
 #endif
 
-State CPUState = State();
+thread_local State CPUState = State();
 
 int main(int argc, char *argv[]) {
 
   std::vector<MappedMemory *> mapped_memorys;
 
+#if defined(ELFC_RUNTIME_FLAT_MEMORY)
+  /* reserve the flat memory and copy every section onto it */
+  auto flat_memory = FlatMemory::Reserve();
+  /* allocate Stack */
+  auto mapped_stack = MappedMemory::VMAStackEntryInit(
+      argc, argv, CPUState, flat_memory.stack_vma,
+      flat_memory.host_base + (flat_memory.stack_vma - flat_memory.guest_base));
+  /* allocate Heap */
+  auto mapped_heap = MappedMemory::VMAHeapEntryInit(
+      flat_memory.heap_vma,
+      flat_memory.host_base + (flat_memory.heap_vma - flat_memory.guest_base));
+#else
   /* allocate Stack */
   auto mapped_stack = MappedMemory::VMAStackEntryInit(argc, argv, CPUState);
   /* allocate Heap */
   auto mapped_heap = MappedMemory::VMAHeapEntryInit();
+#endif
   /* allocate every sections */
   for (int i = 0; i < __g_data_sec_num; i++) {
     // remove covered section (FIXME)
     if (strncmp(reinterpret_cast<const char *>(__g_data_sec_name_ptr_array[i]), ".tbss", 5) == 0)
       continue;
+#if defined(ELFC_RUNTIME_FLAT_MEMORY)
+    auto sec_bytes =
+        flat_memory.host_base + (__g_data_sec_vma_array[i] - flat_memory.guest_base);
+#else
+    auto sec_bytes = __g_data_sec_bytes_ptr_array[i];
+#endif
     mapped_memorys.push_back(new MappedMemory(
         MemoryAreaType::DATA, reinterpret_cast<const char *>(__g_data_sec_name_ptr_array[i]),
         __g_data_sec_vma_array[i],
         __g_data_sec_vma_array[i] + static_cast<size_t>(__g_data_sec_size_array[i]),
-        static_cast<size_t>(__g_data_sec_size_array[i]), __g_data_sec_bytes_ptr_array[i],
-        __g_data_sec_bytes_ptr_array[i] + __g_data_sec_size_array[i], false));
+        static_cast<size_t>(__g_data_sec_size_array[i]), sec_bytes,
+        sec_bytes + __g_data_sec_size_array[i], false));
   }
 #if defined(ELF_IS_AARCH64)
   /* set program counter */
@@ -46,11 +66,23 @@ int main(int argc, char *argv[]) {
 #endif
   /* set RuntimeManager */
   auto runtime_manager = new RuntimeManager(mapped_memorys, mapped_stack, mapped_heap);
-  runtime_manager->heaps_end_addr = HEAPS_START_VMA + HEAP_UNIT_SIZE;
-  /* set lifted function pointer table */
-  for (int i = 0; __g_fn_vmas[i] && __g_fn_ptr_table[i]; i++) {
-    runtime_manager->addr_fn_map[__g_fn_vmas[i]] = __g_fn_ptr_table[i];
-  }
+  runtime_manager->heaps_end_addr = mapped_heap->vma_end;
+#if defined(ELFC_RUNTIME_FLAT_MEMORY)
+  runtime_manager->flat_host_base = flat_memory.host_base;
+  runtime_manager->flat_guest_base = flat_memory.guest_base;
+  /* every memory access of the lifted LLVM IR takes the fast path */
+  __g_mem_region_guest_base = flat_memory.guest_base;
+  __g_mem_region_size = flat_memory.guest_end - flat_memory.guest_base;
+  __g_mem_region_host_base = flat_memory.host_base;
+#else
+  /* stack accesses of the lifted LLVM IR take the fast path */
+  __g_mem_region_guest_base = mapped_stack->vma;
+  __g_mem_region_size = mapped_stack->len;
+  __g_mem_region_host_base = mapped_stack->bytes;
+#endif
+  /* count the lifted functions (__g_fn_vmas is terminated by 0) */
+  while (__g_fn_vmas[runtime_manager->fn_num])
+    runtime_manager->fn_num++;
 #if defined(LIFT_CALLSTACK_DEBUG)
   /* set lifted function symbol table (for debug) */
   for (int i = 0; __g_fn_vmas_second[i] && __g_fn_symbol_table[i]; i++) {
@@ -58,16 +90,9 @@ int main(int argc, char *argv[]) {
         (const char *) __g_fn_symbol_table[i];
   }
 #endif
-  /* set global block address data array */
-  for (int i = 0; i < __g_block_address_array_size; i++) {
-    auto bb_num = __g_block_address_size_array[i];
-    std::map<uint64_t, uint64_t *> vma_bb_map;
-    auto t_block_address_ptrs = __g_block_address_ptrs_array[i];
-    auto t_block_address_vmas = __g_block_address_vmas_array[i];
-    for (int j = 0; j < bb_num; j++)
-      vma_bb_map[t_block_address_vmas[j]] = t_block_address_ptrs[j];
-    runtime_manager->addr_block_addrs_map[__g_block_address_fn_vma_array[i]] = vma_bb_map;
-  }
+#if defined(ELFC_RUNTIME_PROFILE)
+  std::atexit(DumpGuestProfile);
+#endif
   /* go to the entry function (entry function is injected by lifted LLVM IR) */
   __g_entry_func(&CPUState, __g_entry_pc, runtime_manager);
 
@@ -1,7 +1,11 @@
 #include "Memory.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
+#if defined(ELFC_RUNTIME_FLAT_MEMORY) && !defined(TARGET_IS_WASI) && !defined(TARGET_IS_BROWSER)
+#  include <sys/mman.h>
+#endif
 #include <utils/Util.h>
 #include <utils/elfconv.h>
 
@@ -15,11 +19,13 @@
   MappedMemory
 */
 MappedMemory *MappedMemory::VMAStackEntryInit(int argc, char *argv[],
-                                              State &state /* start stack pointer */) {
+                                              State &state /* start stack pointer */, addr_t vma,
+                                              uint8_t *bytes) {
   _ecv_reg64_t sp;
-  addr_t vma = STACK_START_VMA;
   uint64_t len = STACK_SIZE;
-  auto bytes = reinterpret_cast<uint8_t *>(malloc(len));
+  bool bytes_on_heap = !bytes;
+  if (bytes_on_heap)
+    bytes = reinterpret_cast<uint8_t *>(malloc(len));
   memset(bytes, 0, len);
 
   /* Initialize the stack */
@@ -92,16 +98,17 @@ MappedMemory *MappedMemory::VMAStackEntryInit(int argc, char *argv[],
   memcpy(bytes + (sp - vma), &argc64, sizeof(_ecv_reg64_t));
   SPREG = sp;
   return new MappedMemory(MemoryAreaType::STACK, "Stack", vma, vma + len, len, bytes, bytes + len,
-                          true);
+                          bytes_on_heap);
 }
 
-MappedMemory *MappedMemory::VMAHeapEntryInit() {
-  auto bytes = reinterpret_cast<uint8_t *>(malloc(HEAP_UNIT_SIZE));
+MappedMemory *MappedMemory::VMAHeapEntryInit(addr_t vma, uint8_t *bytes) {
+  bool bytes_on_heap = !bytes;
+  if (bytes_on_heap)
+    bytes = reinterpret_cast<uint8_t *>(malloc(HEAP_UNIT_SIZE));
   auto upper_bytes = bytes + HEAP_UNIT_SIZE;
-  auto heap =
-      new MappedMemory(MemoryAreaType::HEAP, "Heap", HEAPS_START_VMA,
-                       HEAPS_START_VMA + HEAP_UNIT_SIZE, HEAP_UNIT_SIZE, bytes, upper_bytes, true);
-  heap->heap_cur = HEAPS_START_VMA;
+  auto heap = new MappedMemory(MemoryAreaType::HEAP, "Heap", vma, vma + HEAP_UNIT_SIZE,
+                               HEAP_UNIT_SIZE, bytes, upper_bytes, bytes_on_heap);
+  heap->heap_cur = vma;
   return heap;
 }
 
@@ -121,3 +128,87 @@ void MappedMemory::DebugEmulatedMemory() {
             << (addr_t) upper_bytes << ", bytes_on_heap" << (bytes_on_heap ? "true" : "false")
             << std::endl;
 }
+
+/*
+  PageTable
+*/
+MappedMemory **PageTable::GetL2Table(uint64_t chunk, bool create) {
+  auto it = std::lower_bound(l1_entries.begin(), l1_entries.end(), chunk,
+                             [](auto &entry, uint64_t key) { return entry.first < key; });
+  if (it != l1_entries.end() && it->first == chunk)
+    return it->second;
+  if (!create)
+    return nullptr;
+  auto l2_table = reinterpret_cast<MappedMemory **>(
+      calloc(1ULL << VMA_PAGE_L2_BITS, sizeof(MappedMemory *)));
+  if (!l2_table)
+    elfconv_runtime_error("[ERROR] failed to allocate the page table.\n");
+  l1_entries.insert(it, {chunk, l2_table});
+  return l2_table;
+}
+
+void PageTable::Map(MappedMemory *memory) {
+  if (memory->vma_end <= memory->vma)
+    return;
+  auto l2_mask = (1ULL << VMA_PAGE_L2_BITS) - 1;
+  for (auto vpn = memory->vma >> VMA_PAGE_SHIFT; vpn <= (memory->vma_end - 1) >> VMA_PAGE_SHIFT;
+       vpn++) {
+    auto &entry = GetL2Table(vpn >> VMA_PAGE_L2_BITS, true)[vpn & l2_mask];
+    entry = (!entry || entry == memory) ? memory : MIXED_PAGE;
+  }
+}
+
+MappedMemory *PageTable::Walk(addr_t vma) {
+  auto vpn = vma >> VMA_PAGE_SHIFT;
+  auto l2_table = GetL2Table(vpn >> VMA_PAGE_L2_BITS, false);
+  return l2_table ? l2_table[vpn & ((1ULL << VMA_PAGE_L2_BITS) - 1)] : nullptr;
+}
+
+#if defined(ELFC_RUNTIME_FLAT_MEMORY)
+/*
+  FlatMemory
+*/
+FlatMemory FlatMemory::Reserve() {
+  FlatMemory flat;
+  addr_t data_start = UINT64_MAX, data_end = 0;
+  for (int i = 0; i < __g_data_sec_num; i++) {
+    if (strncmp(reinterpret_cast<const char *>(__g_data_sec_name_ptr_array[i]), ".tbss", 5) == 0)
+      continue;
+    data_start = std::min(data_start, __g_data_sec_vma_array[i]);
+    data_end = std::max(data_end, __g_data_sec_vma_array[i] + __g_data_sec_size_array[i]);
+  }
+  if (data_end == 0)
+    data_start = data_end = 0;
+  flat.guest_base = data_start & ~(FLAT_AREA_ALIGN - 1);
+  flat.heap_vma = (data_end + FLAT_AREA_ALIGN - 1) & ~(FLAT_AREA_ALIGN - 1);
+  if (flat.heap_vma - flat.guest_base > FLAT_DATA_MAX_SIZE)
+    elfconv_runtime_error("[ERROR] data sections are too sparse for the flat memory. (0x%llx ~ 0x%llx)\n",
+                          data_start, data_end);
+  flat.stack_vma = flat.heap_vma + HEAP_UNIT_SIZE;
+  flat.guest_end = flat.stack_vma + STACK_SIZE;
+
+  auto flat_len = static_cast<size_t>(flat.guest_end - flat.guest_base);
+#  if defined(TARGET_IS_WASI) || defined(TARGET_IS_BROWSER)
+  flat.host_base = reinterpret_cast<uint8_t *>(malloc(flat_len));
+  if (!flat.host_base)
+    elfconv_runtime_error("[ERROR] failed to reserve the flat memory (0x%zx bytes).\n", flat_len);
+  /* heap is left uninitialized as well as the separated heap area */
+  memset(flat.host_base, 0, flat.heap_vma - flat.guest_base);
+#  else
+  auto host_base = mmap(NULL, flat_len, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (host_base == MAP_FAILED)
+    elfconv_runtime_error("[ERROR] failed to reserve the flat memory (0x%zx bytes).\n", flat_len);
+  flat.host_base = reinterpret_cast<uint8_t *>(host_base);
+#  endif
+
+  /* copy every section onto the flat memory */
+  for (int i = 0; i < __g_data_sec_num; i++) {
+    if (strncmp(reinterpret_cast<const char *>(__g_data_sec_name_ptr_array[i]), ".tbss", 5) == 0)
+      continue;
+    memcpy(flat.host_base + (__g_data_sec_vma_array[i] - flat.guest_base),
+           __g_data_sec_bytes_ptr_array[i], static_cast<size_t>(__g_data_sec_size_array[i]));
+  }
+  return flat;
+}
+#endif
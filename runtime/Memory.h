@@ -18,13 +18,19 @@ const addr_t STACK_START_VMA = 0x0fff'ff00'0000'0000; /* 65535 TiB FIXME! */
 const size_t STACK_SIZE = 1 * 1024 * 1024; /* 4 MiB */
 const addr_t HEAPS_START_VMA = 0x4000'0000'0000; /* 64 TiB FIXME! */
 const uint64_t HEAP_UNIT_SIZE = 1 * 1024 * 1024 * 1024; /* 1 GiB */
+const uint64_t VMA_PAGE_SHIFT = 12; /* 4 KiB */
+const uint64_t VMA_PAGE_L2_BITS = 18; /* one level 2 table covers 1 GiB */
+#if defined(ELFC_RUNTIME_FLAT_MEMORY)
+const uint64_t FLAT_AREA_ALIGN = 0x10000; /* 64 KiB (wasm page size) */
+const uint64_t FLAT_DATA_MAX_SIZE = 1 * 1024 * 1024 * 1024; /* 1 GiB */
+#endif
 
 typedef uint32_t _ecv_reg_t;
 typedef uint64_t _ecv_reg64_t;
 
 extern "C" {
-/* State machine which represents all CPU registers */
-extern State CPUState;
+/* State machine which represents all CPU registers (one per guest thread) */
+extern thread_local State CPUState;
 /* Lifted entry function address */
 extern const LiftedFunc __g_entry_func;
 /* entry point of the original ELF */
@@ -48,12 +54,22 @@ extern const char __g_platform_name[];
 /* lifted function symbol table (for debug) */
 extern const uint8_t *__g_fn_symbol_table[];
 extern uint64_t __g_fn_vmas_second[];
-/* block addres arrays of the lifted function which includes BR instruction */
-extern uint64_t **__g_block_address_ptrs_array[];
-extern const uint64_t *__g_block_address_vmas_array[];
-extern const uint64_t __g_block_address_size_array[];
-extern const uint64_t __g_block_address_fn_vma_array[];
-extern const uint64_t __g_block_address_array_size;
+/* memory region for the inlined memory access (fast path) */
+extern addr_t __g_mem_region_guest_base;
+extern uint64_t __g_mem_region_size;
+extern uint8_t *__g_mem_region_host_base;
+#if defined(ELFC_RUNTIME_PROFILE)
+/* guest profile counters (__g_prof_fn_counts is parallel to __g_fn_vmas) */
+extern uint64_t __g_prof_fn_counts[];
+extern const uint64_t __g_prof_block_num;
+extern uint64_t __g_prof_block_fn_vmas[];
+extern uint64_t __g_prof_block_vmas[];
+extern uint64_t __g_prof_block_counts[];
+extern const uint64_t __g_prof_branch_num;
+extern uint64_t __g_prof_branch_vmas[];
+extern uint64_t __g_prof_branch_counts[];
+extern uint64_t __g_prof_branch_taken_counts[];
+#endif
 }
 
 enum class MemoryAreaType : uint8_t {
@@ -85,8 +101,9 @@ class MappedMemory {
   }
 
   static MappedMemory *VMAStackEntryInit(int argc, char *argv[],
-                                         State &state /* start stack pointer */);
-  static MappedMemory *VMAHeapEntryInit();
+                                         State &state /* start stack pointer */,
+                                         addr_t vma = STACK_START_VMA, uint8_t *bytes = nullptr);
+  static MappedMemory *VMAHeapEntryInit(addr_t vma = HEAPS_START_VMA, uint8_t *bytes = nullptr);
   void DebugEmulatedMemory();
 
   MemoryAreaType memory_area_type;
@@ -99,3 +116,49 @@ class MappedMemory {
   bool bytes_on_heap;  // whether or not bytes is allocated on the heap memory
   uint64_t heap_cur; /* for Heap */
 };
+
+/*
+  PageTable
+  two-level page table from the guest page number to the mapped memory.
+  level 1: 1 GiB chunks sorted by the chunk number (only a few chunks are used).
+  level 2: every page in the chunk.
+*/
+class PageTable {
+ public:
+  PageTable() {}
+  ~PageTable() {
+    for (auto &[_, l2_table] : l1_entries)
+      free(l2_table);
+  }
+
+  /* register every page of the memory */
+  void Map(MappedMemory *memory);
+  /* nullptr: unmapped, MIXED_PAGE: the page is shared by some memorys */
+  MappedMemory *Walk(addr_t vma);
+
+  static inline MappedMemory *const MIXED_PAGE = reinterpret_cast<MappedMemory *>(1);
+
+ private:
+  MappedMemory **GetL2Table(uint64_t chunk, bool create);
+
+  std::vector<std::pair<uint64_t, MappedMemory **>> l1_entries;
+};
+
+#if defined(ELFC_RUNTIME_FLAT_MEMORY)
+/*
+  FlatMemory
+  every guest area (data sections, heap and stack) is placed on one contiguous host area, so
+  the address translation is always `host_base + (vma - guest_base)`.
+  layout: [data sections] [heap (HEAP_UNIT_SIZE)] [stack (STACK_SIZE)]
+*/
+class FlatMemory {
+ public:
+  static FlatMemory Reserve();
+
+  addr_t guest_base;
+  addr_t heap_vma;
+  addr_t stack_vma;
+  addr_t guest_end;
+  uint8_t *host_base;
+};
+#endif
@@ -1,18 +1,37 @@
 #include "Runtime.h"
 
+#include "syscalls/SysTable.h"
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <sstream>
+#include <unistd.h>
+#include <unordered_map>
 #include <utils/Util.h>
 #include <utils/elfconv.h>
+#if defined(ELFC_RUNTIME_THREADS)
+#  include <pthread.h>
+#endif
 
-void *RuntimeManager::TranslateVMA(addr_t vma_addr) {
-  /* search in every mapped memory */
-  if (vma_addr >= stack_memory->vma)
-    return reinterpret_cast<void *>(stack_memory->bytes + (vma_addr - stack_memory->vma));
-  if (vma_addr >= heap_memory->vma)
-    return reinterpret_cast<void *>(heap_memory->bytes + (vma_addr - heap_memory->vma));
-  for (auto &memory : mapped_memorys) {
-    if (memory->vma <= vma_addr && vma_addr < memory->vma_end)
-      return reinterpret_cast<void *>(memory->bytes + (vma_addr - memory->vma));
+#if !defined(ELFC_RUNTIME_FLAT_MEMORY)
+void *RuntimeManager::TranslateVMASlow(addr_t vma_addr) {
+  auto memory = page_table.Walk(vma_addr);
+  if (memory && memory != PageTable::MIXED_PAGE) {
+    auto bias = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(memory->bytes)) - memory->vma;
+    tlb[(vma_addr >> VMA_PAGE_SHIFT) & (TLB_SIZE - 1)] = {vma_addr >> VMA_PAGE_SHIFT, bias};
+    return reinterpret_cast<void *>(static_cast<uintptr_t>(vma_addr + bias));
+  }
+  /* the page is shared by some memorys (not cached) */
+  if (memory == PageTable::MIXED_PAGE) {
+    for (auto &mapped : mapped_memorys) {
+      if (mapped->vma <= vma_addr && vma_addr < mapped->vma_end)
+        return reinterpret_cast<void *>(mapped->bytes + (vma_addr - mapped->vma));
+    }
   }
   /* not exist sections which includes the vma_addr. */
   std::stringstream err_ss;
@@ -24,3 +43,315 @@ void *RuntimeManager::TranslateVMA(addr_t vma_addr) {
   }
   elfconv_runtime_error(err_ss.str().c_str());
 }
+#endif
+
+#if defined(ELFC_RUNTIME_PROFILE)
+/*
+  Write the guest profile as the folded stacks (e.g. for flamegraph.pl) to $ELFC_PROFILE_OUT
+  (default: elfconv.prof.folded).
+  "<function> <calls>" for every lifted function, or "<function>;<block vma> <executions>"
+  for every guest basic block if the lifter counted them (--guest_profile=block).
+  The build of elflift --instrument also writes the profile for elflift --profile to
+  $ELFC_PGO_OUT (default: elfconv.pgo).
+*/
+void DumpGuestProfile() {
+  std::unordered_map<uint64_t, std::string> fn_symbol_map;
+  for (int i = 0; __g_fn_vmas_second[i] && __g_fn_symbol_table[i]; i++) {
+    /* strip the suffix of the lifted function name (<symbol>_____<id>_<vma>) */
+    std::string fn_name = (const char *) __g_fn_symbol_table[i];
+    fn_symbol_map[__g_fn_vmas_second[i]] = fn_name.substr(0, fn_name.rfind("_____"));
+  }
+  auto fn_symbol = [&](uint64_t fn_vma) {
+    if (auto it = fn_symbol_map.find(fn_vma); it != fn_symbol_map.end())
+      return it->second;
+    std::stringstream fn_vma_ss;
+    fn_vma_ss << "0x" << std::hex << fn_vma;
+    return fn_vma_ss.str();
+  };
+
+  auto out_path = getenv("ELFC_PROFILE_OUT");
+  auto out = fopen(out_path ? out_path : "elfconv.prof.folded", "w");
+  if (!out) {
+    fprintf(stderr, "[WARNING] cannot open the guest profile file.\n");
+    return;
+  }
+  if (__g_prof_block_num > 0) {
+    for (uint64_t i = 0; i < __g_prof_block_num; i++)
+      if (__g_prof_block_counts[i])
+        fprintf(out, "%s;0x%" PRIx64 " %" PRIu64 "\n", fn_symbol(__g_prof_block_fn_vmas[i]).c_str(),
+                __g_prof_block_vmas[i], __g_prof_block_counts[i]);
+  } else {
+    for (uint64_t i = 0; __g_fn_vmas[i]; i++)
+      if (__g_prof_fn_counts[i])
+        fprintf(out, "%s %" PRIu64 "\n", fn_symbol(__g_fn_vmas[i]).c_str(), __g_prof_fn_counts[i]);
+  }
+  fclose(out);
+  /* the profile for the profile-guided lifting (elflift --instrument and --profile) */
+  if (__g_prof_branch_num == 0)
+    return;
+  auto pgo_out_path = getenv("ELFC_PGO_OUT");
+  auto pgo_out = fopen(pgo_out_path ? pgo_out_path : "elfconv.pgo", "w");
+  if (!pgo_out) {
+    fprintf(stderr, "[WARNING] cannot open the profile file for elflift.\n");
+    return;
+  }
+  for (uint64_t i = 0; __g_fn_vmas[i]; i++)
+    if (__g_prof_fn_counts[i])
+      fprintf(pgo_out, "fn 0x%" PRIx64 " %" PRIu64 "\n", __g_fn_vmas[i], __g_prof_fn_counts[i]);
+  for (uint64_t i = 0; i < __g_prof_block_num; i++)
+    if (__g_prof_block_counts[i])
+      fprintf(pgo_out, "block 0x%" PRIx64 " %" PRIu64 "\n", __g_prof_block_vmas[i],
+              __g_prof_block_counts[i]);
+  for (uint64_t i = 0; i < __g_prof_branch_num; i++)
+    if (__g_prof_branch_counts[i])
+      fprintf(pgo_out, "branch 0x%" PRIx64 " %" PRIu64 " %" PRIu64 "\n", __g_prof_branch_vmas[i],
+              __g_prof_branch_taken_counts[i],
+              __g_prof_branch_counts[i] - __g_prof_branch_taken_counts[i]);
+  fclose(pgo_out);
+}
+#endif
+
+/*
+  guest threads
+*/
+#define _ECV_CLONE_THREAD 0x10000
+#define _ECV_CLONE_SETTLS 0x80000
+#define _ECV_CLONE_PARENT_SETTID 0x100000
+#define _ECV_CLONE_CHILD_CLEARTID 0x200000
+#define _ECV_CLONE_CHILD_SETTID 0x1000000
+
+#define _ECV_FUTEX_WAIT 0
+#define _ECV_FUTEX_WAKE 1
+#define _ECV_FUTEX_REQUEUE 3
+#define _ECV_FUTEX_CMP_REQUEUE 4
+#define _ECV_FUTEX_WAIT_BITSET 9
+#define _ECV_FUTEX_WAKE_BITSET 10
+#define _ECV_FUTEX_PRIVATE_FLAG 128
+#define _ECV_FUTEX_CLOCK_REALTIME 256
+#define _ECV_FUTEX_BITSET_MATCH_ANY 0xffffffff
+
+/* host stack of the guest thread (the lifted functions call each other on it) */
+#define GUEST_THREAD_HOST_STACK_SIZE (8 * 1024 * 1024)
+
+struct _ecv_timespec {
+  int64_t tv_sec;
+  int64_t tv_nsec;
+};
+
+/* tid of the guest thread (0: not taken yet) */
+static thread_local uint32_t guest_tid = 0;
+/* CLONE_CHILD_CLEARTID or set_tid_address */
+static thread_local addr_t guest_clear_child_tid = 0;
+static thread_local bool guest_thread_is_child = false;
+
+uint32_t RuntimeManager::GuestTid() {
+  if (guest_tid == 0) {
+#if defined(TARGET_IS_WASI)
+    static std::atomic<uint32_t> wasi_tid_next = 42;
+    guest_tid = wasi_tid_next.fetch_add(1);
+#else
+    guest_tid = gettid();
+#endif
+  }
+  return guest_tid;
+}
+
+int64_t RuntimeManager::GuestSetTidAddress(addr_t tidptr) {
+  guest_clear_child_tid = tidptr;
+  return GuestTid();
+}
+
+#if defined(ELFC_RUNTIME_THREADS)
+/* passed from the parent to the child of clone */
+struct GuestThreadStart {
+  RuntimeManager *runtime_manager;
+  State state;
+  LiftedFunc fn;
+  uint64_t flags;
+  addr_t parent_tid;
+  addr_t child_tid;
+  /* the child tells its tid to the parent */
+  std::mutex mutex;
+  std::condition_variable cond;
+  uint32_t tid = 0;
+};
+
+static void *GuestThreadMain(void *arg) {
+  auto start = reinterpret_cast<GuestThreadStart *>(arg);
+  auto runtime_manager = start->runtime_manager;
+  auto fn = start->fn;
+  CPUState = start->state;
+  guest_thread_is_child = true;
+#  if !defined(ELFC_RUNTIME_FLAT_MEMORY)
+  runtime_manager->FlushTLB();
+#  endif
+  auto tid = runtime_manager->GuestTid();
+  if (start->flags & _ECV_CLONE_PARENT_SETTID)
+    *reinterpret_cast<uint32_t *>(runtime_manager->TranslateVMA(start->parent_tid)) = tid;
+  if (start->flags & _ECV_CLONE_CHILD_SETTID)
+    *reinterpret_cast<uint32_t *>(runtime_manager->TranslateVMA(start->child_tid)) = tid;
+  if (start->flags & _ECV_CLONE_CHILD_CLEARTID)
+    guest_clear_child_tid = start->child_tid;
+  {
+    /* `start` is on the stack of the parent and dies after this */
+    std::lock_guard<std::mutex> lock(start->mutex);
+    start->tid = tid;
+    start->cond.notify_one();
+  }
+  fn(&CPUState, CPUState.gpr.pc.qword, runtime_manager);
+  runtime_manager->GuestExit(0);
+  return nullptr;
+}
+#endif
+
+int64_t RuntimeManager::GuestClone(uint64_t flags, addr_t child_stack, addr_t parent_tid,
+                                   addr_t tls, addr_t child_tid) {
+#if defined(ELFC_RUNTIME_THREADS) && defined(ELF_IS_AARCH64)
+  if (!(flags & _ECV_CLONE_THREAD))
+    elfconv_runtime_error(
+        "Unsupported clone (flags: 0x%" PRIx64 "). only CLONE_THREAD is supported.\n", flags);
+  /* the parent takes its tid before the child */
+  GuestTid();
+  GuestThreadStart start;
+  start.runtime_manager = this;
+  start.state = CPUState;
+  start.state.gpr.x0 = {.qword = 0};
+  if (child_stack)
+    start.state.gpr.sp = {.qword = child_stack};
+  if (flags & _ECV_CLONE_SETTLS)
+    start.state.sr.tpidr_el0 = {.qword = tls};
+  /* the child starts at the next instruction of `svc` (the lifter makes it the function entry) */
+  start.state.gpr.pc = {.qword = CPUState.gpr.pc.qword + 4};
+  start.fn = GetLiftedFunc(start.state.gpr.pc.qword);
+  if (!start.fn)
+    elfconv_runtime_error("The child of clone (0x%" PRIx64 ") is not lifted.\n",
+                          start.state.gpr.pc.qword);
+  start.flags = flags;
+  start.parent_tid = parent_tid;
+  start.child_tid = child_tid;
+
+  pthread_attr_t attr;
+  pthread_t thread;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, GUEST_THREAD_HOST_STACK_SIZE);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  auto ret = pthread_create(&thread, &attr, GuestThreadMain, &start);
+  pthread_attr_destroy(&attr);
+  if (ret != 0)
+    return -_ECV_EAGAIN;
+  std::unique_lock<std::mutex> lock(start.mutex);
+  start.cond.wait(lock, [&start] { return start.tid != 0; });
+  return start.tid;
+#else
+  /* the runtime without the threads (e.g. wasm without THREADS=1) */
+  return -_ECV_ENOSYS;
+#endif
+}
+
+void RuntimeManager::GuestExit(int status) {
+#if defined(ELFC_RUNTIME_THREADS)
+  if (guest_thread_is_child) {
+    /* wake the thread joining this (pthread_join waits on the tid) */
+    if (guest_clear_child_tid) {
+      __atomic_store_n(reinterpret_cast<uint32_t *>(TranslateVMA(guest_clear_child_tid)), 0,
+                       __ATOMIC_SEQ_CST);
+      GuestFutex(guest_clear_child_tid, _ECV_FUTEX_WAKE, 1, 0, 0, 0);
+    }
+    pthread_exit(nullptr);
+  }
+#endif
+  exit(status);
+}
+
+int64_t RuntimeManager::GuestFutex(addr_t uaddr, uint32_t op, uint32_t val, addr_t timeout,
+                                   addr_t uaddr2, uint32_t val3) {
+  auto futex_word = reinterpret_cast<uint32_t *>(TranslateVMA(uaddr));
+  auto futex_cmd = op & ~(_ECV_FUTEX_PRIVATE_FLAG | _ECV_FUTEX_CLOCK_REALTIME);
+#if defined(ELFC_RUNTIME_THREADS)
+  switch (futex_cmd) {
+    case _ECV_FUTEX_WAIT: val3 = _ECV_FUTEX_BITSET_MATCH_ANY; [[fallthrough]];
+    case _ECV_FUTEX_WAIT_BITSET: {
+      /* FUTEX_WAIT takes the relative timeout and FUTEX_WAIT_BITSET takes the absolute one */
+      auto deadline = std::chrono::steady_clock::time_point::max();
+      if (timeout) {
+        _ecv_timespec guest_ts;
+        memcpy(&guest_ts, TranslateVMA(timeout), sizeof(_ecv_timespec));
+        auto wait_ns = guest_ts.tv_sec * 1000000000LL + guest_ts.tv_nsec;
+        if (futex_cmd == _ECV_FUTEX_WAIT_BITSET) {
+          struct timespec now_ts;
+          clock_gettime(op & _ECV_FUTEX_CLOCK_REALTIME ? CLOCK_REALTIME : CLOCK_MONOTONIC,
+                        &now_ts);
+          wait_ns -= now_ts.tv_sec * 1000000000LL + now_ts.tv_nsec;
+        }
+        deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(wait_ns);
+      }
+      std::unique_lock<std::mutex> lock(futex_mutex);
+      if (__atomic_load_n(futex_word, __ATOMIC_SEQ_CST) != val)
+        return -_ECV_EAGAIN;
+      FutexWaiter waiter(uaddr, val3);
+      futex_waiters.push_back(&waiter);
+      if (!waiter.cond.wait_until(lock, deadline, [&waiter] { return waiter.woken; })) {
+        futex_waiters.remove(&waiter);
+        return -_ECV_ETIMEDOUT;
+      }
+      return 0;
+    }
+    case _ECV_FUTEX_WAKE: val3 = _ECV_FUTEX_BITSET_MATCH_ANY; [[fallthrough]];
+    case _ECV_FUTEX_WAKE_BITSET: {
+      std::lock_guard<std::mutex> lock(futex_mutex);
+      int64_t woken_num = 0;
+      for (auto it = futex_waiters.begin(); it != futex_waiters.end() && woken_num < val;) {
+        auto waiter = *it;
+        if (waiter->uaddr == uaddr && (waiter->bitset & val3)) {
+          waiter->woken = true;
+          waiter->cond.notify_one();
+          it = futex_waiters.erase(it);
+          woken_num++;
+        } else {
+          it++;
+        }
+      }
+      return woken_num;
+    }
+    case _ECV_FUTEX_REQUEUE:
+    case _ECV_FUTEX_CMP_REQUEUE: {
+      /* the 4th argument is the max number of the requeued waiters */
+      auto requeue_max = static_cast<uint32_t>(timeout);
+      std::lock_guard<std::mutex> lock(futex_mutex);
+      if (futex_cmd == _ECV_FUTEX_CMP_REQUEUE &&
+          __atomic_load_n(futex_word, __ATOMIC_SEQ_CST) != val3)
+        return -_ECV_EAGAIN;
+      int64_t woken_num = 0, requeued_num = 0;
+      for (auto it = futex_waiters.begin(); it != futex_waiters.end(); it++) {
+        auto waiter = *it;
+        if (waiter->uaddr != uaddr)
+          continue;
+        if (woken_num < val) {
+          waiter->woken = true;
+          waiter->cond.notify_one();
+          woken_num++;
+        } else if (requeued_num < requeue_max) {
+          waiter->uaddr = uaddr2;
+          requeued_num++;
+        } else {
+          break;
+        }
+      }
+      futex_waiters.remove_if([](FutexWaiter *waiter) { return waiter->woken; });
+      return futex_cmd == _ECV_FUTEX_CMP_REQUEUE ? woken_num + requeued_num : woken_num;
+    }
+    default: return -_ECV_ENOSYS;
+  }
+#else
+  /* only one guest thread: nobody wakes the waiter */
+  switch (futex_cmd) {
+    case _ECV_FUTEX_WAIT:
+    case _ECV_FUTEX_WAIT_BITSET: return *futex_word != val ? -_ECV_EAGAIN : 0;
+    case _ECV_FUTEX_WAKE:
+    case _ECV_FUTEX_WAKE_BITSET:
+    case _ECV_FUTEX_REQUEUE:
+    case _ECV_FUTEX_CMP_REQUEUE: return 0;
+    default: return -_ECV_ENOSYS;
+  }
+#endif
+}
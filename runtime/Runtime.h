@@ -2,21 +2,100 @@
 
 #include "Memory.h"
 
+#include <algorithm>
+
+/* the guest threads (clone) run on the host threads. the wasm builds need THREADS=1 of dev.sh
+   (wasi-threads or Web Worker). */
+#if !defined(TARGET_IS_WASI) && !defined(TARGET_IS_BROWSER) && !defined(ELFC_RUNTIME_THREADS)
+#  define ELFC_RUNTIME_THREADS 1
+#endif
+#if defined(ELFC_RUNTIME_THREADS)
+#  include <condition_variable>
+#  include <list>
+#  include <mutex>
+#endif
+
+#if !defined(ELFC_RUNTIME_FLAT_MEMORY)
+const uint64_t TLB_SIZE = 64;
+
+/* last translation of the guest page (vpn) */
+struct TLBEntry {
+  uint64_t vpn;
+  uint64_t bias; /* host address - guest address */
+};
+#endif
+
+#if defined(ELFC_RUNTIME_PROFILE)
+/* write the guest profile counters at exit */
+void DumpGuestProfile();
+#endif
+
+#if defined(ELFC_RUNTIME_THREADS)
+/* the guest thread blocked by FUTEX_WAIT */
+struct FutexWaiter {
+  FutexWaiter(addr_t __uaddr, uint32_t __bitset)
+      : uaddr(__uaddr),
+        bitset(__bitset),
+        woken(false) {}
+
+  addr_t uaddr;
+  uint32_t bitset;
+  bool woken;
+  std::condition_variable cond;
+};
+#endif
+
 class RuntimeManager {
  public:
   RuntimeManager(std::vector<MappedMemory *> __mapped_memorys, MappedMemory *__mapped_stack,
                  MappedMemory *__mapped_heap)
       : mapped_memorys(__mapped_memorys),
         stack_memory(__mapped_stack),
-        heap_memory(__mapped_heap),
-        addr_fn_map({}) {}
-  RuntimeManager() {}
+        heap_memory(__mapped_heap) {
+#if !defined(ELFC_RUNTIME_FLAT_MEMORY)
+    for (auto memory : mapped_memorys)
+      page_table.Map(memory);
+    page_table.Map(stack_memory);
+    page_table.Map(heap_memory);
+    FlushTLB();
+#endif
+  }
+  RuntimeManager() {
+#if !defined(ELFC_RUNTIME_FLAT_MEMORY)
+    FlushTLB();
+#endif
+  }
   ~RuntimeManager() {
     for (auto memory : mapped_memorys)
       delete (memory);
   }
   /* translate vma address to the actual mapped memory address */
-  void *TranslateVMA(addr_t vma_addr);
+#if defined(ELFC_RUNTIME_FLAT_MEMORY)
+  inline void *TranslateVMA(addr_t vma_addr) {
+    return reinterpret_cast<void *>(flat_host_base + (vma_addr - flat_guest_base));
+  }
+#else
+  inline void *TranslateVMA(addr_t vma_addr) {
+    auto &tlb_entry = tlb[(vma_addr >> VMA_PAGE_SHIFT) & (TLB_SIZE - 1)];
+    if (tlb_entry.vpn == vma_addr >> VMA_PAGE_SHIFT)
+      return reinterpret_cast<void *>(static_cast<uintptr_t>(vma_addr + tlb_entry.bias));
+    return TranslateVMASlow(vma_addr);
+  }
+  /* walk the page table and refill the TLB */
+  void *TranslateVMASlow(addr_t vma_addr);
+  void FlushTLB() {
+    for (auto &tlb_entry : tlb)
+      tlb_entry = {UINT64_MAX, 0};
+  }
+#endif
+
+  /* lifted function of the vma (nullptr if not lifted). __g_fn_vmas is sorted by the lifter. */
+  inline LiftedFunc GetLiftedFunc(addr_t fn_vma) {
+    auto fn_vma_it = std::lower_bound(__g_fn_vmas, __g_fn_vmas + fn_num, fn_vma);
+    if (fn_vma_it == __g_fn_vmas + fn_num || *fn_vma_it != fn_vma)
+      return nullptr;
+    return __g_fn_ptr_table[fn_vma_it - __g_fn_vmas];
+  }
 
   void DebugEmulatedMemorys() {
     for (auto memory : mapped_memorys)
@@ -28,15 +107,50 @@ class RuntimeManager {
   void SVCWasiCall();  // for wasi
   void SVCNativeCall();  // for native
 
+  /* guest threads (shared by every syscall emulation) */
+  /* clone: start the child thread at the lifted function of the next instruction of `svc` */
+  int64_t GuestClone(uint64_t flags, addr_t child_stack, addr_t parent_tid, addr_t tls,
+                     addr_t child_tid);
+  /* exit: end the calling guest thread (the main thread ends the process) */
+  void GuestExit(int status);
+  /* set_tid_address */
+  int64_t GuestSetTidAddress(addr_t tidptr);
+  /* gettid */
+  uint32_t GuestTid();
+  /* futex: FUTEX_WAIT(_BITSET), FUTEX_WAKE(_BITSET), FUTEX_REQUEUE and FUTEX_CMP_REQUEUE */
+  int64_t GuestFutex(addr_t uaddr, uint32_t op, uint32_t val, addr_t timeout, addr_t uaddr2,
+                     uint32_t val3);
+
   std::vector<MappedMemory *> mapped_memorys;
   MappedMemory *stack_memory;
   MappedMemory *heap_memory;
   /* heap area manage */
   addr_t heaps_end_addr;
-  std::unordered_map<addr_t, LiftedFunc> addr_fn_map;
+  /* number of the lifted functions (__g_fn_vmas and __g_fn_ptr_table) */
+  uint64_t fn_num = 0;
   std::unordered_map<addr_t, const char *> addr_fn_symbol_map;
-  std::map<addr_t, std::map<uint64_t, uint64_t *>> addr_block_addrs_map;
   std::vector<addr_t> call_stacks;
+#if !defined(ELFC_RUNTIME_FLAT_MEMORY)
+  PageTable page_table;
+#  if defined(ELFC_RUNTIME_THREADS)
+  /* every guest thread fills its own TLB (FlushTLB at the thread start) */
+  static inline thread_local TLBEntry tlb[TLB_SIZE];
+#  else
+  TLBEntry tlb[TLB_SIZE];
+#  endif
+#endif
+#if defined(ELFC_RUNTIME_FLAT_MEMORY)
+  /* every guest area is placed on [flat_host_base, flat_host_base + (guest_end - guest_base)) */
+  uint8_t *flat_host_base;
+  addr_t flat_guest_base;
+#endif
+
+#if defined(ELFC_RUNTIME_THREADS)
+  /* brk and mmap move heap_cur of every thread */
+  std::mutex heap_mutex;
+  std::mutex futex_mutex;
+  std::list<FutexWaiter *> futex_waiters;
+#endif
 
   int cnt = 0;
   std::unordered_map<std::string, uint64_t> sec_map;
@@ -1,6 +1,7 @@
 #include "Memory.h"
 #include "Runtime.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdarg>
 #include <iomanip>
@@ -28,6 +29,16 @@
   fflush(stdout); \
   abort();
 
+/* memory region for the inlined memory access of the lifted LLVM IR (set by Entry.cpp) */
+addr_t __g_mem_region_guest_base = 0;
+uint64_t __g_mem_region_size = 0;
+uint8_t *__g_mem_region_host_base = nullptr;
+
+/* slow path of the inlined memory access */
+extern "C" void *__g_translate_vma(RuntimeManager *runtime_manager, addr_t addr) {
+  return runtime_manager->TranslateVMA(addr);
+}
+
 uint8_t __remill_read_memory_8(RuntimeManager *runtime_manager, addr_t addr) {
   return *(uint8_t *) runtime_manager->TranslateVMA(addr);
 }
@@ -139,11 +150,7 @@ void __remill_error(State &, addr_t addr, RuntimeManager *) {
 
 
 void __remill_function_call(State &state, addr_t fn_vma, RuntimeManager *runtime_manager) {
-  static std::unordered_map<addr_t, LiftedFunc> vma_cache;
-  if (auto jmp_fn_cache = vma_cache[fn_vma]; jmp_fn_cache) {
-    jmp_fn_cache(&state, fn_vma, runtime_manager);
-  } else if (auto jmp_fn = runtime_manager->addr_fn_map[fn_vma]; jmp_fn) {
-    vma_cache.insert({fn_vma, jmp_fn});
+  if (auto jmp_fn = runtime_manager->GetLiftedFunc(fn_vma); jmp_fn) {
     jmp_fn(&state, fn_vma, runtime_manager);
   } else {
     elfconv_runtime_error(
@@ -155,11 +162,7 @@ void __remill_function_call(State &state, addr_t fn_vma, RuntimeManager *runtime
 
 /* BR instruction */
 void __remill_jump(State &state, addr_t fn_vma, RuntimeManager *runtime_manager) {
-  static std::unordered_map<addr_t, LiftedFunc> vma_cache_2;
-  if (auto jmp_fn_cache = vma_cache_2[fn_vma]; jmp_fn_cache) {
-    jmp_fn_cache(&state, fn_vma, runtime_manager);
-  } else if (auto jmp_fn = runtime_manager->addr_fn_map[fn_vma]; jmp_fn) {
-    vma_cache_2.insert({fn_vma, jmp_fn});
+  if (auto jmp_fn = runtime_manager->GetLiftedFunc(fn_vma); jmp_fn) {
     jmp_fn(&state, fn_vma, runtime_manager);
   } else {
     elfconv_runtime_error(
@@ -169,25 +172,25 @@ void __remill_jump(State &state, addr_t fn_vma, RuntimeManager *runtime_manager)
   }
 }
 
+// get the target lifted function on the miss of the inline cache at the BLR and BR site
+extern "C" LiftedFunc __g_get_lifted_func(RuntimeManager *runtime_manager, addr_t fn_vma) {
+  if (auto jmp_fn = runtime_manager->GetLiftedFunc(fn_vma); jmp_fn)
+    return jmp_fn;
+  elfconv_runtime_error(
+      "[ERROR] vma 0x%016llx is not included in the lifted function pointer table (BLR/BR). PC: "
+      "0x%08x\n",
+      fn_vma, PCREG);
+}
+
 // get the target basic block label pointer for indirectbr instruction
+// bb_vmas is sorted and its last element (UINT64_MAX) is the block which jumps to the other function.
 extern "C" uint64_t *__g_get_indirectbr_block_address(RuntimeManager *runtime_manager,
-                                                      uint64_t fun_vma, uint64_t bb_vma) {
-  if (runtime_manager->addr_block_addrs_map.count(fun_vma) == 1) {
-    auto vma_bb_map = runtime_manager->addr_block_addrs_map[fun_vma];
-    if (vma_bb_map.count(bb_vma) == 1) {
-      return vma_bb_map[bb_vma];
-    } else {
-      if (runtime_manager->addr_fn_map.count(fun_vma) == 1)
-        return vma_bb_map[UINT64_MAX];
-      else
-        elfconv_runtime_error("[ERROR] 0x%llx is not the vma of the block address of '%s'.\n",
-                              bb_vma, __func__);
-    }
-  } else {
-    elfconv_runtime_error(
-        "[ERROR] 0x%llx is not the entry address of any lifted function. (at %s)\n", fun_vma,
-        __func__);
-  }
+                                                      const uint64_t *bb_vmas, uint64_t **bb_addrs,
+                                                      uint64_t bb_num, uint64_t bb_vma) {
+  auto bb_vma_it = std::lower_bound(bb_vmas, bb_vmas + bb_num - 1, bb_vma);
+  if (*bb_vma_it == bb_vma)
+    return bb_addrs[bb_vma_it - bb_vmas];
+  return bb_addrs[bb_num - 1];
 }
 
 // push the callee symbol to the call stack for debug
@@ -452,15 +455,73 @@ inline bool __remill_compare_neq(bool result) {
   return result;
 }
 
-/* Data Memory Barrier instruction (FIXME) */
-void __remill_barrier_load_load(RuntimeManager *runtime_manager) {}
-void __remill_barrier_load_store(RuntimeManager *runtime_manager) {}
-void __remill_barrier_store_load(RuntimeManager *runtime_manager) {}
-void __remill_barrier_store_store(RuntimeManager *runtime_manager) {}
+/* Data Memory Barrier instruction (lowered to `fence` by MainLifter::InlineMemoryAccess) */
+void __remill_barrier_load_load(RuntimeManager *runtime_manager) {
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+void __remill_barrier_load_store(RuntimeManager *runtime_manager) {
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+void __remill_barrier_store_load(RuntimeManager *runtime_manager) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+void __remill_barrier_store_store(RuntimeManager *runtime_manager) {
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
 
 /* atomic */
-void __remill_atomic_begin(RuntimeManager *runtime_manager) {}
-void __remill_atomic_end(RuntimeManager *runtime_manager) {}
+void __remill_atomic_begin(RuntimeManager *runtime_manager) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+void __remill_atomic_end(RuntimeManager *runtime_manager) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/* atomic memory access (lowered to atomic load/store, atomicrmw and cmpxchg by MainLifter) */
+#define DEFINE_ATOMIC_MEMORY_ACCESS(size) \
+  uint##size##_t __remill_atomic_load_memory_##size(RuntimeManager *runtime_manager, addr_t addr, \
+                                                    int order) { \
+    return __atomic_load_n((uint##size##_t *) runtime_manager->TranslateVMA(addr), order); \
+  } \
+  void __remill_atomic_store_memory_##size(RuntimeManager *runtime_manager, addr_t addr, \
+                                           uint##size##_t src, int order) { \
+    __atomic_store_n((uint##size##_t *) runtime_manager->TranslateVMA(addr), src, order); \
+  }
+
+DEFINE_ATOMIC_MEMORY_ACCESS(8)
+DEFINE_ATOMIC_MEMORY_ACCESS(16)
+DEFINE_ATOMIC_MEMORY_ACCESS(32)
+DEFINE_ATOMIC_MEMORY_ACCESS(64)
+
+#define DEFINE_ATOMIC_RMW(size) \
+  uint##size##_t __remill_atomic_swap_memory_##size(RuntimeManager *runtime_manager, addr_t addr, \
+                                                    uint##size##_t src, int order) { \
+    return __atomic_exchange_n((uint##size##_t *) runtime_manager->TranslateVMA(addr), src, \
+                               order); \
+  } \
+  uint##size##_t __remill_atomic_add_memory_##size(RuntimeManager *runtime_manager, addr_t addr, \
+                                                   uint##size##_t src, int order) { \
+    return __atomic_fetch_add((uint##size##_t *) runtime_manager->TranslateVMA(addr), src, \
+                              order); \
+  } \
+  uint##size##_t __remill_atomic_or_memory_##size(RuntimeManager *runtime_manager, addr_t addr, \
+                                                  uint##size##_t src, int order) { \
+    return __atomic_fetch_or((uint##size##_t *) runtime_manager->TranslateVMA(addr), src, order); \
+  } \
+  uint##size##_t __remill_atomic_cmpxchg_memory_##size(RuntimeManager *runtime_manager, \
+                                                       addr_t addr, uint##size##_t expected, \
+                                                       uint##size##_t desired, int order) { \
+    /* the failure ordering can't have the release */ \
+    int failure_order = order == __ATOMIC_ACQ_REL   ? __ATOMIC_ACQUIRE \
+                        : order == __ATOMIC_RELEASE ? __ATOMIC_RELAXED \
+                                                    : order; \
+    __atomic_compare_exchange_n((uint##size##_t *) runtime_manager->TranslateVMA(addr), \
+                                &expected, desired, false, order, failure_order); \
+    return expected; \
+  }
+
+DEFINE_ATOMIC_RMW(32)
+DEFINE_ATOMIC_RMW(64)
 
 /* FIXME */
 void __remill_aarch64_emulate_instruction(RuntimeManager *runtime_manager) {}
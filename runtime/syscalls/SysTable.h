@@ -1,7 +1,9 @@
 #pragma once
 
+#define _ECV_EAGAIN 11
 #define _ECV_EACCESS 13
 #define _ECV_ENOSYS 38
+#define _ECV_ETIMEDOUT 110
 /*
     syscall number table
 */
@@ -28,6 +30,7 @@
 #define AARCH64_SYS_FUTEX 98
 #define AARCH64_SYS_SET_ROBUST_LIST 99
 #define AARCH64_SYS_CLOCK_GETTIME 113
+#define AARCH64_SYS_SCHED_YIELD 124
 #define AARCH64_SYS_TGKILL 131
 #define AARCH64_SYS_RT_SIGACTION 134
 #define AARCH64_SYS_RT_SIGPROCMASK 135
@@ -43,13 +46,16 @@
 #define AARCH64_SYS_GETTID 178
 #define AARCH64_SYS_BRK 214
 #define AARCH64_SYS_MUNMAP 215
+#define AARCH64_SYS_CLONE 220
 #define AARCH64_SYS_MMAP 222
 #define AARCH64_SYS_MPROTECT 226
+#define AARCH64_SYS_MADVISE 233
 #define AARCH64_SYS_WAIT4 260
 #define AARCH64_SYS_PRLIMIT64 261
 #define AARCH64_SYS_GETRANDOM 278
 #define AARCH64_SYS_STATX 291
 #define AARCH64_SYS_RSEQ 293
+#define AARCH64_SYS_CLONE3 435
 
 #include "runtime/Runtime.h"
 
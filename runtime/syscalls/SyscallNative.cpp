@@ -5,6 +5,7 @@
 #include <fcntl.h>
 #include <iostream>
 #include <remill/BC/HelperMacro.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string>
@@ -193,25 +194,18 @@ void RuntimeManager::SVCNativeCall(void) {
       errno = _ECV_EACCESS;
       break;
     case AARCH64_SYS_FSYNC: /* fsync (unsigned int fd) */ X0_D = fsync(X0_D); break;
-    case ECV_SYS_EXIT: /* exit (int error_code) */ exit(X0_D); break;
+    case ECV_SYS_EXIT: /* exit (int error_code) */ GuestExit(X0_D); break;
     case AARCH64_SYS_EXITGROUP: /* exit_group (int error_code) note. there is no function of 'exit_group', so must use syscall. */
+#if defined(ELFC_RUNTIME_PROFILE)
+      DumpGuestProfile(); /* exit_group doesn't run the atexit handlers */
+#endif
       syscall(AARCH64_SYS_EXITGROUP, X0_D);
       break;
     case AARCH64_SYS_SET_TID_ADDRESS: /* set_tid_address(int *tidptr) */
-    {
-      pid_t tid = gettid();
-      *reinterpret_cast<int *>(TranslateVMA(X0_Q)) = tid;
-      X0_Q = tid;
-    } break;
+      X0_Q = GuestSetTidAddress(X0_Q);
+      break;
     case AARCH64_SYS_FUTEX: /* futex (u32 *uaddr, int op, u32 val, const struct __kernel_timespec *utime, u32 *uaddr2, u23 val3) */
-      /* TODO */
-      if ((X1_D & 0x7F) == 0) {
-        /* FUTEX_WAIT */
-        X0_Q = 0;
-      } else {
-        elfconv_runtime_error("Unknown futex op 0x%08u\n", X1_D);
-      }
-      NOP_SYSCALL(AARCH64_SYS_FUTEX);
+      X0_Q = GuestFutex(X0_Q, X1_D, X2_D, X3_Q, X4_Q, X5_D);
       break;
     case AARCH64_SYS_SET_ROBUST_LIST: /* set_robust_list (struct robust_list_head *head, size_t len) */
       X0_Q = 0;
@@ -226,6 +220,7 @@ void RuntimeManager::SVCNativeCall(void) {
       memcpy(TranslateVMA(X1_Q), &emu_tp, sizeof(timespec));
       X0_Q = (_ecv_reg64_t) clock_time;
     } break;
+    case AARCH64_SYS_SCHED_YIELD: /* sched_yield () */ X0_D = sched_yield(); break;
     case AARCH64_SYS_TGKILL: /* tgkill (pid_t tgid, pid_t pid, int sig) */
       X0_Q = tgkill(X0_D, X1_D, X2_D);
       break;
@@ -257,9 +252,12 @@ void RuntimeManager::SVCNativeCall(void) {
     case AARCH64_SYS_GETEUID: /* geteuid () */ X0_D = geteuid(); break;
     case AARCH64_SYS_GETGID: /* getgid () */ X0_D = getgid(); break;
     case AARCH64_SYS_GETEGID: /* getegid () */ X0_D = getegid(); break;
-    case AARCH64_SYS_GETTID: /* gettid () */ X0_D = gettid(); break;
+    case AARCH64_SYS_GETTID: /* gettid () */ X0_D = GuestTid(); break;
     case AARCH64_SYS_BRK: /* brk (unsigned long brk) */
     {
+#if defined(ELFC_RUNTIME_THREADS)
+      std::lock_guard<std::mutex> heap_lock(heap_mutex);
+#endif
       auto __heap_memory = heap_memory;
       if (X0_Q == 0) {
         /* init program break (FIXME) */
@@ -271,6 +269,9 @@ void RuntimeManager::SVCNativeCall(void) {
         elfconv_runtime_error("Unsupported brk(0x%016llx).\n", X0_Q);
       }
     } break;
+    case AARCH64_SYS_CLONE: /* clone (unsigned long flags, void *stack, int *parent_tid, unsigned long tls, int *child_tid) */
+      X0_Q = GuestClone(X0_Q, X1_Q, X2_Q, X3_Q, X4_Q);
+      break;
     case AARCH64_SYS_MUNMAP: /* munmap (unsigned long addr, size_t len) */
       /* TODO */
       X0_Q = 0;
@@ -279,6 +280,9 @@ void RuntimeManager::SVCNativeCall(void) {
     case AARCH64_SYS_MMAP: /* mmap (void *start, size_t lengt, int prot, int flags, int fd, off_t offset) */
       /* FIXME */
       {
+#if defined(ELFC_RUNTIME_THREADS)
+        std::lock_guard<std::mutex> heap_lock(heap_mutex);
+#endif
         auto __heap_memory = heap_memory;
         if (X4_D != -1)
           elfconv_runtime_error("Unsupported mmap (X4=0x%08x)\n", X4_D);
@@ -297,6 +301,10 @@ void RuntimeManager::SVCNativeCall(void) {
       X0_Q = 0;
       NOP_SYSCALL(AARCH64_SYS_MPROTECT);
       break;
+    case AARCH64_SYS_MADVISE: /* madvise (unsigned long start, size_t len, int behavior) */
+      X0_Q = 0;
+      NOP_SYSCALL(AARCH64_SYS_MADVISE);
+      break;
     case AARCH64_SYS_WAIT4: /* pid_t wait4 (pid_t pid, int *stat_addr, int options, struct rusage *ru) */
       X0_D = wait4(X0_D, (int *) TranslateVMA(X1_Q), X2_D, (struct rusage *) TranslateVMA(X3_Q));
     case AARCH64_SYS_PRLIMIT64: /* prlimit64 (pid_t pid, unsigned int resource, const struct rlimit64 *new_rlim, struct rlimit64 *oldrlim) */
@@ -341,6 +349,11 @@ void RuntimeManager::SVCNativeCall(void) {
       X0_Q = 0;
       NOP_SYSCALL(AARCH64_SYS_RSEQ);
       break;
+    case AARCH64_SYS_CLONE3: /* clone3 (struct clone_args *uargs, size_t size) */
+      /* glibc falls back to clone */
+      X0_Q = -_ECV_ENOSYS;
+      EMPTY_SYSCALL(AARCH64_SYS_CLONE3);
+      break;
     default:
       elfconv_runtime_error("Unknown syscall number: %llu, PC: 0x%llx\n", SYSNUMREG, PCREG);
       break;
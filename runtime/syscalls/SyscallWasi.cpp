@@ -5,6 +5,7 @@
 #include <fcntl.h>
 #include <iostream>
 #include <remill/BC/HelperMacro.h>
+#include <sched.h>
 #include <stdlib.h>
 #include <string>
 #include <sys/stat.h>
@@ -209,25 +210,15 @@ void RuntimeManager::SVCWasiCall(void) {
       errno = _ECV_EACCESS;
       break;
     case AARCH64_SYS_FSYNC: /* fsync (unsigned int fd) */ X0_D = fsync(X0_D); break;
-    case AARCH64_SYS_EXIT: /* exit (int error_code) */ exit(X0_D); break;
+    case AARCH64_SYS_EXIT: /* exit (int error_code) */ GuestExit(X0_D); break;
     case AARCH64_SYS_EXITGROUP: /* exit_group (int error_code) note. there is no function of 'exit_group', so must use syscall. */
       exit(X0_D);
       break;
     case AARCH64_SYS_SET_TID_ADDRESS: /* set_tid_address(int *tidptr) */
-    {
-      pid_t tid = 42;
-      *reinterpret_cast<int *>(TranslateVMA(X0_Q)) = tid;
-      X0_Q = tid;
-    } break;
+      X0_Q = GuestSetTidAddress(X0_Q);
+      break;
     case AARCH64_SYS_FUTEX: /* futex (u32 *uaddr, int op, u32 val, const struct __kernel_timespec *utime, u32 *uaddr2, u23 val3) */
-      /* TODO */
-      if ((X1_D & 0x7F) == 0) {
-        /* FUTEX_WAIT */
-        X0_Q = 0;
-      } else {
-        elfconv_runtime_error("Unknown futex op 0x%08u\n", X1_D);
-      }
-      NOP_SYSCALL(AARCH64_SYS_FUTEX);
+      X0_Q = GuestFutex(X0_Q, X1_D, X2_D, X3_Q, X4_Q, X5_D);
       break;
     case AARCH64_SYS_SET_ROBUST_LIST: /* set_robust_list (struct robust_list_head *head, size_t len) */
       X0_Q = 0;
@@ -251,6 +242,7 @@ void RuntimeManager::SVCWasiCall(void) {
       memcpy(TranslateVMA(X1_Q), &tp, sizeof(tp));
       X0_Q = (_ecv_reg64_t) clock_time;
     } break;
+    case AARCH64_SYS_SCHED_YIELD: /* sched_yield () */ X0_D = sched_yield(); break;
     case AARCH64_SYS_TGKILL: /* tgkill (pid_t tgid, pid_t pid, int sig) */
       EMPTY_SYSCALL(AARCH64_SYS_TGKILL);
       X0_Q = -1;
@@ -290,9 +282,12 @@ void RuntimeManager::SVCWasiCall(void) {
     case AARCH64_SYS_GETEUID: /* geteuid () */ X0_D = 42; break;
     case AARCH64_SYS_GETGID: /* getgid () */ X0_D = 42; break;
     case AARCH64_SYS_GETEGID: /* getegid () */ X0_D = 42; break;
-    case AARCH64_SYS_GETTID: /* getttid () */ X0_D = 42; break;
+    case AARCH64_SYS_GETTID: /* getttid () */ X0_D = GuestTid(); break;
     case AARCH64_SYS_BRK: /* brk (unsigned long brk) */
     {
+#if defined(ELFC_RUNTIME_THREADS)
+      std::lock_guard<std::mutex> heap_lock(heap_mutex);
+#endif
       auto __heap_memory = heap_memory;
       if (X0_Q == 0) {
         /* init program break (FIXME) */
@@ -304,6 +299,9 @@ void RuntimeManager::SVCWasiCall(void) {
         elfconv_runtime_error("Unsupported brk(0x%016llx).\n", X0_Q);
       }
     } break;
+    case AARCH64_SYS_CLONE: /* clone (unsigned long flags, void *stack, int *parent_tid, unsigned long tls, int *child_tid) */
+      X0_Q = GuestClone(X0_Q, X1_Q, X2_Q, X3_Q, X4_Q);
+      break;
     case AARCH64_SYS_MUNMAP: /* munmap (unsigned long addr, size_t len) */
       /* TODO */
       X0_Q = 0;
@@ -312,6 +310,9 @@ void RuntimeManager::SVCWasiCall(void) {
     case AARCH64_SYS_MMAP: /* mmap (void *start, size_t lengt, int prot, int flags, int fd, off_t offset) */
       /* FIXME */
       {
+#if defined(ELFC_RUNTIME_THREADS)
+        std::lock_guard<std::mutex> heap_lock(heap_mutex);
+#endif
         auto __heap_memory = heap_memory;
         if (X4_D != -1)
           elfconv_runtime_error("Unsupported mmap (X4=0x%08x)\n", X4_D);
@@ -330,6 +331,10 @@ void RuntimeManager::SVCWasiCall(void) {
       X0_Q = 0;
       NOP_SYSCALL(AARCH64_SYS_MPROTECT);
       break;
+    case AARCH64_SYS_MADVISE: /* madvise (unsigned long start, size_t len, int behavior) */
+      X0_Q = 0;
+      NOP_SYSCALL(AARCH64_SYS_MADVISE);
+      break;
     case AARCH64_SYS_PRLIMIT64: /* prlimit64 (pid_t pid, unsigned int resource, const struct rlimit64 *new_rlim, struct rlimit64 *oldrlim) */
       X0_Q = 0;
       NOP_SYSCALL(AARCH64_SYS_PRLIMIT64);
@@ -373,6 +378,11 @@ void RuntimeManager::SVCWasiCall(void) {
       X0_Q = 0;
       NOP_SYSCALL(AARCH64_SYS_RSEQ);
       break;
+    case AARCH64_SYS_CLONE3: /* clone3 (struct clone_args *uargs, size_t size) */
+      /* glibc falls back to clone */
+      X0_Q = -_ECV_ENOSYS;
+      EMPTY_SYSCALL(AARCH64_SYS_CLONE3);
+      break;
     default:
       elfconv_runtime_error("Unknown syscall number: %llu, PC: 0x%llx\n", SYSNUMREG, PCREG);
       break;
@@ -17,11 +17,11 @@ setting() {
   BUILD_TESTS_AARCH64_DIR=${BUILD_DIR}/tests/aarch64
   CXX=clang++-16
   OPTFLAGS="-O3"
-  CLANGFLAGS="${OPTFLAGS} -static -I${ROOT_DIR}/backend/remill/include -I${ROOT_DIR}"
+  CLANGFLAGS="${OPTFLAGS} -static -pthread -I${ROOT_DIR}/backend/remill/include -I${ROOT_DIR}"
   EMCC=emcc
-  EMCCFLAGS="${OPTFLAGS} -I${ROOT_DIR}/backend/remill/include -I${ROOT_DIR}"
+  EMCCFLAGS="${OPTFLAGS} -msimd128 -I${ROOT_DIR}/backend/remill/include -I${ROOT_DIR}"
   WASISDKCC="${WASI_SDK_PATH}/bin/clang++"
-  WASISDKFLAGS="${OPTFLAGS} --sysroot=${WASI_SDK_PATH}/share/wasi-sysroot -D_WASI_EMULATED_PROCESS_CLOCKS -I${ROOT_DIR}/backend/remill/include -I${ROOT_DIR} -fno-exceptions"
+  WASISDKFLAGS="${OPTFLAGS} -msimd128 --sysroot=${WASI_SDK_PATH}/share/wasi-sysroot -D_WASI_EMULATED_PROCESS_CLOCKS -I${ROOT_DIR}/backend/remill/include -I${ROOT_DIR} -fno-exceptions"
   WASISDK_LINKFLAGS="-lwasi-emulated-process-clocks"
   ELFCONV_SHARED_RUNTIMES="${RUNTIME_DIR}/Entry.cpp ${RUNTIME_DIR}/Runtime.cpp ${RUNTIME_DIR}/Memory.cpp ${RUNTIME_DIR}/VmIntrinsics.cpp ${UTILS_DIR}/Util.cpp ${UTILS_DIR}/elfconv.cpp"
   WASMEDGE_COMPILE_OPT="wasmedge compile --optimize 3"
@@ -32,6 +32,34 @@ setting() {
     RUNTIME_MACRO="${RUNTIME_MACRO} -DELFC_RUNTIME_SYSCALL_DEBUG=1 -DELFC_RUNTIME_MULSECTIONS_WARNING=1 "
   fi
 
+  # place every guest memory area on one contiguous host memory.
+  if [ -n "$FLAT_MEMORY" ]; then
+    RUNTIME_MACRO="${RUNTIME_MACRO} -DELFC_RUNTIME_FLAT_MEMORY=1 "
+  fi
+
+  # whole-program LTO: the lifted code and the runtime are optimized together at link time
+  # (the runtime intrinsics are inlined into the lifted functions and the unused runtime code is dropped).
+  if [ -n "$LTO" ]; then
+    CLANGFLAGS="${CLANGFLAGS} -flto -fuse-ld=lld"
+    EMCCFLAGS="${EMCCFLAGS} -flto"
+    WASISDKFLAGS="${WASISDKFLAGS} -flto"
+  fi
+
+  # count the guest functions ("fn") or basic blocks ("block") and write the profile at exit.
+  # PGO_INSTRUMENT=1 also writes elfconv.pgo for the next lifting (PGO_PROFILE=elfconv.pgo).
+  if [ -n "$GUEST_PROFILE" ] || [ -n "$PGO_INSTRUMENT" ]; then
+    RUNTIME_MACRO="${RUNTIME_MACRO} -DELFC_RUNTIME_PROFILE=1 "
+  fi
+
+  # run the guest threads (clone) on the wasm threads (Web Worker, wasi-threads).
+  # the native runtime always runs them on the host threads.
+  if [ -n "$THREADS" ]; then
+    RUNTIME_MACRO="${RUNTIME_MACRO} -DELFC_RUNTIME_THREADS=1 "
+    EMCCFLAGS="${EMCCFLAGS} -pthread -sPTHREAD_POOL_SIZE=navigator.hardwareConcurrency"
+    WASISDKFLAGS="${WASISDKFLAGS} --target=wasm32-wasi-threads -pthread"
+    WASISDK_LINKFLAGS="${WASISDK_LINKFLAGS} -Wl,--import-memory,--export-memory,--max-memory=4294967296"
+  fi
+
 }
 
 aarch64_test() {
@@ -59,6 +87,7 @@ lifting() {
   # ELF -> LLVM bc
   echo -e "[\033[32mINFO\033[0m] ELF -> LLVM bitcode..."
   elf_path=$( realpath "$1" )
+  rm -f lift_*.bc
   
   wasi32_target_arch=''
   if [ "$TARGET" = "*-wasi32" ]; then
@@ -71,12 +100,44 @@ lifting() {
     --target_elf "$elf_path" \
     --dbg_fun_cfg "$3" \
     --bitcode_path "$4" \
+    --jobs "${LIFT_JOBS:-1}" \
+    --opt_level "${LIFT_OPT_LEVEL:-0}" \
+    --stack_slots="${LIFT_STACK_SLOTS:-0}" \
+    --ssa_call_regs="${LIFT_SSA_CALL_REGS:-0}" \
+    --shards "${LIFT_SHARDS:-1}" \
+    --reachable_only="${REACHABLE_ONLY:-0}" \
+    --lift_cache "${LIFT_CACHE}" \
+    --stats_json "${LIFT_STATS}" \
+    --guest_profile "${GUEST_PROFILE}" \
+    --instrument="${PGO_INSTRUMENT:-0}" \
+    --profile "${PGO_PROFILE}" \
     --target_arch "$wasi32_target_arch" && \
     llvm-dis-${LLVM_VERSION} lift.bc -o lift.ll
   echo -e "[\033[32mINFO\033[0m] lift.bc was generated."
 
 }
 
+# compile the lifted bitcode files of LIFT_SHARDS to the objects in parallel.
+# $1: compiler and flags
+# LIFTED is set to the lifted code for the final link.
+compile_lifted() {
+
+  LIFTED="lift.ll"
+  if [ "${LIFT_SHARDS:-1}" -gt 1 ]; then
+    LIFTED=""
+    pids=()
+    for bc in lift.bc lift_*.bc; do
+      $1 -c -o "${bc%.bc}.o" "$bc" &
+      pids+=($!)
+      LIFTED="${LIFTED} ${bc%.bc}.o"
+    done
+    for pid in "${pids[@]}"; do
+      wait "$pid" || exit 1
+    done
+  fi
+
+}
+
 # $1: path to ELF
 # $2: (optional) debug target function name
 # $3: (optional) path to can be linked LLVM bitcode of semantics functions
@@ -115,15 +176,17 @@ main() {
   case "$TARGET" in
     *-native)
       echo -e "[\033[32mINFO\033[0m] Compiling to Native binary (for $HOST_CPU)... "
-      $CXX $CLANGFLAGS $RUNTIME_MACRO -o "exe.${HOST_CPU}" lift.ll $ELFCONV_SHARED_RUNTIMES ${RUNTIME_DIR}/syscalls/SyscallNative.cpp
+      compile_lifted "$CXX $CLANGFLAGS"
+      $CXX $CLANGFLAGS $RUNTIME_MACRO -o "exe.${HOST_CPU}" $LIFTED $ELFCONV_SHARED_RUNTIMES ${RUNTIME_DIR}/syscalls/SyscallNative.cpp
       echo -e " [\033[32mINFO\033[0m] exe.${HOST_CPU} was generated."
       return 0
     ;;
     *-wasm)
       RUNTIME_MACRO="$RUNTIME_MACRO -DTARGET_IS_BROWSER=1"
       echo -e "[\033[32mINFO\033[0m] Compiling to Wasm and Js (for Browser)... "
+      compile_lifted "$EMCC $EMCCFLAGS"
       $EMCC $EMCCFLAGS $RUNTIME_MACRO -o exe.js -sALLOW_MEMORY_GROWTH -sASYNCIFY -sEXPORT_ES6 -sENVIRONMENT=web --js-library ${ROOT_DIR}/xterm-pty/emscripten-pty.js \
-                              lift.ll $ELFCONV_SHARED_RUNTIMES ${RUNTIME_DIR}/syscalls/SyscallBrowser.cpp
+                              $LIFTED $ELFCONV_SHARED_RUNTIMES ${RUNTIME_DIR}/syscalls/SyscallBrowser.cpp
       echo -e "[\033[32mINFO\033[0m] exe.wasm and exe.js were generated."
       cp exe.js ${ROOT_DIR}/examples/browser
       cp exe.wasm ${ROOT_DIR}/examples/browser
@@ -133,7 +196,8 @@ main() {
       RUNTIME_MACRO="$RUNTIME_MACRO -DTARGET_IS_WASI=1"
       cd $BUILD_DIR
       echo -e "[\033[32mINFO\033[0m] Compiling to Wasm (for WASI)... "
-      $WASISDKCC $WASISDKFLAGS $WASISDK_LINKFLAGS $RUNTIME_MACRO -o exe.wasm lift.ll $ELFCONV_SHARED_RUNTIMES ${RUNTIME_DIR}/syscalls/SyscallWasi.cpp
+      compile_lifted "$WASISDKCC $WASISDKFLAGS"
+      $WASISDKCC $WASISDKFLAGS $WASISDK_LINKFLAGS $RUNTIME_MACRO -o exe.wasm $LIFTED $ELFCONV_SHARED_RUNTIMES ${RUNTIME_DIR}/syscalls/SyscallWasi.cpp
       echo -e "[\033[32mINFO\033[0m] exe.wasm was generated."
       $WASMEDGE_COMPILE_OPT exe.wasm exe_o3.wasm
       echo -e "[\033[32mINFO\033[0m] Universal compile optimization was done. (exe_o3.wasm)"
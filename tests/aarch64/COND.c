@@ -46,4 +46,167 @@ MAKE_FCSEL_DOUBLEWORD_SIGNED_ADDS(vs)
 MAKE_FCSEL_DOUBLEWORD_SIGNED_ADDS(vc)
 MAKE_FCSEL_DOUBLEWORD_UNSIGNED_SUBS(hi)
 MAKE_FCSEL_DOUBLEWORD_UNSIGNED_SUBS(ls)
-// MAKE_FCSEL_DOUBLEWORD_CMP(al) failed to lift ???
\ No newline at end of file
+// MAKE_FCSEL_DOUBLEWORD_CMP(al) failed to lift ???
+
+// <op> <Xd>, <Xn>, <Xm> and <op> <Wd>, <Wn>, <Wm> (op = SUBS, ADDS, ANDS) followed by
+// CSET <Wd>, <cond> or B.<cond> in the same block
+#define MAKE_COND_FLAGS(op, cond) \
+  uint32_t cset_##op##_x_##cond(uint64_t _r1, uint64_t _r2) { \
+    uint64_t tmp; \
+    uint32_t res; \
+    asm __volatile__(#op " %x[tmp], %x[r1], %x[r2] \n\t" \
+                     "CSET %w[res], " #cond "" \
+                     : [tmp] "=&r"(tmp), [res] "=r"(res) \
+                     : [r1] "r"(_r1), [r2] "r"(_r2) \
+                     : "cc"); \
+    return res; \
+  } \
+  uint32_t cset_##op##_w_##cond(uint64_t _r1, uint64_t _r2) { \
+    uint32_t tmp; \
+    uint32_t res; \
+    asm __volatile__(#op " %w[tmp], %w[r1], %w[r2] \n\t" \
+                     "CSET %w[res], " #cond "" \
+                     : [tmp] "=&r"(tmp), [res] "=r"(res) \
+                     : [r1] "r"(_r1), [r2] "r"(_r2) \
+                     : "cc"); \
+    return res; \
+  } \
+  uint32_t bcond_##op##_x_##cond(uint64_t _r1, uint64_t _r2) { \
+    uint64_t tmp; \
+    uint32_t res; \
+    asm __volatile__("MOV %w[res], #1 \n\t" #op " %x[tmp], %x[r1], %x[r2] \n\t" \
+                     "B." #cond " 1f \n\t" \
+                     "MOV %w[res], #0 \n\t" \
+                     "1:" \
+                     : [tmp] "=&r"(tmp), [res] "=&r"(res) \
+                     : [r1] "r"(_r1), [r2] "r"(_r2) \
+                     : "cc"); \
+    return res; \
+  } \
+  uint32_t bcond_##op##_w_##cond(uint64_t _r1, uint64_t _r2) { \
+    uint32_t tmp; \
+    uint32_t res; \
+    asm __volatile__("MOV %w[res], #1 \n\t" #op " %w[tmp], %w[r1], %w[r2] \n\t" \
+                     "B." #cond " 1f \n\t" \
+                     "MOV %w[res], #0 \n\t" \
+                     "1:" \
+                     : [tmp] "=&r"(tmp), [res] "=&r"(res) \
+                     : [r1] "r"(_r1), [r2] "r"(_r2) \
+                     : "cc"); \
+    return res; \
+  }
+#define MAKE_COND_FLAGS_ALL(op) \
+  MAKE_COND_FLAGS(op, eq) \
+  MAKE_COND_FLAGS(op, ne) \
+  MAKE_COND_FLAGS(op, cs) \
+  MAKE_COND_FLAGS(op, cc) \
+  MAKE_COND_FLAGS(op, mi) \
+  MAKE_COND_FLAGS(op, pl) \
+  MAKE_COND_FLAGS(op, vs) \
+  MAKE_COND_FLAGS(op, vc) \
+  MAKE_COND_FLAGS(op, hi) \
+  MAKE_COND_FLAGS(op, ls) \
+  MAKE_COND_FLAGS(op, ge) \
+  MAKE_COND_FLAGS(op, lt) \
+  MAKE_COND_FLAGS(op, gt) \
+  MAKE_COND_FLAGS(op, le)
+// the functions of every condition (in the order of `cond_names`)
+#define COND_FLAGS_TABLE(prefix) \
+  { \
+    prefix##_eq, prefix##_ne, prefix##_cs, prefix##_cc, prefix##_mi, prefix##_pl, prefix##_vs, \
+        prefix##_vc, prefix##_hi, prefix##_ls, prefix##_ge, prefix##_lt, prefix##_gt, prefix##_le \
+  }
+
+MAKE_COND_FLAGS_ALL(subs)
+MAKE_COND_FLAGS_ALL(adds)
+MAKE_COND_FLAGS_ALL(ands)
+
+const char *cond_names[14] = {"eq", "ne", "cs", "cc", "mi", "pl", "vs",
+                              "vc", "hi", "ls", "ge", "lt", "gt", "le"};
+
+// SUBS (sel = 0) or ADDS (sel != 0) in the different blocks, and the reader in the join block
+// (the NZCV reaches the reader through the phi)
+#define JOIN_FLAG_SETTERS \
+  "CBNZ %x[sel], 1f \n\t" \
+  "SUBS %x[tmp], %x[r1], %x[r2] \n\t" \
+  "B 2f \n\t" \
+  "1: \n\t" \
+  "ADDS %x[tmp], %x[r1], %x[r2] \n\t" \
+  "2: \n\t"
+#define MAKE_JOIN_READER(reader, cond, reader_asm) \
+  uint64_t reader##_join_##cond(uint64_t _sel, uint64_t _r1, uint64_t _r2) { \
+    uint64_t tmp, res = 0; \
+    asm __volatile__(JOIN_FLAG_SETTERS reader_asm \
+                     : [tmp] "=&r"(tmp), [res] "+&r"(res) \
+                     : [sel] "r"(_sel), [r1] "r"(_r1), [r2] "r"(_r2), [a] "r"(0x1111UL), \
+                       [b] "r"(0x2222UL) \
+                     : "cc"); \
+    return res; \
+  }
+// FCSEL  <Dd>, <Dn>, <Dm>, <cond> (returns 1 or 2)
+#define MAKE_JOIN_FCSEL(cond) \
+  uint64_t fcsel_join_##cond(uint64_t _sel, uint64_t _r1, uint64_t _r2) { \
+    uint64_t tmp; \
+    double dd; \
+    asm __volatile__(JOIN_FLAG_SETTERS "FCSEL %d[dd], %d[dn], %d[dm], " #cond "" \
+                     : [tmp] "=&r"(tmp), [dd] "=&w"(dd) \
+                     : [sel] "r"(_sel), [r1] "r"(_r1), [r2] "r"(_r2), [dn] "w"(1.0), \
+                       [dm] "w"(2.0) \
+                     : "cc"); \
+    return (uint64_t) dd; \
+  }
+// the NZCV of SUBS in the loop reaches CSET after the loop (the phi cycle)
+// (flags of `SUBS r1, (n - 1) * r2`)
+#define MAKE_LOOP_CSET(cond) \
+  uint64_t cset_loop_##cond(uint64_t _n, uint64_t _r1, uint64_t _r2) { \
+    uint64_t tmp, i, res; \
+    asm __volatile__("MOV %x[i], #0 \n\t" \
+                     "1: \n\t" \
+                     "SUBS %x[tmp], %x[r1], %x[i] \n\t" \
+                     "ADD %x[i], %x[i], %x[r2] \n\t" \
+                     "SUB %x[n], %x[n], #1 \n\t" \
+                     "CBNZ %x[n], 1b \n\t" \
+                     "CSET %x[res], " #cond "" \
+                     : [tmp] "=&r"(tmp), [i] "=&r"(i), [res] "=&r"(res), [n] "+r"(_n) \
+                     : [r1] "r"(_r1), [r2] "r"(_r2) \
+                     : "cc"); \
+    return res; \
+  }
+#define MAKE_JOIN_READERS(cond) \
+  MAKE_JOIN_READER(cset, cond, "CSET %x[res], " #cond) \
+  MAKE_JOIN_READER(csel, cond, "CSEL %x[res], %x[a], %x[b], " #cond) \
+  MAKE_JOIN_READER(csinc, cond, "CSINC %x[res], %x[a], %x[b], " #cond) \
+  MAKE_JOIN_READER(csinv, cond, "CSINV %x[res], %x[a], %x[b], " #cond) \
+  MAKE_JOIN_READER(csneg, cond, "CSNEG %x[res], %x[a], %x[b], " #cond) \
+  MAKE_JOIN_READER(ccmp, cond, \
+                   "CCMP %x[a], %x[a], #0, " #cond " \n\t" \
+                   "CSET %x[res], eq") \
+  MAKE_JOIN_READER(ccmn, cond, \
+                   "CCMN %x[a], #0, #4, " #cond " \n\t" \
+                   "CSET %x[res], ne") \
+  MAKE_JOIN_READER(bcond, cond, \
+                   "MOV %x[res], #1 \n\t" \
+                   "B." #cond " 3f \n\t" \
+                   "MOV %x[res], #0 \n\t" \
+                   "3:") \
+  MAKE_JOIN_FCSEL(cond) \
+  MAKE_LOOP_CSET(cond)
+
+MAKE_JOIN_READERS(eq)
+MAKE_JOIN_READERS(ne)
+MAKE_JOIN_READERS(cs)
+MAKE_JOIN_READERS(cc)
+MAKE_JOIN_READERS(mi)
+MAKE_JOIN_READERS(pl)
+MAKE_JOIN_READERS(vs)
+MAKE_JOIN_READERS(vc)
+MAKE_JOIN_READERS(hi)
+MAKE_JOIN_READERS(ls)
+MAKE_JOIN_READERS(ge)
+MAKE_JOIN_READERS(lt)
+MAKE_JOIN_READERS(gt)
+MAKE_JOIN_READERS(le)
+// ADC, SBC and SBCS read only the carry
+MAKE_JOIN_READER(adc, cs, "ADC %x[res], %x[a], %x[b]")
+MAKE_JOIN_READER(sbc, cs, "SBC %x[res], %x[a], %x[b]")
+MAKE_JOIN_READER(sbcs, cs, "SBCS %x[res], %x[a], %x[b]")
@@ -288,6 +288,55 @@ void stxr_doubleword(uint64_t *xs1, uint32_t *ws2, uint64_t xt, uint64_t *mem_pt
                    : "r"(xt), [mem] "r"(mem_ptr)
                    : "memory");  // LDXR for exclusive access
 }
+// STLXR <Ws>, <Wt>, [<Xn|SP>{,#0}]
+void stlxr_word(uint32_t *ws1, uint32_t *w_status, uint32_t wt, uint32_t *mem_ptr) {
+  asm __volatile__("LDAXR %w0, [%[mem]] \n\t"
+                   "STLXR %w1, %w2, [%[mem]]"
+                   : "+r"(*ws1), "+r"(*w_status)
+                   : "r"(wt), [mem] "r"(mem_ptr)
+                   : "memory");  // LDAXR for exclusive access
+}
+// STLXR <Ws>, <Xt>, [<Xn|SP>{,#0}]
+void stlxr_doubleword(uint64_t *xs1, uint32_t *ws2, uint64_t xt, uint64_t *mem_ptr) {
+  asm __volatile__("LDAXR %x0, [%[mem]] \n\t"
+                   "STLXR %w1, %x2, [%[mem]]"
+                   : "+r"(*xs1), "+r"(*ws2)
+                   : "r"(xt), [mem] "r"(mem_ptr)
+                   : "memory");  // LDAXR for exclusive access
+}
+// LDXR <Wt>, [<Xn|SP>{,#0}] and STXR <Ws>, <Wt>, [<Xn|SP>{,#0}] (retry loop)
+void ldxr_stxr_add_word(uint32_t *w_old, uint32_t wm, uint32_t *mem_ptr) {
+  uint32_t w_new, w_status;
+  asm __volatile__("1: \n\t"
+                   "LDXR %w[old], [%[mem]] \n\t"
+                   "ADD %w[new], %w[old], %w[m] \n\t"
+                   "STXR %w[status], %w[new], [%[mem]] \n\t"
+                   "CBNZ %w[status], 1b"
+                   : [old] "=&r"(*w_old), [new] "=&r"(w_new), [status] "=&r"(w_status)
+                   : [m] "r"(wm), [mem] "r"(mem_ptr)
+                   : "memory");
+}
+// LDAXR <Xt>, [<Xn|SP>{,#0}] and STLXR <Ws>, <Xt>, [<Xn|SP>{,#0}] (retry loop)
+void ldaxr_stlxr_add_doubleword(uint64_t *x_old, uint64_t xm, uint64_t *mem_ptr) {
+  uint64_t x_new;
+  uint32_t w_status;
+  asm __volatile__("1: \n\t"
+                   "LDAXR %x[old], [%[mem]] \n\t"
+                   "ADD %x[new], %x[old], %x[m] \n\t"
+                   "STLXR %w[status], %x[new], [%[mem]] \n\t"
+                   "CBNZ %w[status], 1b"
+                   : [old] "=&r"(*x_old), [new] "=&r"(x_new), [status] "=&r"(w_status)
+                   : [m] "r"(xm), [mem] "r"(mem_ptr)
+                   : "memory");
+}
+// DMB <option> (option = ish)
+void dmb_ish(uint64_t *mem_ptr, uint64_t xt) {
+  asm __volatile__("STR %x1, [%0] \n\t"
+                   "DMB ish"
+                   :
+                   : "r"(mem_ptr), "r"(xt)
+                   : "memory");
+}
 // DC <dc_op>, <Xt> (dc_op = zva)
 void dc_zva(uint64_t *mem_ptr) {
   asm __volatile__("DC zva, %0" ::"r"(mem_ptr));
@@ -936,6 +936,59 @@ void test_stxr_doubleword() {
   assert(123 == mem);
   printf("ok STXR <Ws>, <Xt>, [<Xn|SP>{,#0}]\n");
 }
+// STLXR <Ws>, <Wt>, [<Xn|SP>{,#0}]
+void test_stlxr_word() {
+  uint32_t ws1 = 2;  // for LDAXR
+  uint32_t w_status = 12;
+  uint32_t wt = 123;
+  uint32_t mem = 1234;
+  stlxr_word(&ws1, &w_status, wt, &mem);
+  assert(1234 == ws1);
+  assert(0 == w_status);
+  assert(123 == mem);
+  printf("ok STLXR <Ws>, <Wt>, [<Xn|SP>{,#0}]\n");
+}
+// STLXR <Ws>, <Xt>, [<Xn|SP>{,#0}]
+void test_stlxr_doubleword() {
+  uint64_t xs1 = 2;  // for LDAXR
+  uint32_t w_status = 12;
+  uint64_t xt = 0x123456789abcdef0;
+  uint64_t mem = 0xfedcba9876543210;
+  stlxr_doubleword(&xs1, &w_status, xt, &mem);
+  assert(0xfedcba9876543210 == xs1);
+  assert(0 == w_status);
+  assert(0x123456789abcdef0 == mem);
+  printf("ok STLXR <Ws>, <Xt>, [<Xn|SP>{,#0}]\n");
+}
+// LDXR <Wt>, [<Xn|SP>{,#0}] and STXR <Ws>, <Wt>, [<Xn|SP>{,#0}] (retry loop)
+void test_ldxr_stxr_add_word() {
+  uint32_t w_old = 0;
+  uint32_t mem = 0xfffffff0;
+  for (int i = 0; i < 32; i++) {
+    ldxr_stxr_add_word(&w_old, 1, &mem);
+    assert(0xfffffff0 + i == w_old);
+  }
+  assert(0x10 == mem);  // wraps around in 32 bits
+  printf("ok LDXR <Wt>, [<Xn|SP>{,#0}] and STXR <Ws>, <Wt>, [<Xn|SP>{,#0}] (retry loop)\n");
+}
+// LDAXR <Xt>, [<Xn|SP>{,#0}] and STLXR <Ws>, <Xt>, [<Xn|SP>{,#0}] (retry loop)
+void test_ldaxr_stlxr_add_doubleword() {
+  uint64_t x_old = 0;
+  uint64_t mem = 0xfffffffffffffff0;
+  for (int i = 0; i < 32; i++) {
+    ldaxr_stlxr_add_doubleword(&x_old, 1, &mem);
+    assert(0xfffffffffffffff0 + i == x_old);
+  }
+  assert(0x10 == mem);
+  printf("ok LDAXR <Xt>, [<Xn|SP>{,#0}] and STLXR <Ws>, <Xt>, [<Xn|SP>{,#0}] (retry loop)\n");
+}
+// DMB <option> (option = ish)
+void test_dmb_ish() {
+  uint64_t mem = 0;
+  dmb_ish(&mem, 0x1234);
+  assert(0x1234 == mem);
+  printf("ok DMB <option> (option = ish)\n");
+}
 // DC <dc_op>, <Xt> (dc_op = zva)
 void test_dc_zva() {
   uint64_t mem[16];
@@ -1278,6 +1331,163 @@ void test_fcsel_double() {
   }
   printf("ok FCSEL  <Dd>, <Dn>, <Dm>, <cond>\n");
 }
+// the condition `cond_names[cond]` holds on the NZCV
+int cond_holds(int cond, int n, int z, int c, int v) {
+  int res;
+  switch (cond >> 1) {
+    case 0: res = z; break;  // eq, ne
+    case 1: res = c; break;  // cs, cc
+    case 2: res = n; break;  // mi, pl
+    case 3: res = v; break;  // vs, vc
+    case 4: res = c && !z; break;  // hi, ls
+    case 5: res = n == v; break;  // ge, lt
+    default: res = !z && n == v; break;  // gt, le
+  }
+  return (cond & 1) ? !res : res;
+}
+// NZCV of SUBS, ADDS and ANDS (width = 32 or 64)
+void expected_nzcv(const char *op, int width, uint64_t r1, uint64_t r2, int *n, int *z, int *c,
+                   int *v) {
+  uint64_t mask = width == 64 ? ~0ULL : 0xffffffffULL;
+  uint64_t sign = 1ULL << (width - 1);
+  uint64_t a = r1 & mask, b = r2 & mask, res;
+  if (op[0] == 's') {
+    res = (a - b) & mask;
+    *c = a >= b;
+    *v = ((a ^ b) & (a ^ res) & sign) != 0;
+  } else if (op[0] == 'a' && op[1] == 'd') {
+    res = (a + b) & mask;
+    *c = res < a;
+    *v = (~(a ^ b) & (a ^ res) & sign) != 0;
+  } else {
+    res = a & b;
+    *c = 0;
+    *v = 0;
+  }
+  *n = (res & sign) != 0;
+  *z = res == 0;
+}
+// <op> <Xd>, <Xn>, <Xm> and <op> <Wd>, <Wn>, <Wm> (op = SUBS, ADDS, ANDS)
+// followed by CSET <Wd>, <cond> or B.<cond>
+void test_cond_flags() {
+  typedef uint32_t (*cond_fn)(uint64_t, uint64_t);
+  struct {
+    const char *op;
+    const char *consumer;
+    int width;
+    cond_fn fns[14];
+  } cases[] = {
+      {"subs", "CSET", 64, COND_FLAGS_TABLE(cset_subs_x)},
+      {"subs", "CSET", 32, COND_FLAGS_TABLE(cset_subs_w)},
+      {"subs", "B", 64, COND_FLAGS_TABLE(bcond_subs_x)},
+      {"subs", "B", 32, COND_FLAGS_TABLE(bcond_subs_w)},
+      {"adds", "CSET", 64, COND_FLAGS_TABLE(cset_adds_x)},
+      {"adds", "CSET", 32, COND_FLAGS_TABLE(cset_adds_w)},
+      {"adds", "B", 64, COND_FLAGS_TABLE(bcond_adds_x)},
+      {"adds", "B", 32, COND_FLAGS_TABLE(bcond_adds_w)},
+      {"ands", "CSET", 64, COND_FLAGS_TABLE(cset_ands_x)},
+      {"ands", "CSET", 32, COND_FLAGS_TABLE(cset_ands_w)},
+      {"ands", "B", 64, COND_FLAGS_TABLE(bcond_ands_x)},
+      {"ands", "B", 32, COND_FLAGS_TABLE(bcond_ands_w)},
+  };
+  // the boundaries of the carry and the signed overflow in both widths
+  uint64_t vals[] = {0,
+                     1,
+                     2,
+                     0x7fffffff,
+                     0x80000000,
+                     0xffffffff,
+                     0x100000000,
+                     0x7fffffffffffffff,
+                     0x8000000000000000,
+                     0x8000000000000001,
+                     0xfffffffffffffffe,
+                     0xffffffffffffffff};
+  int val_num = sizeof(vals) / sizeof(vals[0]);
+  for (int i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    for (int cond = 0; cond < 14; cond++) {
+      for (int j = 0; j < val_num; j++) {
+        for (int k = 0; k < val_num; k++) {
+          int n, z, c, v;
+          expected_nzcv(cases[i].op, cases[i].width, vals[j], vals[k], &n, &z, &c, &v);
+          assert(cond_holds(cond, n, z, c, v) == cases[i].fns[cond](vals[j], vals[k]));
+        }
+      }
+      if (cases[i].width == 64)
+        printf("ok %s <Xd>, <Xn>, <Xm> and %s (cond = %s)\n", cases[i].op, cases[i].consumer,
+               cond_names[cond]);
+      else
+        printf("ok %s <Wd>, <Wn>, <Wm> and %s (cond = %s)\n", cases[i].op, cases[i].consumer,
+               cond_names[cond]);
+    }
+  }
+}
+// the readers in the join block of SUBS (sel = 0) and ADDS (sel != 0)
+void test_cond_flags_join() {
+  typedef uint64_t (*join_fn)(uint64_t, uint64_t, uint64_t);
+  struct {
+    const char *reader;
+    join_fn fns[14];
+    uint64_t if_true;
+    uint64_t if_false;
+  } cases[] = {
+      {"CSET", COND_FLAGS_TABLE(cset_join), 1, 0},
+      {"CSEL", COND_FLAGS_TABLE(csel_join), 0x1111, 0x2222},
+      {"CSINC", COND_FLAGS_TABLE(csinc_join), 0x1111, 0x2223},
+      {"CSINV", COND_FLAGS_TABLE(csinv_join), 0x1111, ~0x2222UL},
+      {"CSNEG", COND_FLAGS_TABLE(csneg_join), 0x1111, -0x2222UL},
+      {"CCMP", COND_FLAGS_TABLE(ccmp_join), 1, 0},
+      {"CCMN", COND_FLAGS_TABLE(ccmn_join), 1, 0},
+      {"B", COND_FLAGS_TABLE(bcond_join), 1, 0},
+      {"FCSEL", COND_FLAGS_TABLE(fcsel_join), 1, 2},
+  };
+  uint64_t vals[] = {0, 1, 0x7fffffffffffffff, 0x8000000000000000, 0xffffffffffffffff};
+  int val_num = sizeof(vals) / sizeof(vals[0]);
+  for (int i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    for (int cond = 0; cond < 14; cond++) {
+      for (uint64_t sel = 0; sel < 2; sel++) {
+        for (int j = 0; j < val_num; j++) {
+          for (int k = 0; k < val_num; k++) {
+            int n, z, c, v;
+            expected_nzcv(sel ? "adds" : "subs", 64, vals[j], vals[k], &n, &z, &c, &v);
+            uint64_t expected =
+                cond_holds(cond, n, z, c, v) ? cases[i].if_true : cases[i].if_false;
+            assert(expected == cases[i].fns[cond](sel, vals[j], vals[k]));
+          }
+        }
+      }
+      printf("ok subs or adds and %s in the join block (cond = %s)\n", cases[i].reader,
+             cond_names[cond]);
+    }
+  }
+  // ADC, SBC and SBCS (read only the carry)
+  for (uint64_t sel = 0; sel < 2; sel++) {
+    for (int j = 0; j < val_num; j++) {
+      for (int k = 0; k < val_num; k++) {
+        int n, z, c, v;
+        expected_nzcv(sel ? "adds" : "subs", 64, vals[j], vals[k], &n, &z, &c, &v);
+        assert(0x1111 + 0x2222 + c == adc_join_cs(sel, vals[j], vals[k]));
+        assert(0x1111 - 0x2222 - 1 + c == sbc_join_cs(sel, vals[j], vals[k]));
+        assert(0x1111 - 0x2222 - 1 + c == sbcs_join_cs(sel, vals[j], vals[k]));
+      }
+    }
+  }
+  printf("ok subs or adds and ADC, SBC, SBCS in the join block\n");
+  // the NZCV of the loop
+  join_fn loop_fns[14] = COND_FLAGS_TABLE(cset_loop);
+  for (int cond = 0; cond < 14; cond++) {
+    for (uint64_t loop_n = 1; loop_n <= 3; loop_n++) {
+      for (int j = 0; j < val_num; j++) {
+        for (int k = 0; k < val_num; k++) {
+          int n, z, c, v;
+          expected_nzcv("subs", 64, vals[j], (loop_n - 1) * vals[k], &n, &z, &c, &v);
+          assert(cond_holds(cond, n, z, c, v) == loop_fns[cond](loop_n, vals[j], vals[k]));
+        }
+      }
+    }
+    printf("ok subs in the loop and CSET after the loop (cond = %s)\n", cond_names[cond]);
+  }
+}
 /*
   MISC.c
 */
@@ -1560,11 +1770,18 @@ int main() {
   test_ld1r_4s();
   test_stxr_word();
   test_stxr_doubleword();
+  test_stlxr_word();
+  test_stlxr_doubleword();
+  test_ldxr_stxr_add_word();
+  test_ldaxr_stlxr_add_doubleword();
+  test_dmb_ish();
   test_dc_zva();
   test_cnt_vector_8b();
   // test_cnt_vector_16b();
   // COND.c
   test_fcsel_double();
+  test_cond_flags();
+  test_cond_flags_join();
   // MISC.c
   test_prfm_pldl1keep();
   // SIMD.c
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
+#include <fstream>
 #include <gtest/internal/gtest-port.h>
+#include <regex>
+#include <sstream>
 #include <stdlib.h>
 #include <string>
 #include <utils/Util.h>
@@ -12,6 +15,9 @@ using ::testing::UnitTest;
 const char *ELFCONV_WASI_MACRO =
     "-DELF_IS_AARCH64 --sysroot=${WASI_SDK_PATH}/share/wasi-sysroot -D_WASI_EMULATED_PROCESS_CLOCKS -DTARGET_IS_WASI=1 -lwasi-emulated-process-clocks -fno-exceptions -I../../../backend/remill/include -I../../../";
 
+const char *ELFCONV_WASI_THREADS_MACRO =
+    " -DELFC_RUNTIME_THREADS=1 --target=wasm32-wasi-threads -pthread -Wl,--import-memory,--export-memory,--max-memory=4294967296";
+
 enum WASI_RUNTIME : uint8_t { WASMTIME, WASMEDGE };
 
 void clean_up();
@@ -27,7 +33,7 @@ class TestEnvironment : public ::testing::Environment {
 
 // rm generated obj
 void clean_up() {
-  system("rm *.o *.bc *.wasm");
+  system("rm *.o *.bc *.wasm *.json");
 }
 
 void cmd_check(int status, const char *cmd) {
@@ -40,13 +46,13 @@ void cmd_check(int status, const char *cmd) {
 }
 
 // binary lifting
-std::string binary_lifting(const char *elf_path) {
+std::string binary_lifting(const char *elf_path, const char *lift_flags = "") {
   char buf[256] = {0};
   FILE *pipe;
   int status;
   std::string stdout_res;
   auto cmd = "../../../build/lifter/elflift --arch aarch64 --bc_out lift.bc --target_elf " +
-             std::string(elf_path);
+             std::string(elf_path) + " " + lift_flags;
 
   pipe = popen(cmd.c_str(), "r");
   EXPECT_NE(pipe, nullptr) << "[ERROR] Failed to " << cmd.c_str() << " at binary_lifting.";
@@ -61,12 +67,14 @@ std::string binary_lifting(const char *elf_path) {
   return stdout_res;
 }
 
-void gen_wasm_for_wasi_runtimes() {
+// `threads`: the guest threads run on wasi-threads (THREADS=1 of dev.sh)
+void gen_wasm_for_wasi_runtimes(bool threads = false) {
   FILE *pipe;
   int status;
 
   auto cmd =
       std::string("${WASI_SDK_PATH}/bin/clang++ -O3 ") + ELFCONV_WASI_MACRO +
+      (threads ? ELFCONV_WASI_THREADS_MACRO : "") +
       " -o exe.wasm lift.bc ../../../runtime/Entry.cpp ../../../runtime/Memory.cpp ../../../runtime/Runtime.cpp " +
       "../../../runtime/syscalls/SyscallWasi.cpp ../../../runtime/VmIntrinsics.cpp ../../../utils/Util.cpp ../../../utils/elfconv.cpp";
   pipe = popen(cmd.c_str(), "r");
@@ -77,14 +85,16 @@ void gen_wasm_for_wasi_runtimes() {
   EXPECT_NE(status, -1) << "[ERROR] Failed to pclose pipe at gen_wasm_for_wasi_runtimes.";
 }
 
-std::string exec_wasm(WASI_RUNTIME wasi_runtime) {
+std::string exec_wasm(WASI_RUNTIME wasi_runtime, bool threads = false) {
   std::string cmd;
   FILE *pipe;
   char buf[1000];
   int status;
 
   switch (wasi_runtime) {
-    case WASMTIME: cmd = "wasmtime exe.wasm"; break;
+    case WASMTIME:
+      cmd = threads ? "wasmtime -W threads=y -S threads=y exe.wasm" : "wasmtime exe.wasm";
+      break;
     case WASMEDGE: cmd = "wasmedge exe.wasm"; break;
     default: EXPECT_NE(0, 1);
   }
@@ -107,13 +117,14 @@ std::string exec_wasm(WASI_RUNTIME wasi_runtime) {
   return stdout_res;
 }
 
-void unit_test_wasi_runtime(const char *program, const char *expected, WASI_RUNTIME wasi_runtime) {
+void unit_test_wasi_runtime(const char *program, const char *expected, WASI_RUNTIME wasi_runtime,
+                            const char *lift_flags = "", bool threads = false) {
   // binary lifting
-  binary_lifting(("../../../examples/" + std::string(program) + "/a.aarch64").c_str());
+  binary_lifting(("../../../examples/" + std::string(program) + "/a.aarch64").c_str(), lift_flags);
   // generate wasm
-  gen_wasm_for_wasi_runtimes();
+  gen_wasm_for_wasi_runtimes(threads);
   // execute wasm
-  auto stdout_res = exec_wasm(wasi_runtime);
+  auto stdout_res = exec_wasm(wasi_runtime, threads);
   // test
   EXPECT_STREQ(expected, stdout_res.c_str());
 }
@@ -126,6 +137,53 @@ TEST(TestWasmedge, IntegrationExamplesTest) {
   unit_test_wasi_runtime("hello", "Hello, World!\n", WASMTIME);
 }
 
+// clone (pthread_create), futex (mutex, condition variable) and exit of the guest threads
+TEST(TestWasmtime, ThreadsTest) {
+  unit_test_wasi_runtime("threads", "counter: 40000\nready: 4\njoined: 4\n", WASMTIME, "", true);
+}
+
+// contended LL/SC (LDAXR and STLXR) and LSE atomics (LDADDAL, CASAL and SWPA) of the guest threads
+TEST(TestWasmtime, AtomicsTest) {
+  unit_test_wasi_runtime("atomics", "ldaxr/stlxr: 40000\nldadd: 40000\ncas: 40000\nswp: 40000\n",
+                         WASMTIME, "", true);
+}
+
+// HFA returned in V0-V3 by the direct and indirect calls with --ssa_call_regs
+TEST(TestWasmtime, SSACallRegsTest) {
+  unit_test_wasi_runtime(
+      "hfa", "cross: -3.0 6.0 -3.0\nscale: 3.0 5.0 7.0 9.0\nreverse: 9.0 7.0 5.0 3.0\n", WASMTIME,
+      "--opt_level 2 --ssa_call_regs");
+}
+
+// "promoted_frame_bytes" of the lifted function `fn_name` in the --stats_json output
+int64_t promoted_frame_bytes(const char *stats_path, const char *fn_name) {
+  std::ifstream stats_ifs(stats_path);
+  std::stringstream stats_ss;
+  stats_ss << stats_ifs.rdbuf();
+  auto stats_json = stats_ss.str();
+  std::smatch match;
+  // the lifted function name is `<symbol>_____<id>_<vma>`
+  std::regex fn_re("\"name\": \"" + std::string(fn_name) +
+                   "_____[^\"]*\"[^}]*\"promoted_frame_bytes\": ([0-9]+)");
+  EXPECT_TRUE(std::regex_search(stats_json, match, fn_re))
+      << "[ERROR] " << fn_name << " is not found in " << stats_path << ".";
+  return match.empty() ? -1 : std::stoll(match[1].str());
+}
+
+// -O0 spills, stack arguments and the frame address passed to the callee (must keep the guest
+// stack) with --stack_slots, compared with the output without it
+TEST(TestWasmtime, StackSlotsTest) {
+  const char *expected = "fib: 12586269025\nsum10: 385\nmix10: 105.0\nescape: 220\n";
+  unit_test_wasi_runtime("stack_slots", expected, WASMTIME);
+  unit_test_wasi_runtime("stack_slots", expected, WASMTIME,
+                         "--opt_level 2 --stack_slots --stats_json stack_slots.json");
+  // the frames of the leaf functions are promoted, and the escaping frame stays
+  EXPECT_GT(promoted_frame_bytes("stack_slots.json", "fib"), 0);
+  EXPECT_GT(promoted_frame_bytes("stack_slots.json", "sum10"), 0);
+  EXPECT_GT(promoted_frame_bytes("stack_slots.json", "mix10"), 0);
+  EXPECT_EQ(promoted_frame_bytes("stack_slots.json", "escape"), 0);
+}
+
 int main(int argc, char **argv) {
   InitGoogleTest(&argc, argv);
 
@@ -14,7 +14,7 @@
 #define PRINT_GPR(index) \
   std::cout << std::hex << "x" << #index << ": 0x" << CPUState.gpr.x##index.qword << std::endl;
 
-extern State CPUState;
+extern thread_local State CPUState;
 
 #define SR_ECV_NZCV__N ((ecv_nzcv & 0b1000) >> 3)
 #define SR_ECV_NZCV__Z ((ecv_nzcv & 0b100) >> 2)